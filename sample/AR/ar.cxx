@@ -53,9 +53,15 @@ int main(int argc, char **argv){
 #endif
     COMM::IOParams<double> slowdown_timescale_max (input_par_store, 0.0, "maximum timescale for maximum slowdown factor","time-end"); // slowdown timescale
     COMM::IOParams<int>   interrupt_detection_option(input_par_store, 0, "modify orbits and check interruption: 0: turn off; 1: modify the binary orbits based on detetion criterion; 2. modify and also interrupt integrations");  // modify orbit or check interruption using modifyAndInterruptIter function
+    COMM::IOParams<int>   precision_extend_option(input_par_store, 0, "use the extended precision mode when the round-off error dominates","0: off"); // adaptive extended precision
+    COMM::IOParams<int>   ds_control_option(input_par_store, 0, "step size control: 0: reduce and recover by backup levels; 1: predictive (PI) controller"); // step size control
+    COMM::IOParams<int>   time_sync_option(input_par_store, 0, "time synchronization: 0: by sub-step time table and step enlargement; 1: one-shot estimation with Newton correction"); // time synchronization
+    COMM::IOParams<int>   extrapolation_option(input_par_store, 0, "integration method: 0: symplectic step; 1: Gragg-Bulirsch-Stoer extrapolation of the symplectic step (use with 2nd order)"); // extrapolation driver
+    COMM::IOParams<int>   extrapolation_stage_max(input_par_store, 8, "maximum number of extrapolation stages"); // maximum extrapolation stages
     COMM::IOParams<int>   fix_step_option (input_par_store, -1, "fix step options: always, later, none","auto"); // if true; use input fix step option
     COMM::IOParams<std::string> filename_par (input_par_store, "", "filename to load manager parameters","input name"); // par dumped filename
     bool load_flag=false;  // if true; load dumped data
+    int load_version=0;    // version of dumped data
     bool synch_flag=false; // if true, switch on time synchronization
 
 #ifdef AR_TTL
@@ -87,7 +93,13 @@ int main(int argc, char **argv){
         {"print-width",required_argument, 0, 10},
         {"print-precision",required_argument, 0, 11},
         {"ds-scale",required_argument, 0, 12},
+        {"precision-extend",required_argument, 0, 13},
+        {"ds-control",required_argument, 0, 14},
+        {"time-sync",required_argument, 0, 15},
+        {"extrapolation",required_argument, 0, 16},
+        {"extrapolation-stage-max",required_argument, 0, 17},
         {"load-data",no_argument, 0, 'l'},
+        {"load-data-version",required_argument, 0, 18},
         {"help",no_argument, 0, 'h'},
         {0,0,0,0}
     };
@@ -136,6 +148,24 @@ int main(int argc, char **argv){
         case 12:
             ds_scale.value = atof(optarg);
             break;
+        case 13:
+            precision_extend_option.value = atoi(optarg);
+            break;
+        case 14:
+            ds_control_option.value = atoi(optarg);
+            break;
+        case 15:
+            time_sync_option.value = atoi(optarg);
+            break;
+        case 16:
+            extrapolation_option.value = atoi(optarg);
+            break;
+        case 17:
+            extrapolation_stage_max.value = atoi(optarg);
+            break;
+        case 18:
+            load_version = atoi(optarg);
+            break;
         case 'G':
             gravitational_constant.value = atof(optarg);
             break;
@@ -194,10 +224,16 @@ int main(int argc, char **argv){
                      <<"    -i [string]: "<<interrupt_detection_option<<"\n"
                      <<"    -l :          load dumped data for restart (if used, the input file is dumped data)\n"
                      <<"          --load-data (same as -l)\n"
+                     <<"          --load-data-version [int]: version of dumped data: 0: current; 1: dumped by old versions without the new profile counters (0)\n"
                      <<"    -k [int]:    "<<sym_order<<"\n"
                      <<"    -n [int]:    "<<nstep<<"\n"
                      <<"    -o [float]:  "<<dt_out<<"\n"
                      <<"    -p [string]: "<<filename_par<<"\n"
+                     <<"          --precision-extend [int] : "<<precision_extend_option<<"\n"
+                     <<"          --ds-control       [int] : "<<ds_control_option<<"\n"
+                     <<"          --time-sync        [int] : "<<time_sync_option<<"\n"
+                     <<"          --extrapolation    [int] : "<<extrapolation_option<<"\n"
+                     <<"          --extrapolation-stage-max [int] : "<<extrapolation_stage_max<<"\n"
                      <<"          --print-width     [int]  : "<<print_width<<"\n"
                      <<"          --print-precision [int]  : "<<print_precision<<"\n"
                      <<"    -r [Float]:  "<<r_break<<"\n"
@@ -246,6 +282,11 @@ int main(int argc, char **argv){
     // set symplectic order
     manager.step.initialSymplecticCofficients(sym_order.value);
     manager.interrupt_detection_option = interrupt_detection_option.value;
+    manager.precision_extend_option = precision_extend_option.value;
+    manager.ds_control_option = ds_control_option.value;
+    manager.time_sync_option = time_sync_option.value;
+    manager.extrapolation_option = extrapolation_option.value;
+    manager.extrapolation_stage_max = extrapolation_stage_max.value;
 
 
     // store input parameters
@@ -268,7 +309,7 @@ int main(int argc, char **argv){
             std::cerr<<"Error: data file "<<filename<<" cannot be open!\n";
             abort();
         }
-        sym_int.readBinary(fin);
+        sym_int.readBinary(fin, load_version);
         fclose(fin);
     }
     else {
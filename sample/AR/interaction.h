@@ -4,6 +4,7 @@
 #include "Common/Float.h"
 #include "Common/particle_group.h"
 #include "AR/force.h"
+#include "AR/force_kernel.h"
 #include "AR/interrupt.h"
 #include "AR/information.h"
 #include "particle.h"
@@ -106,8 +107,11 @@ public:
       \return the time transformation factor (gt_kick_inv) for kick step
     */
     inline Float calcInnerAccPotAndGTKickInv(AR::Force* _force, Float& _epot, const Particle* _particles, const int _n_particle) {
-        _epot = Float(0.0);
         Float gt_kick_inv = Float(0.0);
+        // unrolled kernels for small groups
+        if (AR::calcInnerAccPotAndGTKickInvSmallN(gt_kick_inv, _force, _epot, _particles, _n_particle, gravitational_constant, Float(0.0))) return gt_kick_inv;
+
+        _epot = Float(0.0);
         for (int i=0; i<_n_particle; i++) {
             const Float massi = _particles[i].mass;
             const Float* posi = _particles[i].pos;
@@ -138,10 +142,10 @@ public:
                 acci[2] += gmor3 * dr[2];
 
 #ifdef AR_TTL                     
-                Float mimjor3 = gravitational_constant*massi*gmor3;
-                gtgradi[0] += mimjor3 * dr[0];
-                gtgradi[1] += mimjor3 * dr[1];
-                gtgradi[2] += mimjor3 * dr[2];
+                Float gmimjor3 = massi*gmor3;
+                gtgradi[0] += gmimjor3 * dr[0];
+                gtgradi[1] += gmimjor3 * dr[1];
+                gtgradi[2] += gmimjor3 * dr[2];
 #endif
 
                 Float gmor = gravitational_constant*massj*inv_r;
@@ -3,6 +3,7 @@
 #include <cmath>
 #include "Common/Float.h"
 #include "AR/force.h"
+#include "AR/force_kernel.h"
 #include "Hermite/neighbor.h"
 #include "particle.h"
 
@@ -109,8 +110,11 @@ public:
       \return the time transformation factor (gt_kick_inv) for kick step
     */
     inline Float calcInnerAccPotAndGTKickInv(AR::Force* _force, Float& _epot, const Particle* _particles, const int _n_particle) {
-        _epot = Float(0.0);
         Float gt_kick_inv = Float(0.0);
+        // unrolled kernels for small groups
+        if (AR::calcInnerAccPotAndGTKickInvSmallN(gt_kick_inv, _force, _epot, _particles, _n_particle, gravitational_constant, eps_sq)) return gt_kick_inv;
+
+        _epot = Float(0.0);
         for (int i=0; i<_n_particle; i++) {
             const Float massi = _particles[i].mass;
             const Float* posi = _particles[i].pos;
@@ -42,6 +42,11 @@ int main(int argc, char **argv){
     COMM::IOParams<int> dt_out_power_index (input_par_store, 2, "power index of 0.5 for output time interval"); // output time interval
     COMM::IOParams<double> ds_scale     (input_par_store, 1.0,  "step size scaling factor for Ar integration");    // step size scaling factor
     COMM::IOParams<int>   interrupt_detection_option(input_par_store, 0, "modify orbits and check interruption: 0: turn off; 1: modify the binary orbits based on detetion criterion; 2. modify and also interrupt integrations");  // modify orbit or check interruption using modifyAndInterruptIter function
+    COMM::IOParams<int>   precision_extend_option(input_par_store, 0, "use the extended precision mode in AR when the round-off error dominates","0: off"); // adaptive extended precision
+    COMM::IOParams<int>   ds_control_option(input_par_store, 0, "AR step size control: 0: reduce and recover by backup levels; 1: predictive (PI) controller"); // AR step size control
+    COMM::IOParams<int>   time_sync_option(input_par_store, 0, "AR time synchronization: 0: by sub-step time table and step enlargement; 1: one-shot estimation with Newton correction"); // AR time synchronization
+    COMM::IOParams<int>   extrapolation_option(input_par_store, 0, "AR integration method: 0: symplectic step; 1: Gragg-Bulirsch-Stoer extrapolation of the symplectic step (use with 2nd order)"); // AR extrapolation driver
+    COMM::IOParams<int>   extrapolation_stage_max(input_par_store, 8, "maximum number of AR extrapolation stages"); // maximum extrapolation stages
     COMM::IOParams<double> energy_error (input_par_store, 1e-10,"relative energy error limit for AR"); // phase error requirement
     COMM::IOParams<double> time_error   (input_par_store, 0.0, "time synchronization absolute error limit for AR","default is 0.25*dt-min"); // time synchronization error
     COMM::IOParams<double> time_zero    (input_par_store, 0.0, "initial physical time");    // initial physical time
@@ -57,6 +62,15 @@ int main(int argc, char **argv){
     COMM::IOParams<double> slowdown_mass_ref (input_par_store, 0.0, "slowdowm mass reference","averaged mass"); // slowdown mass reference
 #endif
     COMM::IOParams<double> slowdown_timescale_max (input_par_store, 0.0, "maximum timescale for maximum slowdown factor","time-end"); // slowdown timescale
+    COMM::IOParams<double> kepler_pert_ratio (input_par_store, 0.0, "use Kepler drift for binaries with perturbation ratio below this value","0: off"); // Kepler drift threshold
+    COMM::IOParams<int> n_group_ar_parallel_min (input_par_store, 0, "minimum number of groups to integrate AR groups in parallel","0: serial"); // parallel AR integration threshold
+    COMM::IOParams<int> ac_step_ratio (input_par_store, 1, "number of irregular steps per regular step in Ahmad-Cohen scheme","1: no Ahmad-Cohen"); // Ahmad-Cohen step ratio
+    COMM::IOParams<double> tree_theta (input_par_store, 0.0, "opening angle of octree for far-field force","0: direct summation"); // tree opening angle
+    COMM::IOParams<int> predict_stale_only (input_par_store, 0, "only predict particles not at the prediction time","0: predict all"); // stale-only prediction
+    COMM::IOParams<int> n_thread (input_par_store, 0, "number of threads of taskflow executor","0: hardware concurrency"); // number of threads
+    COMM::IOParams<int> reproducible (input_par_store, 0, "results do not depend on the number of threads","0: off"); // reproducible mode
+    COMM::IOParams<std::string> snapshot (input_par_store, "", "filename to write particles in binary format at the end",""); // final snapshot
+    COMM::IOParams<int> energy_from_pot (input_par_store, 0, "calculate potential energy from particle potentials at synchronized output times","0: off"); // energy from pot
     COMM::IOParams<std::string> filename_par (input_par_store, "", "filename to load manager parameters","input name"); // par dumped filename
 
     int copt;
@@ -77,9 +91,23 @@ int main(int argc, char **argv){
         {"slowdown-mass-ref",required_argument, 0, 12},
 #endif
         {"slowdown-timescale-max",required_argument, 0, 13},
+        {"kepler-pert-ratio",required_argument, 0, 25},
+        {"precision-extend",required_argument, 0, 26},
+        {"ds-control",required_argument, 0, 27},
+        {"time-sync",required_argument, 0, 28},
+        {"extrapolation",required_argument, 0, 29},
+        {"extrapolation-stage-max",required_argument, 0, 30},
         {"print-width",required_argument, 0, 14},
         {"print-precision",required_argument, 0, 15},
         {"ds-scale",required_argument, 0, 16},
+        {"ar-parallel-min",required_argument, 0, 17},
+        {"ac-step-ratio",required_argument, 0, 18},
+        {"tree-theta",   required_argument, 0, 19},
+        {"predict-stale-only", required_argument, 0, 20},
+        {"n-thread", required_argument, 0, 21},
+        {"reproducible", required_argument, 0, 22},
+        {"snapshot", required_argument, 0, 23},
+        {"energy-from-pot", required_argument, 0, 24},
         {"help",no_argument, 0, 'h'},
         {0,0,0,0}
     };
@@ -122,6 +150,24 @@ int main(int argc, char **argv){
         case 13:
             slowdown_timescale_max.value = atof(optarg);
             break;
+        case 25:
+            kepler_pert_ratio.value = atof(optarg);
+            break;
+        case 26:
+            precision_extend_option.value = atoi(optarg);
+            break;
+        case 27:
+            ds_control_option.value = atoi(optarg);
+            break;
+        case 28:
+            time_sync_option.value = atoi(optarg);
+            break;
+        case 29:
+            extrapolation_option.value = atoi(optarg);
+            break;
+        case 30:
+            extrapolation_stage_max.value = atoi(optarg);
+            break;
         case 14:
             print_width.value = atof(optarg);
             break;
@@ -131,6 +177,30 @@ int main(int argc, char **argv){
         case 16:
             ds_scale.value = atof(optarg);
             break;
+        case 17:
+            n_group_ar_parallel_min.value = atoi(optarg);
+            break;
+        case 18:
+            ac_step_ratio.value = atoi(optarg);
+            break;
+        case 19:
+            tree_theta.value = atof(optarg);
+            break;
+        case 20:
+            predict_stale_only.value = atoi(optarg);
+            break;
+        case 21:
+            n_thread.value = atoi(optarg);
+            break;
+        case 22:
+            reproducible.value = atoi(optarg);
+            break;
+        case 23:
+            snapshot.value = optarg;
+            break;
+        case 24:
+            energy_from_pot.value = atoi(optarg);
+            break;
         case 't':
             time_end.value = atof(optarg);
             break;
@@ -172,6 +242,14 @@ int main(int argc, char **argv){
                      <<"  2-(N+1) line:  mass, x, y, z, vx, vy, vz, radius\n"
                      <<"  last    line:  N_group, group_offset_index_lst[N_group], group_member_particle_index[N_member_total]\n"
                      <<"Options: (*) show defaulted values\n"
+                     <<"          --ac-step-ratio   [int]: "<<ac_step_ratio<<"\n"
+                     <<"          --tree-theta    [Float]: "<<tree_theta<<"\n"
+                     <<"          --predict-stale-only [int]: "<<predict_stale_only<<"\n"
+                     <<"          --n-thread      [int]: "<<n_thread<<"\n"
+                     <<"          --reproducible  [int]: "<<reproducible<<"\n"
+                     <<"          --snapshot   [string]: "<<snapshot<<"\n"
+                     <<"          --energy-from-pot [int]: "<<energy_from_pot<<"\n"
+                     <<"          --ar-parallel-min [int]: "<<n_group_ar_parallel_min<<"\n"
                      <<"          --dt-max-power [Float]:  "<<dt_max_power_index<<"\n"
                      <<"          --dt-min-power [int]  :  "<<dt_min_power_index<<"\n"
                      <<"          --ds-scale     [Float]:  "<<ds_scale<<"\n"
@@ -197,6 +275,12 @@ int main(int argc, char **argv){
                      <<"          --slowdown-mass-ref       [Float]: "<<slowdown_mass_ref<<"\n"
 #endif
                      <<"          --slowdown-timescale-max: [Float]: "<<slowdown_timescale_max<<"\n"
+                     <<"          --kepler-pert-ratio:      [Float]: "<<kepler_pert_ratio<<"\n"
+                     <<"          --precision-extend:       [int]:   "<<precision_extend_option<<"\n"
+                     <<"          --ds-control:             [int]:   "<<ds_control_option<<"\n"
+                     <<"          --time-sync:              [int]:   "<<time_sync_option<<"\n"
+                     <<"          --extrapolation:          [int]:   "<<extrapolation_option<<"\n"
+                     <<"          --extrapolation-stage-max: [int]:  "<<extrapolation_stage_max<<"\n"
                      <<"    -t [Float]:  "<<time_end<<"\n"
                      <<"          --time-start   [Float]:  "<<time_zero<<"\n"
                      <<"          --time-end     [Float]:  same as -t\n"
@@ -229,6 +313,12 @@ int main(int argc, char **argv){
     Float dt_max = pow(Float(0.5), Float(dt_max_power_index.value));
     manager.step.setDtRange(dt_max, dt_min_power_index.value);
     manager.interaction.eps_sq = eps_sq.value;
+    manager.n_group_ar_parallel_min = n_group_ar_parallel_min.value;
+    manager.ac_step_ratio = ac_step_ratio.value;
+    manager.tree_theta = tree_theta.value;
+    manager.predict_stale_only = predict_stale_only.value;
+    manager.reproducible_flag = reproducible.value;
+    manager.energy_from_pot = energy_from_pot.value;
     manager.interaction.gravitational_constant = grav_const.value;
     ar_manager.interaction.eps_sq = eps_sq.value;
     ar_manager.interaction.gravitational_constant = grav_const.value;
@@ -243,10 +333,16 @@ int main(int argc, char **argv){
     ar_manager.slowdown_pert_ratio_ref = slowdown_ref.value;
     if (slowdown_timescale_max.value>0.0) ar_manager.slowdown_timescale_max = slowdown_timescale_max.value;
     else ar_manager.slowdown_timescale_max = time_end.value;
+    ar_manager.kepler_pert_ratio_max = kepler_pert_ratio.value;
     ar_manager.step_count_max = nstep_max.value;
     // set symplectic order
     ar_manager.step.initialSymplecticCofficients(sym_order.value);
     ar_manager.interrupt_detection_option = interrupt_detection_option.value;
+    ar_manager.precision_extend_option = precision_extend_option.value;
+    ar_manager.ds_control_option = ds_control_option.value;
+    ar_manager.time_sync_option = time_sync_option.value;
+    ar_manager.extrapolation_option = extrapolation_option.value;
+    ar_manager.extrapolation_stage_max = extrapolation_stage_max.value;
 
     // store input parameters
     std::string fpar_out = std::string(filename) + ".par";
@@ -294,6 +390,8 @@ int main(int argc, char **argv){
 
     h4_int.groups.setMode(COMM::ListMode::local);
     h4_int.groups.reserveMem(h4_int.particles.getSize());
+    // the executor is created at the first call, the number of workers is fixed after that
+    TF::Manager::get_executor(n_thread.value);
     h4_int.reserveIntegratorMem();
     // initial system 
     h4_int.initialSystemSingle(time_zero.value);
@@ -391,6 +489,24 @@ int main(int argc, char **argv){
         }
     }
 
+    // the energy from potentials is approximate with the Ahmad-Cohen scheme or the octree, check with the full recalculation
+    if (energy_from_pot.value) {
+        h4_int.calcEnergySlowDown(false, true);
+        std::cerr<<"Energy error (full recalculation): "<<h4_int.getEnergyError()<<" slowdown: "<<h4_int.getEnergyErrorSlowDown()<<std::endl;
+    }
+
+    // final snapshot
+    if (snapshot.value!="") {
+        h4_int.writeBackGroupMembers();
+        std::FILE* fsnap = std::fopen(snapshot.value.c_str(),"w");
+        if (fsnap==NULL) {
+            std::cerr<<"Error: snapshot file "<<snapshot.value<<" cannot be open!\n";
+            abort();
+        }
+        h4_int.particles.writeBinary(fsnap);
+        fclose(fsnap);
+    }
+
     //fpu_fix_end(&oldcw);
 
     return 0;
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <vector>
 #include "Common/Float.h"
+#include "Common/taskflow_manager.h"
 
 //! hermite interaction class 
 class HermiteInteraction{
@@ -86,6 +88,30 @@ public:
         return dr2;
     }
 
+#ifdef HERMITE_SIMD
+    //! calculate acceleration, jerk and potential of one i particle from singles in the SoA buffer
+    /*! The SIMD version of calcAccJerkPairSingleSingle for the range [_j_start, _j_end) of the buffer, used by the Hermite integrator when HERMITE_SIMD is defined. It should use the same force law, see H4::calcAccJerkPotSoA
+      @param[in,out]: _fi: acceleration, jerk and potential for i particle
+      @param[out]: _r2: distance square to each j particle, -1 for skipped ones
+      @param[in]: _pj: j particle buffer
+      @param[in]: _pos: position of i
+      @param[in]: _vel: velocity of i
+      @param[in]: _id: id of i
+      @param[in]: _j_start: start index of j particles
+      @param[in]: _j_end: end index of j particles (not included)
+     */
+    inline void calcAccJerkPotSoA(H4::ForceH4& _fi,
+                                  Float* _r2,
+                                  const H4::JParticleSoA& _pj,
+                                  const Float* _pos,
+                                  const Float* _vel,
+                                  const Float _id,
+                                  const int _j_start,
+                                  const int _j_end) {
+        H4::calcAccJerkPotSoA(_fi.acc0, _fi.acc1, _fi.pot, _r2, _pj, _pos, _vel, _id, gravitational_constant, eps_sq, _j_start, _j_end);
+    }
+#endif
+
     //! calculate acceleration and jerk of one pair single and resolved group
     /*! 
       @param[out]: _fi: acceleration for i particle
@@ -357,8 +383,32 @@ public:
         return -gravitational_constant*pi.mass*pj.mass*rinv;
     }
 
-    //! calculate kinetic and potential energy of the system
+    //! calculate potential of one particle from particles with smaller indices
     /*!
+      @param[in] _particles: (all) particle list
+      @param[in] _i: index of i particle
+     */
+    template<class Tp>
+    inline Float calcPotLower(const Tp* _particles, const int _i) {
+        auto& pi = _particles[_i];
+        Float poti = 0.0;
+        for (int j=0; j<_i; j++) {
+            auto& pj = _particles[j];
+            const Float dr[3] = {pj.pos[0] - pi.pos[0], 
+                                 pj.pos[1] - pi.pos[1],
+                                 pj.pos[2] - pi.pos[2]};
+            Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
+            Float dr2_eps = dr2 + eps_sq;
+            const Float r = sqrt(dr2_eps);
+            ASSERT(r>0.0);
+            const Float rinv = 1.0/r;
+            poti += -gravitational_constant*pj.mass*rinv;
+        }
+        return poti;
+    }
+
+    //! calculate kinetic and potential energy of the system
+    /*! The potentials of particles are calculated in parallel by taskflow if more than one thread is used and the number of particles is large, then summed in the index order, thus the result does not depend on the number of threads.
       @param[out] _energy: hermite energy
       @param[in] _particles: (all) particle list
       @param[in] _n_particle: number of particles
@@ -370,24 +420,29 @@ public:
     template<class Tp, class Tgroup, class Tpert>
     inline void calcEnergy(H4::HermiteEnergy& _energy, const Tp* _particles, const int _n_particle, const Tgroup* _groups, const int* _group_index, const int _n_group, const Tpert& _perturber) {
         _energy.ekin = _energy.epot = _energy.epert = 0.0;
-        for (int i=0; i<_n_particle; i++) {
-            auto& pi = _particles[i];
-            _energy.ekin += pi.mass* (pi.vel[0]*pi.vel[0] + pi.vel[1]*pi.vel[1] + pi.vel[2]*pi.vel[2]);
-            Float poti = 0.0;
-            for (int j=0; j<i; j++) {
-                if (i==j) continue;
-                auto& pj = _particles[j];
-                const Float dr[3] = {pj.pos[0] - pi.pos[0], 
-                                     pj.pos[1] - pi.pos[1],
-                                     pj.pos[2] - pi.pos[2]};
-                Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
-                Float dr2_eps = dr2 + eps_sq;
-                const Float r = sqrt(dr2_eps);
-                ASSERT(r>0.0);
-                const Float rinv = 1.0/r;
-                poti += -gravitational_constant*pj.mass*rinv;
+        const int n_task = TF::Manager::get_executor().num_workers();
+        if (n_task>1 && _n_particle>=256) {
+            std::vector<Float> pot(_n_particle);
+            tf::Taskflow flow;
+            // cyclic distribution to balance the triangle loop
+            for (int t=0; t<n_task; t++) {
+                flow.emplace([&, t](){
+                    for (int i=t; i<_n_particle; i+=n_task) pot[i] = calcPotLower(_particles, i);
+                });
+            }
+            TF::Manager::get_executor().run(flow).wait();
+            for (int i=0; i<_n_particle; i++) {
+                auto& pi = _particles[i];
+                _energy.ekin += pi.mass* (pi.vel[0]*pi.vel[0] + pi.vel[1]*pi.vel[1] + pi.vel[2]*pi.vel[2]);
+                _energy.epot += pot[i]*pi.mass;
+            }
+        }
+        else {
+            for (int i=0; i<_n_particle; i++) {
+                auto& pi = _particles[i];
+                _energy.ekin += pi.mass* (pi.vel[0]*pi.vel[0] + pi.vel[1]*pi.vel[1] + pi.vel[2]*pi.vel[2]);
+                _energy.epot += calcPotLower(_particles, i)*pi.mass;
             }
-            _energy.epot += poti*pi.mass;
         }
 
         _energy.ekin *= 0.5;
@@ -4,21 +4,24 @@
 #include <iomanip>
 #include <cmath>
 #include <cassert>
+#include <vector>
 
 #define ASSERT(x) assert(x)
 
 #include "Common/Float.h"
 #include "Common/binary_tree.h"
+#include "Common/kepler_universal.h"
 #include "particle.h"
 
 int main(int argc, char **argv){
    bool iflag=false;
    int num=1;
    int unit=0;
+   Float dt=0.0;
    int width = WRITE_WIDTH;
    int precision = WRITE_PRECISION;
    int copt;
-   while ((copt = getopt(argc, argv, "in:w:p:u:h")) != -1)
+   while ((copt = getopt(argc, argv, "in:w:p:u:t:h")) != -1)
        switch (copt) {
        case 'i':
            iflag=true;
@@ -35,6 +38,9 @@ int main(int argc, char **argv){
        case 'u':
            unit=atoi(optarg);
            break;
+       case 't':
+           dt=atof(optarg);
+           break;
        case 'h':
            std::cout<<"keplerorbit [option] datafilename\n"
                     <<"    pariticle data (two lines): \n";
@@ -44,6 +50,7 @@ int main(int argc, char **argv){
            std::cout<<"\nOptions: (*) show defaulted values\n"
                     <<"   -i:        read particle data, output kepler orbit data (one line)\n"
                     <<"   -n [int]:  number of pairs(1)\n"
+                    <<"   -t [Float]: evolve pairs by the Kepler motion for this time before output("<<dt<<")\n"
                     <<"   -w [int]:  print width("<<width<<")\n"
                     <<"   -p [int]:  print precision("<<precision<<")\n"
                     <<"   -u [int]:  0: unscale \n"
@@ -87,6 +94,9 @@ int main(int argc, char **argv){
    if (unit>0) G = twopi*twopi; // AU^3 yr^-2 M_sun^-1
    if (unit==4) G = 0.00449830997959438; // (pc/myr)^2 pc M_sun^-1
 
+   // pairs in the computing units
+   std::vector<Particle> ptcl(2*num);
+
    if(iflag) {
        for(int i=0; i<num; i++) {
            p[0].readAscii(fs);
@@ -97,8 +107,6 @@ int main(int argc, char **argv){
                abort();
            }
 
-           bin.calcCenterOfMass();
-
            if(unit==2||unit==3) {
                // km/s -> AU/yr
                for (int k=0; k<2; k++) {
@@ -116,12 +124,8 @@ int main(int argc, char **argv){
                    }
                }
            }
-
-           bin.calcOrbit(G);
-           // yr -> days
-           if (unit>1&&unit!=4) bin.period *= 365.25;
-           bin.printColumn(std::cout, width);
-           std::cout<<std::endl;
+           ptcl[2*i] = p[0];
+           ptcl[2*i+1] = p[1];
        }
    }
    else {
@@ -146,6 +150,76 @@ int main(int argc, char **argv){
                for (int j=0; j<3; j++) {
                    p[k].pos[j] += bin.pos[j];
                    p[k].vel[j] += bin.vel[j];
+               }
+           }
+           ptcl[2*i] = p[0];
+           ptcl[2*i+1] = p[1];
+       }
+   }
+
+   // evolve all pairs together
+   if (dt!=0.0) {
+       std::vector<Float> gm(num), dts(num, dt), x(num), y(num), z(num), vx(num), vy(num), vz(num);
+       for(int i=0; i<num; i++) {
+           Particle& p1 = ptcl[2*i];
+           Particle& p2 = ptcl[2*i+1];
+           gm[i] = G*(p1.mass+p2.mass);
+           x[i]  = p2.pos[0] - p1.pos[0];
+           y[i]  = p2.pos[1] - p1.pos[1];
+           z[i]  = p2.pos[2] - p1.pos[2];
+           vx[i] = p2.vel[0] - p1.vel[0];
+           vy[i] = p2.vel[1] - p1.vel[1];
+           vz[i] = p2.vel[2] - p1.vel[2];
+       }
+       int n_fail = COMM::KeplerUniversal::propagateBatch(num, gm.data(), dts.data(), x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data());
+       if (n_fail>0) {
+           std::cerr<<"Error: universal Kepler solver cannot converge for "<<n_fail<<" pairs!"<<std::endl;
+           abort();
+       }
+       for(int i=0; i<num; i++) {
+           Particle& p1 = ptcl[2*i];
+           Particle& p2 = ptcl[2*i+1];
+           Float mtot = p1.mass + p2.mass;
+           Float m1_mt = p1.mass/mtot;
+           Float m2_mt = p2.mass/mtot;
+           Float drel[6] = {x[i], y[i], z[i], vx[i], vy[i], vz[i]};
+           for (int j=0; j<3; j++) {
+               Float pcm = (p1.mass*p1.pos[j] + p2.mass*p2.pos[j])/mtot + dt*(p1.mass*p1.vel[j] + p2.mass*p2.vel[j])/mtot;
+               Float vcm = (p1.mass*p1.vel[j] + p2.mass*p2.vel[j])/mtot;
+               p1.pos[j] = pcm - m2_mt*drel[j];
+               p2.pos[j] = pcm + m1_mt*drel[j];
+               p1.vel[j] = vcm - m2_mt*drel[j+3];
+               p2.vel[j] = vcm + m1_mt*drel[j+3];
+           }
+       }
+   }
+
+   if(iflag) {
+       for(int i=0; i<num; i++) {
+           // c.m. in the input units
+           for (int k=0; k<2; k++) {
+               p[k] = ptcl[2*i+k];
+               for (int j=0; j<3; j++) {
+                   if (unit==2||unit==3) p[k].vel[j] /= kms2auyr;
+                   if (unit==3) p[k].pos[j] /= pc2au;
+               }
+           }
+           bin.calcCenterOfMass();
+           p[0] = ptcl[2*i];
+           p[1] = ptcl[2*i+1];
+           bin.calcOrbit(G);
+           // yr -> days
+           if (unit>1&&unit!=4) bin.period *= 365.25;
+           bin.printColumn(std::cout, width);
+           std::cout<<std::endl;
+       }
+   }
+   else {
+       for(int i=0; i<num; i++) {
+           p[0] = ptcl[2*i];
+           p[1] = ptcl[2*i+1];
+           for (int k=0; k<2; k++) {
+               for (int j=0; j<3; j++) {
                    if (unit==2||unit==3) p[k].vel[j] /= kms2auyr;
                    if (unit==3) p[k].pos[j] /= pc2au;
                }
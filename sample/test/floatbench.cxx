@@ -0,0 +1,140 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <getopt.h>
+#include <cassert>
+#define ASSERT(expr) assert(expr)
+#define DATADUMP(x) abort()
+
+#include "Common/Float.h"
+#include "AR/symplectic_integrator.h"
+#include "Hermite/hermite_integrator.h"
+#include "hermite_interaction.h"
+
+//! benchmark of the AR and Hermite force kernels with the current Float type
+/*! Build with different Float types (see Makefile: floatbench.double, floatbench.ddfma and floatbench.qd) and compare the time per pair interaction
+ */
+
+struct BenchParticle{
+    Float mass;
+    Float pos[3];
+    Float vel[3];
+};
+
+#ifdef USE_QD
+const char* float_name = "qd_real (QD)";
+#elif USE_DD
+const char* float_name = "dd_real (QD)";
+#elif USE_DD_FMA
+const char* float_name = "COMM::DoubleDouble";
+#else
+const char* float_name = "double";
+#endif
+
+//! AR inner force kernel for groups of _n_member members
+/*! \return time per pair interaction in nanoseconds
+ */
+template <int N>
+double benchAR(const std::vector<BenchParticle>& _p, const int _n_loop, Float& _check) {
+    const int n_group = _p.size()/N;
+    std::vector<AR::Force> force(N);
+    Float epot, gt_kick_inv;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int k=0; k<_n_loop; k++) {
+        for (int g=0; g<n_group; g++) {
+            AR::calcInnerAccPotAndGTKickInvSmallN(gt_kick_inv, force.data(), epot, &_p[g*N], N, Float(1.0), Float(0.0));
+            _check += epot + force[0].acc_in[0];
+        }
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const double n_pair = double(_n_loop)*n_group*N*(N-1);
+    return std::chrono::duration<double, std::nano>(t1-t0).count()/n_pair;
+}
+
+//! Hermite acceleration and jerk of all pairs
+/*! \return time per pair interaction in nanoseconds
+ */
+double benchHermite(const std::vector<BenchParticle>& _p, const int _n_loop, Float& _check) {
+    HermiteInteraction interaction;
+    interaction.eps_sq = 0.0;
+    interaction.gravitational_constant = 1.0;
+    const int n = _p.size();
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int k=0; k<_n_loop; k++) {
+        for (int i=0; i<n; i++) {
+            H4::ForceH4 f;
+            for (int j=0; j<n; j++) {
+                if (i==j) continue;
+                interaction.calcAccJerkPairSingleSingle(f, _p[i], _p[j]);
+            }
+            _check += f.acc0[0] + f.acc1[0] + f.pot;
+        }
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const double n_pair = double(_n_loop)*n*(n-1);
+    return std::chrono::duration<double, std::nano>(t1-t0).count()/n_pair;
+}
+
+int main(int argc, char **argv) {
+    int n_particle = 240;
+    int n_loop = 100;
+
+    int copt;
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {0,0,0,0}
+    };
+    int option_index;
+    while ((copt = getopt_long(argc, argv, "n:l:h", long_options, &option_index)) != -1)
+        switch (copt) {
+        case 'n':
+            n_particle = atoi(optarg);
+            assert(n_particle>=4);
+            break;
+        case 'l':
+            n_loop = atoi(optarg);
+            assert(n_loop>0);
+            break;
+        case 'h':
+            std::cout<<"floatbench [option]\n"
+                     <<"Benchmark of AR and Hermite force kernels with Float = "<<float_name<<"\n"
+                     <<"Options: (*) show defaulted values\n"
+                     <<"    -n [int]:  number of particles ("<<n_particle<<")\n"
+                     <<"    -l [int]:  number of loops ("<<n_loop<<")\n"
+                     <<"    -h(--help): help\n";
+            return 0;
+        default:
+            std::cerr<<"Unknown argument. check '-h' for help.\n";
+            abort();
+        }
+
+    std::mt19937 gen(12345);
+    std::uniform_real_distribution<double> uni(-1.0, 1.0);
+    std::vector<BenchParticle> p(n_particle);
+    for (auto& pi: p) {
+        pi.mass = 1.0/n_particle;
+        for (int k=0; k<3; k++) {
+            pi.pos[k] = uni(gen);
+            pi.vel[k] = uni(gen);
+        }
+    }
+
+    Float check = 0.0;
+    const double t_ar2 = benchAR<2>(p, n_loop*n_particle, check);
+    const double t_ar3 = benchAR<3>(p, n_loop*n_particle, check);
+    const double t_ar4 = benchAR<4>(p, n_loop*n_particle, check);
+    const double t_h4  = benchHermite(p, n_loop, check);
+
+    std::cout<<"Float: "<<float_name<<"  sizeof: "<<sizeof(Float)<<"  N: "<<n_particle<<"  loops: "<<n_loop<<std::endl;
+    std::cout<<std::setw(24)<<"kernel"<<std::setw(16)<<"ns/pair"<<std::endl;
+    std::cout<<std::setw(24)<<"AR inner (2 members)"<<std::setw(16)<<t_ar2<<std::endl;
+    std::cout<<std::setw(24)<<"AR inner (3 members)"<<std::setw(16)<<t_ar3<<std::endl;
+    std::cout<<std::setw(24)<<"AR inner (4 members)"<<std::setw(16)<<t_ar4<<std::endl;
+    std::cout<<std::setw(24)<<"Hermite acc/jerk"<<std::setw(16)<<t_h4<<std::endl;
+    std::cout<<"check sum: "<<std::setprecision(WRITE_PRECISION)<<check<<std::endl;
+
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <getopt.h>
+#include <cassert>
+#define ASSERT(expr) assert(expr)
+#define DATADUMP(x) abort()
+
+#include "Common/Float.h"
+#include "Common/binary_tree.h"
+#include "AR/symplectic_integrator.h"
+#include "AR/information.h"
+#include "particle.h"
+#include "perturber.h"
+#include "interaction.h"
+
+//! cost/accuracy benchmark of the AR step methods on hard few-body systems
+/*! Compare the Yoshida symplectic steps of different orders with the Gragg-Bulirsch-Stoer extrapolation driver over the 2nd order step (manager.extrapolation_option=1).
+  The accuracy of the symplectic steps is controlled by ds_scale (the energy error limit only rejects steps), and that of the extrapolation driver by the energy error limit.
+  The one-shot time synchronization (manager.time_sync_option=1) is used for all methods.
+  The cost is the number of force calculations and the wall-clock time, the accuracy is the relative energy error at the end
+  and the maximum position difference to a reference run (extrapolation driver with the smallest energy error limit / 10).
+  Build with and without AR_TTL (see Makefile: stepbench.logh and stepbench.ttl)
+ */
+
+using namespace AR;
+
+typedef TimeTransformedSymplecticIntegrator<Particle, Particle, Perturber, Interaction, Information<Particle,Particle>> ARInt;
+
+//! few-body initial condition
+struct BenchSystem{
+    std::string name;
+    std::vector<Particle> p;
+    Float time_end;
+};
+
+//! result of one run
+struct BenchResult{
+    long long unsigned int n_step;
+    long long unsigned int n_force;
+    double wtime; // in milliseconds
+    Float de_rel;
+    std::vector<Float> pos;
+};
+
+//! equal mass binary with eccentricity _ecc and semi-major axis 1 starting from the apo-center, integrated for 10 periods
+BenchSystem eccentricBinary(const Float _ecc) {
+    BenchSystem sys;
+    std::stringstream ss;
+    ss<<"binary_e"<<_ecc;
+    sys.name = ss.str();
+    const Float m = 0.5, semi = 1.0;
+    const Float r_apo = semi*(1.0+_ecc);
+    const Float v_apo = std::sqrt(2.0*m*(1.0-_ecc)/r_apo);
+    sys.p.resize(2);
+    sys.p[0].mass = sys.p[1].mass = m;
+    sys.p[0].pos[0] = -0.5*r_apo;
+    sys.p[1].pos[0] =  0.5*r_apo;
+    sys.p[0].vel[1] = -0.5*v_apo;
+    sys.p[1].vel[1] =  0.5*v_apo;
+    sys.time_end = 10*COMM::Binary::semiToPeriod(semi, 2*m, 1.0);
+    return sys;
+}
+
+//! Pythagorean three-body problem (Burrau 1913), masses 3, 4, 5 at rest, with several close encounters before t=10
+BenchSystem pythagorean() {
+    BenchSystem sys;
+    sys.name = "pythagorean";
+    const Float mass[3] = {3.0, 4.0, 5.0};
+    const Float pos[3][2] = {{1.0, 3.0}, {-2.0, -1.0}, {1.0, -1.0}};
+    sys.p.resize(3);
+    for (int i=0; i<3; i++) {
+        sys.p[i].mass = mass[i];
+        sys.p[i].pos[0] = pos[i][0];
+        sys.p[i].pos[1] = pos[i][1];
+    }
+    sys.time_end = 10.0;
+    return sys;
+}
+
+//! integrate the system to time_end with n_sync time synchronization points
+/*! @param[in] _sym_order: symplectic order (see SymplecticStep::initialSymplecticCofficients)
+    @param[in] _extrapolation: extrapolation option of the manager
+    @param[in] _energy_error: energy error limit
+    @param[in] _ds_scale: step size scaling factor
+ */
+BenchResult run(const BenchSystem& _sys, const int _sym_order, const int _extrapolation, const Float _energy_error, const Float _ds_scale, const int _n_sync) {
+    TimeTransformedSymplecticManager<Interaction> manager;
+    manager.interaction.gravitational_constant = 1.0;
+    manager.time_step_min = 1e-13;
+    manager.time_error_max = 0.25e-13;
+    manager.energy_error_relative_max = _energy_error;
+    manager.slowdown_timescale_max = NUMERIC_FLOAT_MAX;
+    manager.slowdown_pert_ratio_ref = 1e-6;
+    manager.step_count_max = 100000000;
+    manager.ds_scale = _ds_scale;
+    manager.time_sync_option = 1;
+    manager.step.initialSymplecticCofficients(_sym_order);
+    manager.extrapolation_option = _extrapolation;
+
+    ARInt sym_int;
+    sym_int.manager = &manager;
+    const int n = _sys.p.size();
+    sym_int.particles.setMode(COMM::ListMode::local);
+    sym_int.particles.reserveMem(n);
+    for (int i=0; i<n; i++) {
+        sym_int.particles.addMember(_sys.p[i]);
+        sym_int.particles[i].id = i+1;
+    }
+    sym_int.reserveIntegratorMem();
+    sym_int.particles.calcCenterOfMass();
+    sym_int.info.reserveMem(n);
+    sym_int.info.generateBinaryTree(sym_int.particles, manager.interaction.gravitational_constant);
+    sym_int.info.r_break_crit = 1e-3;
+    sym_int.initialIntegration(0.0);
+    sym_int.info.calcDsAndStepOption(manager.step.getOrder(), manager.interaction.gravitational_constant, manager.ds_scale);
+    sym_int.info.fix_step_option = FixStepOption::none;
+
+    const Float etot0 = sym_int.getEkin() + sym_int.getEpot();
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i=1; i<=_n_sync; i++) sym_int.integrateToTime(_sys.time_end*i/_n_sync);
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    BenchResult res;
+    auto& prof = sym_int.profile;
+    const int cd_pair_size = manager.step.getCDPairSize();
+    res.n_step = prof.step_count_sum;
+    // each symplectic (sub-)step calculates the force cd_pair_size times, the extrapolation recalculates the force once per step
+    if (_extrapolation>0) res.n_force = prof.step_count_extrapolation_sum*cd_pair_size + prof.step_count_sum;
+    else res.n_force = prof.step_count_sum*cd_pair_size;
+    res.wtime = std::chrono::duration<double, std::milli>(t1-t0).count();
+    res.de_rel = abs((sym_int.getEkin() + sym_int.getEpot() - etot0)/etot0);
+    for (int i=0; i<n; i++)
+        for (int k=0; k<3; k++) res.pos.push_back(sym_int.particles[i].pos[k]);
+    return res;
+}
+
+//! maximum position difference relative to the maximum distance to the c.m. in the reference
+Float posDiff(const BenchResult& _res, const BenchResult& _ref) {
+    Float dmax = 0.0, rmax = 0.0;
+    for (size_t i=0; i<_ref.pos.size(); i+=3) {
+        Float d2 = 0.0, r2 = 0.0;
+        for (int k=0; k<3; k++) {
+            const Float dx = _res.pos[i+k] - _ref.pos[i+k];
+            d2 += dx*dx;
+            r2 += _ref.pos[i+k]*_ref.pos[i+k];
+        }
+        dmax = std::max(dmax, d2);
+        rmax = std::max(rmax, r2);
+    }
+    return std::sqrt(dmax/rmax);
+}
+
+int main(int argc, char **argv) {
+    Float energy_error_min = 1e-13;
+    Float energy_error_max = 1e-7;
+    Float ds_scale_min = 0.125;
+    Float ds_scale_max = 2.0;
+    int n_sync = 10;
+
+    int copt;
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {0,0,0,0}
+    };
+    int option_index;
+    while ((copt = getopt_long(argc, argv, "e:E:s:S:n:h", long_options, &option_index)) != -1)
+        switch (copt) {
+        case 'e':
+            energy_error_min = atof(optarg);
+            assert(energy_error_min>0.0);
+            break;
+        case 'E':
+            energy_error_max = atof(optarg);
+            assert(energy_error_max>0.0);
+            break;
+        case 's':
+            ds_scale_min = atof(optarg);
+            assert(ds_scale_min>0.0);
+            break;
+        case 'S':
+            ds_scale_max = atof(optarg);
+            assert(ds_scale_max>0.0);
+            break;
+        case 'n':
+            n_sync = atoi(optarg);
+            assert(n_sync>0);
+            break;
+        case 'h':
+            std::cout<<"stepbench [option]\n"
+                     <<"Cost/accuracy benchmark of AR symplectic steps and the extrapolation driver\n"
+                     <<"Options: (*) show defaulted values\n"
+                     <<"    -e [Float]:  minimum energy error limit of the extrapolation driver ("<<energy_error_min<<")\n"
+                     <<"    -E [Float]:  maximum energy error limit of the extrapolation driver, also used for the symplectic steps ("<<energy_error_max<<")\n"
+                     <<"    -s [Float]:  minimum ds_scale of the symplectic steps ("<<ds_scale_min<<")\n"
+                     <<"    -S [Float]:  maximum ds_scale of the symplectic steps ("<<ds_scale_max<<")\n"
+                     <<"    -n [int]:    number of time synchronization points ("<<n_sync<<")\n"
+                     <<"    -h(--help): help\n";
+            return 0;
+        default:
+            std::cerr<<"Unknown argument. check '-h' for help.\n";
+            abort();
+        }
+
+    // method: symplectic order and extrapolation option
+    struct Method{
+        const char* name;
+        int sym_order;
+        int extrapolation;
+    };
+    const Method methods[] = {{"sym4", 4, 0}, {"sym6", 6, 0}, {"sym-6", -6, 0}, {"sym8", 8, 0}, {"sym-8", -8, 0}, {"gbs2", 2, 1}};
+
+    std::vector<BenchSystem> systems = {eccentricBinary(0.9), eccentricBinary(0.999), pythagorean()};
+
+#ifdef AR_TTL
+    std::cout<<"Time transformation: TTL\n";
+#else
+    std::cout<<"Time transformation: logH\n";
+#endif
+    const int w=14;
+    for (auto& sys: systems) {
+        const BenchResult ref = run(sys, 2, 1, 0.1*energy_error_min, 1.0, n_sync);
+        std::cout<<"System: "<<sys.name<<"  N: "<<sys.p.size()<<"  time_end: "<<sys.time_end<<"  reference: gbs2 with energy error limit "<<0.1*energy_error_min<<std::endl;
+        std::cout<<std::setw(8)<<"method"
+                 <<std::setw(w)<<"ds_scale"
+                 <<std::setw(w)<<"dE_limit"
+                 <<std::setw(w)<<"Nstep"
+                 <<std::setw(w)<<"Nforce"
+                 <<std::setw(w)<<"time[ms]"
+                 <<std::setw(w)<<"dE/E"
+                 <<std::setw(w)<<"dpos"<<std::endl;
+        auto print = [&](const Method& _m, const Float _ds_scale, const Float _err) {
+            const BenchResult res = run(sys, _m.sym_order, _m.extrapolation, _err, _ds_scale, n_sync);
+            std::cout<<std::setw(8)<<_m.name
+                     <<std::setw(w)<<_ds_scale
+                     <<std::setw(w)<<_err
+                     <<std::setw(w)<<res.n_step
+                     <<std::setw(w)<<res.n_force
+                     <<std::setw(w)<<res.wtime
+                     <<std::setw(w)<<res.de_rel
+                     <<std::setw(w)<<posDiff(res, ref)<<std::endl;
+        };
+        for (auto& m: methods) {
+            if (m.extrapolation>0)
+                for (Float err=energy_error_max; err>=energy_error_min*0.99; err*=0.1) print(m, 1.0, err);
+            else
+                for (Float ds_scale=ds_scale_max; ds_scale>=ds_scale_min*0.99; ds_scale*=0.5) print(m, ds_scale, energy_error_max);
+        }
+        std::cout<<std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Common/Float.h"
+#include "AR/force.h"
+
+namespace AR {
+
+    //! Newtonian inner force kernel for a fixed number of members
+    /*! The separation and 1/r of each pair (i<j) are calculated once and shared by both members. All loops have compile-time bounds, thus they are fully unrolled by the compiler.
+      The contributions to each member are accumulated in the same order of j as the generic double loop (for i, for j!=i), thus the results are identical to it.
+      @tparam N: number of members
+     */
+    template <int N>
+    struct InnerForceKernel {
+        static const int n_pair = N*(N-1)/2; ///> number of pairs
+
+        //! index of pair (i,j), i<j
+        static inline int getPairIndex(const int _i, const int _j) {
+            return _i*(2*N-_i-1)/2 + _j-_i-1;
+        }
+
+        //! calculate inner member acceleration, potential and time transformation function gradient and factor for kick
+        /*!
+          @param[out] _force: force array, acc_in, pot_in (and gtgrad with AR_TTL) are overwritten
+          @param[out] _epot: total inner potential energy
+          @param[in] _particles: member particle array with N members
+          @param[in] _G: gravitational constant
+          @param[in] _eps_sq: softening parameter square
+          \return the time transformation factor (gt_kick_inv) for kick step
+        */
+        template <class Tparticle>
+        static inline Float calcAccPotAndGTKickInv(Force* _force, Float& _epot, const Tparticle* _particles, const Float _G, const Float _eps_sq) {
+            Float dr_pair[n_pair][3];
+            Float inv_r_pair[n_pair];
+            Float inv_r3_pair[n_pair];
+            for (int i=0; i<N; i++) {
+                for (int j=i+1; j<N; j++) {
+                    const int k = getPairIndex(i,j);
+                    const Float* posi = _particles[i].pos;
+                    const Float* posj = _particles[j].pos;
+                    dr_pair[k][0] = posj[0] - posi[0];
+                    dr_pair[k][1] = posj[1] - posi[1];
+                    dr_pair[k][2] = posj[2] - posi[2];
+                    const Float r2 = dr_pair[k][0]*dr_pair[k][0] + dr_pair[k][1]*dr_pair[k][1] + dr_pair[k][2]*dr_pair[k][2] + _eps_sq;
+                    const Float inv_r = 1.0/sqrt(r2);
+                    inv_r_pair[k] = inv_r;
+                    inv_r3_pair[k] = inv_r*inv_r*inv_r;
+                }
+            }
+
+            _epot = Float(0.0);
+            Float gt_kick_inv = Float(0.0);
+            for (int i=0; i<N; i++) {
+                const Float massi = _particles[i].mass;
+                Float* acci = _force[i].acc_in;
+                acci[0] = acci[1] = acci[2] = Float(0.0);
+#ifdef AR_TTL
+                Float* gtgradi = _force[i].gtgrad;
+                gtgradi[0] = gtgradi[1] = gtgradi[2] = Float(0.0);
+#endif
+                Float poti = Float(0.0);
+                Float gtki = Float(0.0);
+                for (int j=0; j<N; j++) {
+                    if (i==j) continue;
+                    // the separation of (j,i) is the negative of (i,j), which is exact
+                    const int k = i<j ? getPairIndex(i,j) : getPairIndex(j,i);
+                    const Float sign = i<j ? Float(1.0) : Float(-1.0);
+                    const Float dr[3] = {sign*dr_pair[k][0], sign*dr_pair[k][1], sign*dr_pair[k][2]};
+                    const Float massj = _particles[j].mass;
+                    const Float gmor3 = _G*massj*inv_r3_pair[k];
+                    acci[0] += gmor3 * dr[0];
+                    acci[1] += gmor3 * dr[1];
+                    acci[2] += gmor3 * dr[2];
+#ifdef AR_TTL
+                    const Float gmimjor3 = massi*gmor3;
+                    gtgradi[0] += gmimjor3 * dr[0];
+                    gtgradi[1] += gmimjor3 * dr[1];
+                    gtgradi[2] += gmimjor3 * dr[2];
+#endif
+                    const Float gmor = _G*massj*inv_r_pair[k];
+                    poti -= gmor;
+                    gtki += gmor;
+                }
+                _force[i].pot_in = poti;
+                _epot += poti * massi;
+                gt_kick_inv += gtki * massi;
+            }
+            _epot *= 0.5;
+            gt_kick_inv *= 0.5;
+
+            return gt_kick_inv;
+        }
+    };
+
+    //! calculate Newtonian inner force with the kernel specialised for the number of members
+    /*! Dispatch to InnerForceKernel<N> for 2-4 members, which are the most common group sizes. Interaction classes can call it at the beginning of the generic inner force function.
+      @param[out] _gt_kick_inv: the time transformation factor (gt_kick_inv) for kick step
+      @param[out] _force: force array
+      @param[out] _epot: total inner potential energy
+      @param[in] _particles: member particle array
+      @param[in] _n_particle: number of members
+      @param[in] _G: gravitational constant
+      @param[in] _eps_sq: softening parameter square
+      \return true: calculated; false: no kernel for this number of members, nothing is done
+     */
+    template <class Tparticle>
+    inline bool calcInnerAccPotAndGTKickInvSmallN(Float& _gt_kick_inv, Force* _force, Float& _epot, const Tparticle* _particles, const int _n_particle, const Float _G, const Float _eps_sq) {
+        switch (_n_particle) {
+        case 2:
+            _gt_kick_inv = InnerForceKernel<2>::calcAccPotAndGTKickInv(_force, _epot, _particles, _G, _eps_sq);
+            return true;
+        case 3:
+            _gt_kick_inv = InnerForceKernel<3>::calcAccPotAndGTKickInv(_force, _epot, _particles, _G, _eps_sq);
+            return true;
+        case 4:
+            _gt_kick_inv = InnerForceKernel<4>::calcAccPotAndGTKickInv(_force, _epot, _particles, _G, _eps_sq);
+            return true;
+        default:
+            return false;
+        }
+    }
+}
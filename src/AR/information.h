@@ -1,6 +1,7 @@
 #pragma once
 #include "Common/Float.h"
 #include "Common/binary_tree.h"
+#include "Common/scratch_arena.h"
 #include "AR/slow_down.h"
 
 namespace AR {
@@ -86,6 +87,16 @@ namespace AR {
       binarytree: the Kepler orbital parameters of the hierarchical systems and slowdown factors \\
       fix_step_option: option to control whether the adjustment of step sizes are used \\
      */
+    //! particle pair for the flat binary tree walk of the inner force
+    /*! The pair contributions of the inverse time transformation factor are summed with a value stack in reversed Polish order: after the value of a pair is pushed, n_add partial sums are added. Thus the summation order is the same as the recursive walk.
+     */
+    struct TreePair{
+        int i;   ///> particle i index
+        int j;   ///> particle j index
+        int bin; ///> index of the binary tree (lowest common ancestor) that determines the nested slowdown factor of the pair
+        int n_add; ///> number of additions on the value stack after this pair
+    };
+
     template <class Tparticle, class Tpcm>
     class Information{
     public:
@@ -94,12 +105,19 @@ namespace AR {
         Float r_break_crit;    // group break radius criterion
         FixStepOption fix_step_option; ///> fix step option for integration
         COMM::List<BinaryTree<Tparticle>> binarytree; ///> a list of binary tree that contain the hierarchical orbital parameters of the particle group.
+        // traversal schedule of binarytree, built by buildTreeSchedule when the tree is generated
+        COMM::List<int> tree_preorder;  ///> binarytree indices in pre-order (root first, upper binaries before their members)
+        COMM::List<int> tree_member_postorder; ///> binary members (2*tree index + member index k) in the order of the recursive walk, a member is after all members of its own sub-tree
+        COMM::List<TreePair> tree_pair; ///> all particle pairs in the order of the recursive inner force walk
+        // minimum distance chain of the last generateBinaryTree, used by updateBinaryTree to detect the change of the tree structure
+        COMM::List<int> tree_chain; ///> particle indices in the order of the minimum distance chain, empty if binarytree is not generated from the chain
+        COMM::List<int> tree_chain_pair; ///> for each binarytree, the index i of the chain pair (i, i+1) that forms it
 #ifdef AR_DEBUG_DUMP
         bool dump_flag; ///> for debuging dump
 #endif
 
         //! initializer, set ds to zero, fix_step_option to none
-        Information(): ds(0.0), time_offset(0.0), r_break_crit(-1.0), fix_step_option(AR::FixStepOption::none), binarytree() {
+        Information(): ds(0.0), time_offset(0.0), r_break_crit(-1.0), fix_step_option(AR::FixStepOption::none), binarytree(), tree_preorder(), tree_member_postorder(), tree_pair(), tree_chain(), tree_chain_pair() {
 #ifdef AR_DEBUG_DUMP
             dump_flag = false;
 #endif
@@ -127,6 +145,117 @@ namespace AR {
             return binarytree[n-1];
         }
 
+        //! get the index of a binary tree in binarytree
+        int getBinaryTreeIndex(const BinaryTree<Tparticle>* _bin) const {
+            const int i = int(_bin - binarytree.getDataAddress());
+            ASSERT(i>=0&&i<binarytree.getSize());
+            return i;
+        }
+
+    private:
+        //! add binary tree indices in pre-order and members in post-order iteratively
+        void addTreeOrderIter(const int _ibin) {
+            auto& bin = binarytree[_ibin];
+            tree_preorder.addMember(_ibin);
+            for (int k=0; k<2; k++) {
+                if (bin.isMemberTree(k)) addTreeOrderIter(getBinaryTreeIndex(bin.getMemberAsTree(k)));
+                tree_member_postorder.addMember(2*_ibin+k);
+            }
+        }
+
+        //! add one pair to tree_pair
+        void addTreePair(const int _i, const int _j, const int _ibin) {
+            TreePair pair = {_i, _j, _ibin, 0};
+            tree_pair.addMember(pair);
+        }
+
+        //! add the last two partial sums on the value stack after the last pair
+        void addTreePairSum() {
+            tree_pair[tree_pair.getSize()-1].n_add++;
+        }
+
+        //! add pairs between particle _i and all particles of binary tree _jbin
+        void addTreePairsOneIter(const int _ibin, const int _i, const int _jbin) {
+            auto& binj = binarytree[_jbin];
+            for (int k=0; k<2; k++) {
+                if (binj.isMemberTree(k)) addTreePairsOneIter(_ibin, _i, getBinaryTreeIndex(binj.getMemberAsTree(k)));
+                else addTreePair(_i, binj.getMemberIndex(k), _ibin);
+            }
+            addTreePairSum();
+        }
+
+        //! add pairs between all particles of binary tree _ibin_i and _ibin_j
+        void addTreePairsCrossIter(const int _ibin, const int _ibin_i, const int _ibin_j) {
+            auto& bini = binarytree[_ibin_i];
+            for (int k=0; k<2; k++) {
+                if (bini.isMemberTree(k)) addTreePairsCrossIter(_ibin, getBinaryTreeIndex(bini.getMemberAsTree(k)), _ibin_j);
+                else addTreePairsOneIter(_ibin, bini.getMemberIndex(k), _ibin_j);
+            }
+            addTreePairSum();
+        }
+
+        //! add all pairs inside binary tree _ibin, same order as the inner force walk of the integrator
+        void addTreePairsIter(const int _ibin) {
+            auto& bin = binarytree[_ibin];
+            if (bin.isMemberTree(0)) { 
+                const int ileft = getBinaryTreeIndex(bin.getMemberAsTree(0));
+                addTreePairsIter(ileft);
+                if (bin.isMemberTree(1)) {
+                    const int iright = getBinaryTreeIndex(bin.getMemberAsTree(1));
+                    addTreePairsIter(iright);
+                    addTreePairSum();
+                    addTreePairsCrossIter(_ibin, ileft, iright);
+                    addTreePairSum();
+                }
+                else {
+                    addTreePairsOneIter(_ibin, bin.getMemberIndex(1), ileft);
+                    addTreePairSum();
+                }
+            }
+            else {
+                if (bin.isMemberTree(1)) {
+                    const int iright = getBinaryTreeIndex(bin.getMemberAsTree(1));
+                    addTreePairsIter(iright);
+                    addTreePairsOneIter(_ibin, bin.getMemberIndex(0), iright);
+                    addTreePairSum();
+                }
+                else addTreePair(bin.getMemberIndex(0), bin.getMemberIndex(1), _ibin);
+            }
+        }
+
+        //! make sure a schedule list can store _n members
+        template <class T>
+        static void reserveScheduleList(COMM::List<T>& _list, const int _n) {
+            if (_list.getSizeMax()<_n) {
+                _list.clear();
+                _list.setMode(COMM::ListMode::local);
+                _list.reserveMem(_n);
+            }
+            _list.resizeNoInitialize(0);
+        }
+
+    public:
+        //! build the traversal schedule of binarytree
+        /*! The recursive walks of the binary tree in the integrator are replaced by flat loops over tree_preorder, tree_member_postorder and tree_pair. 
+          This should be called every time when the structure of binarytree changes, generateBinaryTree calls it at the end.
+          The saved minimum distance chain is reset, thus the next updateBinaryTree regenerates the tree.
+         */
+        void buildTreeSchedule() {
+            const int n_bin = binarytree.getSize();
+            ASSERT(n_bin>0);
+            const int n_particle = n_bin+1;
+            reserveScheduleList(tree_preorder, n_bin);
+            reserveScheduleList(tree_member_postorder, 2*n_bin);
+            reserveScheduleList(tree_pair, n_particle*(n_particle-1)/2);
+            reserveScheduleList(tree_chain, n_particle);
+            reserveScheduleList(tree_chain_pair, n_bin);
+            addTreeOrderIter(n_bin-1);
+            addTreePairsIter(n_bin-1);
+            ASSERT(tree_preorder.getSize()==n_bin);
+            ASSERT(tree_member_postorder.getSize()==2*n_bin);
+            ASSERT(tree_pair.getSize()==n_particle*(n_particle-1)/2);
+        }
+
         inline Float calcDsElliptic(BinaryTree<Tparticle>& _bin, const Float& _G) {
             //kepler orbit, step ds=dt*G*m1*m2/r estimation (1/32 orbit): 2*pi/32*sqrt(G*semi/(m1+m2))*m1*m2 
             return 0.19634954084*sqrt(_G*_bin.semi/(_bin.m1+_bin.m2))*(_bin.m1*_bin.m2);
@@ -230,16 +359,18 @@ namespace AR {
             const int n_particle = _particles.getSize();
             ASSERT(n_particle>1);
             binarytree.resizeNoInitialize(n_particle-1);
-            int particle_index_local[n_particle];
-            int particle_index_unused[n_particle];
+            COMM::ScratchScope scratch;
+            int* particle_index_local = scratch.allocate<int>(n_particle);
+            int* particle_index_unused = scratch.allocate<int>(n_particle);
             int n_particle_real = 0;
             int n_particle_unused=0;
             for (int i=0; i<n_particle; i++) {
                 if (_particles[i].mass>0.0) particle_index_local[n_particle_real++] = i;
                 else particle_index_unused[n_particle_unused++] = i;
             }
+            int* pair_order = scratch.allocate<int>(n_particle);
             if (n_particle_real>1) 
-                BinaryTree<Tparticle>::generateBinaryTree(binarytree.getDataAddress(), particle_index_local, n_particle_real, _particles.getDataAddress(), _G);
+                BinaryTree<Tparticle>::generateBinaryTree(binarytree.getDataAddress(), particle_index_local, n_particle_real, _particles.getDataAddress(), _G, pair_order);
 
             // Add unused particles to the outmost orbit
             if (n_particle_real==0) {
@@ -298,6 +429,80 @@ namespace AR {
                     binarytree[ilast].vel[2] = binarytree[ilast-1].vel[2];
                 }
             }
+
+            buildTreeSchedule();
+
+            // save the minimum distance chain if all particles are in it
+            if (n_particle_real==n_particle) {
+                for (int i=0; i<n_particle; i++) tree_chain.addMember(particle_index_local[i]);
+                for (int i=0; i<n_particle-1; i++) tree_chain_pair.addMember(pair_order[i]);
+            }
+        }
+
+        //! update the binary tree of the particle group incrementally
+        /*! If the minimum distance chain and the pair order saved by the last generateBinaryTree are unchanged (checkBinaryTreeChain), generateBinaryTree would give the same structure. 
+          Then only the center-of-mass and orbits are updated from bottom to top: the root gets the full Kepler orbit (calcOrbit), the inner binaries only masses, separation, semi, ecc, period and angular momentum (calcSemiEccPeriodAm).
+          Otherwise generateBinaryTree is called.
+          @param[in] _particles: particle group 
+          @param[in] _G: gravitational constant
+          \return true: the binary tree is regenerated; false: only the orbits are updated
+         */
+        bool updateBinaryTree(COMM::ParticleGroup<Tparticle, Tpcm>& _particles, const Float _G) {
+            if (!checkBinaryTreeChain(_particles)) {
+                generateBinaryTree(_particles, _G);
+                return true;
+            }
+            const int n_bin = binarytree.getSize();
+            // the members of a binary tree have smaller indices in binarytree
+            for (int i=0; i<n_bin-1; i++) {
+                binarytree[i].calcSemiEccPeriodAm(_G);
+                binarytree[i].calcCenterOfMass();
+            }
+            binarytree[n_bin-1].calcOrbit(_G);
+            binarytree[n_bin-1].calcCenterOfMass();
+            return false;
+        }
+
+        //! check whether the minimum distance chain saved by generateBinaryTree is still valid
+        /*! The nearest neighbours are searched along the chain in the same way as BinaryTree::calcMinDisList, but the chain is not reordered. Only distance squares are calculated.
+          Equal distances are treated as changes, since the tree structure then depends on the search and sort orders.
+          @param[in] _particles: particle group 
+          \return true: the chain and the pair order are unchanged
+         */
+        bool checkBinaryTreeChain(COMM::ParticleGroup<Tparticle, Tpcm>& _particles) const {
+            const int n_particle = _particles.getSize();
+            if (tree_chain.getSize()!=n_particle||binarytree.getSize()!=n_particle-1) return false;
+            for (int i=0; i<n_particle; i++) 
+                if (!(_particles[i].mass>0.0)) return false;
+            // members should still point to the particle group
+            for (int i=0; i<n_particle-1; i++) {
+                auto& bin = binarytree[i];
+                for (int k=0; k<2; k++) {
+                    const int j = bin.getMemberIndex(k);
+                    if (j>=0&&bin.getMember(k)!=&_particles[j]) return false;
+                }
+            }
+            if (n_particle==2) return true;
+
+            COMM::ScratchScope scratch;
+            Float* r2_chain = scratch.allocate<Float>(n_particle-1);
+            for (int i=0; i<n_particle-1; i++) {
+                const Float* posi = _particles[tree_chain[i]].pos;
+                Float r2min = NUMERIC_FLOAT_MAX;
+                for (int j=i+1; j<n_particle; j++) {
+                    const Float* posj = _particles[tree_chain[j]].pos;
+                    COMM::Vector3<Float> dr = {posi[0] - posj[0],
+                                               posi[1] - posj[1],
+                                               posi[2] - posj[2]};
+                    Float r2 = dr*dr;
+                    if (j==i+1) r2min = r2;
+                    else if (r2<=r2min) return false;
+                }
+                r2_chain[i] = r2min;
+            }
+            for (int i=0; i<n_particle-2; i++) 
+                if (!(r2_chain[tree_chain_pair[i]]<r2_chain[tree_chain_pair[i+1]])) return false;
+            return true;
         }
 
         //! check binary tree member pair id, if consisent, return ture. otherwise set the member pair id
@@ -334,6 +539,11 @@ namespace AR {
             r_break_crit=-1.0;
             fix_step_option = FixStepOption::none;
             binarytree.clear();
+            tree_preorder.clear();
+            tree_member_postorder.clear();
+            tree_pair.clear();
+            tree_chain.clear();
+            tree_chain_pair.clear();
 #ifdef AR_DEBUG_DUMP
             dump_flag=false;
 #endif
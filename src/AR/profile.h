@@ -32,14 +32,23 @@ namespace AR{
         UInt64 step_count_tsyn_sum; // number of integration steps during time synchronization summation
         UInt64 step_count; // number of integration steps from last step 
         UInt64 step_count_tsyn; // number of integration steps during time synchronization from last step
+        UInt64 kepler_count_sum; // number of integrations using the Kepler drift instead of AR steps summation
+        UInt64 step_count_extended_sum; // number of integration steps in the extended precision mode summation
+        UInt64 step_count_accept_sum; // number of integration steps accepted by the step size control summation
+        UInt64 step_count_reject_sum; // number of integration steps rejected (restored and redone) by the step size control summation
+        UInt64 step_count_extrapolation_sum; // number of symplectic sub-steps in the extrapolation stages summation
 
         // constructor
-        Profile(): step_count_sum(0), step_count_tsyn_sum(0), step_count(0), step_count_tsyn(0) {}
+        Profile(): step_count_sum(0), step_count_tsyn_sum(0), step_count(0), step_count_tsyn(0), kepler_count_sum(0), step_count_extended_sum(0), step_count_accept_sum(0), step_count_reject_sum(0), step_count_extrapolation_sum(0) {}
 
         // clear function
         void clear() {
             step_count = step_count_tsyn = 0;
             step_count_sum = step_count_tsyn_sum = 0;
+            kepler_count_sum = 0;
+            step_count_extended_sum = 0;
+            step_count_accept_sum = step_count_reject_sum = 0;
+            step_count_extrapolation_sum = 0;
         }
 
         //! print titles of class members using column style
@@ -51,7 +60,12 @@ namespace AR{
             _fout<<std::setw(_width)<<"Nstep(sum)"
                  <<std::setw(_width)<<"Nstep_tsyn(sum)"
                  <<std::setw(_width)<<"Nstep"
-                 <<std::setw(_width)<<"Nstep_tsyn";
+                 <<std::setw(_width)<<"Nstep_tsyn"
+                 <<std::setw(_width)<<"Nkepler(sum)"
+                 <<std::setw(_width)<<"Nstep_ext(sum)"
+                 <<std::setw(_width)<<"Nstep_acc(sum)"
+                 <<std::setw(_width)<<"Nstep_rej(sum)"
+                 <<std::setw(_width)<<"Nstep_ext_sub(sum)";
         }
 
         //! print data of class members using column style
@@ -63,21 +77,61 @@ namespace AR{
             _fout<<std::setw(_width)<<step_count_sum
                  <<std::setw(_width)<<step_count_tsyn_sum
                  <<std::setw(_width)<<step_count
-                 <<std::setw(_width)<<step_count_tsyn;
+                 <<std::setw(_width)<<step_count_tsyn
+                 <<std::setw(_width)<<kepler_count_sum
+                 <<std::setw(_width)<<step_count_extended_sum
+                 <<std::setw(_width)<<step_count_accept_sum
+                 <<std::setw(_width)<<step_count_reject_sum
+                 <<std::setw(_width)<<step_count_extrapolation_sum;
         }
 
         //! write class data with BINARY format
-        /*! @param[in] _fout: file IO for write
+        /*! The counters of the old versions (step_count_sum, step_count_tsyn_sum, step_count, step_count_tsyn) are written first in the same layout as before, the counters added later are appended after them.
+          @param[in] _fout: file IO for write
          */
         void writeBinary(FILE *_fout) {
-            fwrite(this, sizeof(*this),1,_fout);
+            fwrite(&step_count_sum, sizeof(UInt64),1,_fout);
+            fwrite(&step_count_tsyn_sum, sizeof(UInt64),1,_fout);
+            fwrite(&step_count, sizeof(UInt64),1,_fout);
+            fwrite(&step_count_tsyn, sizeof(UInt64),1,_fout);
+            fwrite(&kepler_count_sum, sizeof(UInt64),1,_fout);
+            fwrite(&step_count_extended_sum, sizeof(UInt64),1,_fout);
+            fwrite(&step_count_accept_sum, sizeof(UInt64),1,_fout);
+            fwrite(&step_count_reject_sum, sizeof(UInt64),1,_fout);
+            fwrite(&step_count_extrapolation_sum, sizeof(UInt64),1,_fout);
         }
 
         //! read class data with BINARY format and initial the array
         /*! @param[in] _fin: file IO for read
+          @param[in] _version: version for reading. 0: default; 1: missing the counters after step_count_tsyn (kepler_count_sum, step_count_extended_sum, step_count_accept_sum, step_count_reject_sum, step_count_extrapolation_sum), which are set to zero
          */
-        void readBinary(FILE *_fin) {
-            size_t rcount = fread(this, sizeof(*this), 1, _fin);
+        void readBinary(FILE *_fin, int _version=0) {
+            if (_version!=0&&_version!=1) {
+                std::cerr<<"Error: Profile.readBinary unknown version "<<_version<<", should be 0 or 1."<<std::endl;
+                abort();
+            }
+            readBinaryMember(step_count_sum, _fin);
+            readBinaryMember(step_count_tsyn_sum, _fin);
+            readBinaryMember(step_count, _fin);
+            readBinaryMember(step_count_tsyn, _fin);
+            if (_version==1) {
+                kepler_count_sum = 0;
+                step_count_extended_sum = 0;
+                step_count_accept_sum = step_count_reject_sum = 0;
+                step_count_extrapolation_sum = 0;
+                return;
+            }
+            readBinaryMember(kepler_count_sum, _fin);
+            readBinaryMember(step_count_extended_sum, _fin);
+            readBinaryMember(step_count_accept_sum, _fin);
+            readBinaryMember(step_count_reject_sum, _fin);
+            readBinaryMember(step_count_extrapolation_sum, _fin);
+        }
+
+    private:
+        //! read one counter with BINARY format
+        static void readBinaryMember(UInt64& _data, FILE *_fin) {
+            size_t rcount = fread(&_data, sizeof(UInt64), 1, _fin);
             if (rcount<1) {
                 std::cerr<<"Error: Data reading fails! requiring data number is 1, only obtain "<<rcount<<".\n";
                 abort();
@@ -3,8 +3,11 @@
 #include <functional>
 #include "Common/list.h"
 #include "Common/particle_group.h"
+#include "Common/scratch_arena.h"
+#include "Common/kepler_universal.h"
 #include "AR/symplectic_step.h"
 #include "AR/force.h"
+#include "AR/force_kernel.h"
 #include "AR/slow_down.h"
 #include "AR/profile.h"
 #include "AR/information.h"
@@ -68,6 +71,13 @@ namespace AR {
         Float slowdown_timescale_max;       ///> slowdown maximum timescale to calculate maximum slowdown factor
         long long unsigned int step_count_max; ///> maximum step counts
         int interrupt_detection_option;    ///> 1: detect interruption; 0: no detection
+        // members below are not in the raw binary block of the old versions, see writeBinary
+        Float kepler_pert_ratio_max;        ///> two-body groups are evolved by the Kepler drift instead of AR steps if slowdown pert_out/pert_in is below this value (AR_SLOWDOWN_TREE only); <=0: off
+        int precision_extend_option;       ///> 1: extend the precision of integrated variables by compensated summation when the round-off error limits the integration (see TimeTransformedSymplecticIntegrator::extendPrecision); 0: off
+        int ds_control_option;             ///> 1: predictive (PI) step size controller after accepted steps (see TimeTransformedSymplecticIntegrator::calcDsControlFactor); 0: reduce and recover step size by the backup levels
+        int time_sync_option;              ///> 1: one-shot time synchronization, estimate ds to reach the ending time from the sub-step time table and correct by Newton steps with gt_drift_inv; 0: reach the ending time by the sub-step time table and step size enlargement
+        int extrapolation_option;          ///> 1: Gragg-Bulirsch-Stoer extrapolation driver over the symplectic step with adaptive order (see TimeTransformedSymplecticIntegrator::integrateExtrapolationOneStep), the 2nd order step (leapfrog) is recommended; 0: symplectic step only
+        int extrapolation_stage_max;       ///> maximum number of stages of the extrapolation table, stage j uses j sub-steps
         
         Tmethod interaction; ///> class contain interaction function
         SymplecticStep step;  ///> class to manager kick drift step
@@ -78,7 +88,7 @@ namespace AR {
                                             slowdown_mass_ref(Float(-1.0)), 
 #endif
                                             slowdown_timescale_max(0.0),
-                                            step_count_max(0), interrupt_detection_option(0), interaction(), step() {}
+                                            step_count_max(0), interrupt_detection_option(0), kepler_pert_ratio_max(0.0), precision_extend_option(0), ds_control_option(0), time_sync_option(0), extrapolation_option(0), extrapolation_stage_max(8), interaction(), step() {}
 
         //! check whether parameters values are correct
         /*! \return true: all correct
@@ -97,28 +107,68 @@ namespace AR {
             ASSERT(slowdown_timescale_max>0);
             ASSERT(step_count_max>0);
             ASSERT(step.getOrder()>0);
+            ASSERT(extrapolation_option==0||extrapolation_stage_max>=2);
             ASSERT(interaction.checkParams());
             return true;
         }
 
+    private:
+        //! layout of the members written by the raw binary block, same as the old versions of the manager
+        struct BinaryBlock {
+            Float time_error_max;
+            Float energy_error_relative_max;
+            Float time_step_min;
+            Float ds_scale;
+            Float slowdown_pert_ratio_ref;
+#ifdef AR_SLOWDOWN_MASSRATIO
+            Float slowdown_mass_ref;
+#endif
+            Float slowdown_timescale_max;
+            long long unsigned int step_count_max;
+            int interrupt_detection_option;
+            Tmethod interaction;
+            SymplecticStep step;
+        };
+
+        //! size of the raw binary block (members before kepler_pert_ratio_max)
+        static size_t getBinaryBlockSize() {
+            return sizeof(BinaryBlock) - sizeof(Tmethod) - sizeof(SymplecticStep);
+        }
+
+        //! read one member with BINARY format
+        template <class T>
+        static void readBinaryMember(T& _data, FILE *_fin) {
+            size_t rcount = fread(&_data, sizeof(T), 1, _fin);
+            if (rcount<1) {
+                std::cerr<<"Error: TimeTransformedSymplecticManager parameter data reading fails! requiring data number is 1, only obtain "<<rcount<<".\n";
+                abort();
+            }
+        }
+
+    public:
         //! write class data with BINARY format
-        /*! @param[in] _fout: file IO for write
+        /*! The members existing in the old versions are written as one raw block, the later members are written one by one after the block.
+          @param[in] _fout: file IO for write
          */
         void writeBinary(FILE *_fout) {
-            size_t size = sizeof(*this) - sizeof(interaction) - sizeof(step);
-            fwrite(this, size, 1,_fout);
+            fwrite(this, getBinaryBlockSize(), 1,_fout);
+            fwrite(&kepler_pert_ratio_max, sizeof(Float), 1, _fout);
+            fwrite(&precision_extend_option, sizeof(int), 1, _fout);
+            fwrite(&ds_control_option, sizeof(int), 1, _fout);
+            fwrite(&time_sync_option, sizeof(int), 1, _fout);
+            fwrite(&extrapolation_option, sizeof(int), 1, _fout);
+            fwrite(&extrapolation_stage_max, sizeof(int), 1, _fout);
             interaction.writeBinary(_fout);
             step.writeBinary(_fout);
         }
 
         //! read class data with BINARY format and initial the array
         /*! @param[in] _fin: file IO for read
-          @param[in] _version: version for reading. 0: default; 1: missing ds_scale
+          @param[in] _version: version for reading. 0: default; 1: missing ds_scale and the members after interrupt_detection_option; 2: missing the members after interrupt_detection_option (kepler_pert_ratio_max, precision_extend_option, ds_control_option, time_sync_option, extrapolation_option, extrapolation_stage_max). The missing members are set to the default values of the constructor.
          */
         void readBinary(FILE *_fin, int _version=0) {
-            if (_version==0) {
-                size_t size = sizeof(*this) - sizeof(interaction) - sizeof(step);
-                size_t rcount = fread(this, size, 1, _fin);
+            if (_version==0||_version==2) {
+                size_t rcount = fread(this, getBinaryBlockSize(), 1, _fin);
                 if (rcount<1) {
                     std::cerr<<"Error: TimeTransformedSymplecticManager parameter reading fails! requiring data number is 1, only obtain "<<rcount<<".\n";
                     abort();
@@ -131,7 +181,7 @@ namespace AR {
                     abort();
                 }
                 ds_scale=1.0;
-                size_t size = sizeof(*this) - sizeof(interaction) - sizeof(step) - 4*sizeof(Float);
+                size_t size = getBinaryBlockSize() - 4*sizeof(Float);
                 rcount = fread(&slowdown_pert_ratio_ref, size, 1, _fin);
                 if (rcount<1) {
                     std::cerr<<"Error: TimeTransformedSymplecticManager parameter data reading fails! requiring data number is 1, only obtain "<<rcount<<".\n";
@@ -139,9 +189,25 @@ namespace AR {
                 }
             }
             else {
-                std::cerr<<"Error: TimeTransformedSymplecticManager.readBinary unknown version "<<_version<<", should be 0 or 1."<<std::endl;
+                std::cerr<<"Error: TimeTransformedSymplecticManager.readBinary unknown version "<<_version<<", should be 0, 1 or 2."<<std::endl;
                 abort();
             }
+            if (_version==0) {
+                readBinaryMember(kepler_pert_ratio_max, _fin);
+                readBinaryMember(precision_extend_option, _fin);
+                readBinaryMember(ds_control_option, _fin);
+                readBinaryMember(time_sync_option, _fin);
+                readBinaryMember(extrapolation_option, _fin);
+                readBinaryMember(extrapolation_stage_max, _fin);
+            }
+            else {
+                kepler_pert_ratio_max = 0.0;
+                precision_extend_option = 0;
+                ds_control_option = 0;
+                time_sync_option = 0;
+                extrapolation_option = 0;
+                extrapolation_stage_max = 8;
+            }
             interaction.readBinary(_fin);
             step.readBinary(_fin);
         }
@@ -156,7 +222,13 @@ namespace AR {
                  <<"slowdown_mass_ref         : "<<slowdown_mass_ref<<std::endl
 #endif
                  <<"slowdown_timescale_max    : "<<slowdown_timescale_max<<std::endl
+                 <<"kepler_pert_ratio_max     : "<<kepler_pert_ratio_max<<std::endl
                  <<"step_count_max            : "<<step_count_max<<std::endl
+                 <<"precision_extend_option   : "<<precision_extend_option<<std::endl
+                 <<"ds_control_option         : "<<ds_control_option<<std::endl
+                 <<"time_sync_option          : "<<time_sync_option<<std::endl
+                 <<"extrapolation_option      : "<<extrapolation_option<<std::endl
+                 <<"extrapolation_stage_max   : "<<extrapolation_stage_max<<std::endl
                  <<"ds_scale                  : "<<ds_scale<<std::endl;
             interaction.print(_fout);
             step.print(_fout);
@@ -206,6 +278,18 @@ namespace AR {
         // force array
         COMM::List<Force> force_; ///< acceleration array 
 
+        // extended precision mode
+        bool precision_extended_flag_; ///< true: the rounding errors of the integrated variables are kept in the low parts below
+        Float time_lo_;      ///< low part of time_
+        Float etot_ref_lo_;  ///< low part of etot_ref_
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+        Float etot_sd_ref_lo_;  ///< low part of etot_sd_ref_
+#endif
+#ifdef AR_TTL
+        Float gt_drift_inv_lo_; ///< low part of gt_drift_inv_
+#endif
+        COMM::List<Float> pos_vel_lo_; ///< low parts of member positions and velocities, 6 per member
+
     public:
         TimeTransformedSymplecticManager<Tmethod>* manager; ///< integration manager
         COMM::ParticleGroup<Tparticle,Tpcm> particles; ///< particle group manager
@@ -225,7 +309,14 @@ namespace AR {
 #ifdef AR_TTL
                                 gt_drift_inv_(0), gt_kick_inv_(0), 
 #endif
-                                force_(), manager(NULL), particles(), 
+                                force_(), precision_extended_flag_(false), time_lo_(0), etot_ref_lo_(0),
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+                                etot_sd_ref_lo_(0),
+#endif
+#ifdef AR_TTL
+                                gt_drift_inv_lo_(0),
+#endif
+                                pos_vel_lo_(), manager(NULL), particles(), 
 #ifdef AR_SLOWDOWN_ARRAY
                                 binary_slowdown(), 
 #endif
@@ -281,6 +372,16 @@ namespace AR {
             gt_kick_inv_ = 0.0;
 #endif
             force_.clear();
+            precision_extended_flag_ = false;
+            time_lo_ = 0.0;
+            etot_ref_lo_ = 0.0;
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+            etot_sd_ref_lo_ = 0.0;
+#endif
+#ifdef AR_TTL
+            gt_drift_inv_lo_ = 0.0;
+#endif
+            pos_vel_lo_.clear();
             particles.clear();
 #ifdef AR_SLOWDOWN_ARRAY
             binary_slowdown.clear();
@@ -321,6 +422,16 @@ namespace AR {
             gt_kick_inv_ = _sym.gt_kick_inv_;
 #endif
             force_  = _sym.force_;
+            precision_extended_flag_ = _sym.precision_extended_flag_;
+            time_lo_ = _sym.time_lo_;
+            etot_ref_lo_ = _sym.etot_ref_lo_;
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+            etot_sd_ref_lo_ = _sym.etot_sd_ref_lo_;
+#endif
+#ifdef AR_TTL
+            gt_drift_inv_lo_ = _sym.gt_drift_inv_lo_;
+#endif
+            pos_vel_lo_ = _sym.pos_vel_lo_;
             manager = _sym.manager;
 #ifdef AR_SLOWDOWN_ARRAY
             binary_slowdown = _sym.binary_slowdown;
@@ -334,6 +445,47 @@ namespace AR {
 
     private:
 
+        //! add an increment with the rounding error kept in the low part
+        /*! Compensated summation: _x + _lo is updated by the twoSum transformation, which is exact for Float without extended precision
+          @param[in,out] _x: integrated variable
+          @param[in,out] _lo: low part of _x
+          @param[in] _dx: increment
+         */
+        static inline void addCompensated(Float& _x, Float& _lo, const Float _dx) {
+            const Float y = _dx + _lo;
+            const Float t = _x + y;
+            const Float bb = t - _x;
+            _lo = (_x - (t - bb)) + (y - bb);
+            _x = t;
+        }
+
+        //! add an increment to an integrated variable, use compensated summation in the extended precision mode
+        inline void addToIntegrated(Float& _x, Float& _lo, const Float _dx) {
+            if (precision_extended_flag_) addCompensated(_x, _lo, _dx);
+            else _x += _dx;
+        }
+
+        //! add increments to the position or velocity of one member, use compensated summation in the extended precision mode
+        /*! @param[in,out] _x: position or velocity of member
+          @param[in] _i: member index
+          @param[in] _offset: 0: position; 3: velocity
+          @param[in] _dx: increments
+         */
+        inline void addToMemberPosVel(Float* _x, const int _i, const int _offset, const Float* _dx) {
+            if (precision_extended_flag_) {
+                ASSERT(6*_i+_offset+2<pos_vel_lo_.getSize());
+                Float* lo = &pos_vel_lo_[6*_i+_offset];
+                addCompensated(_x[0], lo[0], _dx[0]);
+                addCompensated(_x[1], lo[1], _dx[1]);
+                addCompensated(_x[2], lo[2], _dx[2]);
+            }
+            else {
+                _x[0] += _dx[0];
+                _x[1] += _dx[1];
+                _x[2] += _dx[2];
+            }
+        }
+
 #if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
         //! iteration function to calculate perturbation and timescale information from binary tree j to binary i
         /*!
@@ -425,25 +577,70 @@ namespace AR {
 
 #ifdef AR_SLOWDOWN_TREE
 
-        //! Calculate twice (slowdown) kinetic energy iteration function with binary tree
-        /*! cumulative ekin_ and ekin_sd_. Notice these two values should be initialized to zero and reduce by two after iteration.
-          @param[in] _inv_nest_sd_up: upper inverse nested slowdown factor
-          @param[in] _bin: current binary tree for kick etot and calc dgt_drift
+        //! calculate inverse nested slowdown factors and slowdown c.m. velocities of all binary trees
+        /*! Flat walk over info.tree_preorder, upper binaries are processed before their members.
+          @param[out] _inv_nest_sd: inverse nested slowdown factor of each binary tree (product of the inverse slowdown factors of the binary and all its upper binaries), size of info.binarytree
+          @param[out] _vel_sd: slowdown c.m. velocity of each binary tree (3 per binary, zero for root), if NULL, not calculated
         */
-        void calcTwoEKinIter(const Float& _inv_nest_sd_up, AR::BinaryTree<Tparticle>& _bin){
-            Float inv_nest_sd = _inv_nest_sd_up/_bin.slowdown.getSlowDownFactor();
-            Float* vel_cm = _bin.getVel();
-            for (int k=0; k<2; k++) {
+        void calcTreeInvNestSlowDown(Float* _inv_nest_sd, Float* _vel_sd) {
+            const int n_bin = info.binarytree.getSize();
+            ASSERT(info.tree_preorder.getSize()==n_bin);
+            const int* order = info.tree_preorder.getDataAddress();
+            AR::BinaryTree<Tparticle>* bins = info.binarytree.getDataAddress();
+            const int iroot = order[0];
+            // before the binary is processed, _inv_nest_sd stores the upper inverse nested slowdown factor
+            _inv_nest_sd[iroot] = 1.0;
+            if (_vel_sd!=NULL) _vel_sd[3*iroot] = _vel_sd[3*iroot+1] = _vel_sd[3*iroot+2] = 0.0;
+            for (int n=0; n<n_bin; n++) {
+                const int j = order[n];
+                auto& bin = bins[j];
+                const Float inv_nest_sd = _inv_nest_sd[j]/bin.slowdown.getSlowDownFactor();
+                _inv_nest_sd[j] = inv_nest_sd;
+                const Float* vel_cm = bin.getVel();
+                for (int k=0; k<2; k++) {
+                    if (bin.isMemberTree(k)) {
+                        auto* bink = bin.getMemberAsTree(k);
+                        const int jk = info.getBinaryTreeIndex(bink);
+                        _inv_nest_sd[jk] = inv_nest_sd;
+                        if (_vel_sd!=NULL) {
+                            const Float* vel = bink->getVel();
+                            _vel_sd[3*jk]   = (vel[0] - vel_cm[0]) * inv_nest_sd + _vel_sd[3*j];
+                            _vel_sd[3*jk+1] = (vel[1] - vel_cm[1]) * inv_nest_sd + _vel_sd[3*j+1];
+                            _vel_sd[3*jk+2] = (vel[2] - vel_cm[2]) * inv_nest_sd + _vel_sd[3*j+2];
+                        }
+                    }
+                }
+            }
+        }
+
+        //! Calculate (slowdown) kinetic energy
+        /*! Flat walk over info.tree_member_postorder, the summation order is the same as the recursive walk of the binary tree
+         */
+        void calcEKin() {
+            ekin_ = ekin_sd_ = 0.0;
+            auto& bin_root=info.getBinaryTreeRoot();
+            const int n_bin = info.binarytree.getSize();
+            COMM::ScratchScope scratch;
+            Float* inv_nest_sd = scratch.allocate<Float>(n_bin);
+            calcTreeInvNestSlowDown(inv_nest_sd, NULL);
+
+            AR::BinaryTree<Tparticle>* bins = info.binarytree.getDataAddress();
+            const int* members = info.tree_member_postorder.getDataAddress();
+            const int n_member = info.tree_member_postorder.getSize();
+            for (int n=0; n<n_member; n++) {
+                const int j = members[n]>>1;
+                const int k = members[n]&1;
+                auto& bin = bins[j];
+                Float* vel_cm = bin.getVel();
                 Float* vk;
                 Float  mk;
-                if (_bin.isMemberTree(k)) {
-                    auto* bink = _bin.getMemberAsTree(k);
+                if (bin.isMemberTree(k)) {
+                    auto* bink = bin.getMemberAsTree(k);
                     vk = bink->getVel();
                     mk = bink->mass;
-                    calcTwoEKinIter(inv_nest_sd, *bink);
                 }
                 else {
-                    auto* pk = _bin.getMember(k);
+                    auto* pk = bin.getMember(k);
                     vk = pk->getVel();
                     mk = pk->mass;
                     ekin_ += mk * (vk[0]*vk[0]+vk[1]*vk[1]+vk[2]*vk[2]);
@@ -451,17 +648,8 @@ namespace AR {
                 Float vrel[3] = {vk[0] - vel_cm[0],
                                  vk[1] - vel_cm[1],
                                  vk[2] - vel_cm[2]};
-                ekin_sd_ += mk * inv_nest_sd * (vrel[0]*vrel[0] + vrel[1]*vrel[1] + vrel[2]*vrel[2]);
+                ekin_sd_ += mk * inv_nest_sd[j] * (vrel[0]*vrel[0] + vrel[1]*vrel[1] + vrel[2]*vrel[2]);
             }
-        }
-
-        //! Calculate (slowdown) kinetic energy
-        void calcEKin() {
-            ekin_ = ekin_sd_ = 0.0;
-            auto& bin_root=info.getBinaryTreeRoot();
-            Float sd_factor=1.0;
-            
-            calcTwoEKinIter(sd_factor, bin_root);
             Float* vcm = bin_root.getVel();
             // notice the cm velocity may not be zero after interruption, thus need to be added 
             ekin_sd_ += bin_root.mass*(vcm[0]*vcm[0] + vcm[1]*vcm[1] + vcm[2]*vcm[2]);
@@ -470,7 +658,6 @@ namespace AR {
             ekin_sd_ *= 0.5;
         }
 
-
         //! kick velocity
         /*! First time step will be calculated, the velocities are kicked
           @param[in] _dt: time size
@@ -485,86 +672,61 @@ namespace AR {
                 Float* acc = force[i].acc_in;
                 Float* pert= force[i].acc_pert;
                 // half dv 
-                vel[0] += _dt * (acc[0] + pert[0]);
-                vel[1] += _dt * (acc[1] + pert[1]);
-                vel[2] += _dt * (acc[2] + pert[2]);
-            }
-            // update binary c.m. velocity interation
-            updateBinaryVelIter(info.getBinaryTreeRoot());
-        }
-
-        //! drift position with slowdown tree
-        /*!
-          @param[in] _dt: drift time
-          @param[in] _vel_sd_up: upper cm sd vel
-          @param[in] _inv_nest_sd_up: upper inverse nested slowdown factor
-          @param[in] _bin: current binary to drift pos
-        */
-        void driftPosTreeIter(const Float& _dt, const Float* _vel_sd_up, const Float& _inv_nest_sd_up, AR::BinaryTree<Tparticle>& _bin) { 
-            // current nested sd factor
-            Float inv_nest_sd = _inv_nest_sd_up/_bin.slowdown.getSlowDownFactor();
-
-            Float* vel_cm = _bin.getVel();
-
-            auto driftPos=[&](Float* pos, Float* vel, Float* vel_sd) {
-                //scale velocity referring to binary c.m.
-                vel_sd[0] = (vel[0] - vel_cm[0]) * inv_nest_sd + _vel_sd_up[0];
-                vel_sd[1] = (vel[1] - vel_cm[1]) * inv_nest_sd + _vel_sd_up[1]; 
-                vel_sd[2] = (vel[2] - vel_cm[2]) * inv_nest_sd + _vel_sd_up[2];
-
-                pos[0] += _dt * vel_sd[0];
-                pos[1] += _dt * vel_sd[1];
-                pos[2] += _dt * vel_sd[2];
-            };
-
-            for (int k=0; k<2; k++) {
-                if (_bin.isMemberTree(k)) {
-                    auto* pj = _bin.getMemberAsTree(k);
-                    Float* pos = pj->getPos();
-                    Float* vel = pj->getVel();
-                    Float vel_sd[3];
-                    driftPos(pos, vel, vel_sd);
-                    driftPosTreeIter(_dt, vel_sd, inv_nest_sd, *pj);
-//#ifdef AR_DEBUG
-//                    auto& pos1= pj->getLeftMember()->pos;
-//                    auto& pos2= pj->getRightMember()->pos;
-//                    Float m1 = pj->getLeftMember()->mass;
-//                    Float m2 = pj->getRightMember()->mass;
-//                    Float pos_cm[3] = {(m1*pos1[0]+m2*pos2[0])/(m1+m2),
-//                                       (m1*pos1[1]+m2*pos2[1])/(m1+m2),
-//                                       (m1*pos1[2]+m2*pos2[2])/(m1+m2)};
-//                    Float dpos[3] = {pos[0]-pos_cm[0], 
-//                                     pos[1]-pos_cm[1], 
-//                                     pos[2]-pos_cm[2]};
-//                    Float dr2 = dpos[0]*dpos[0]+dpos[1]*dpos[1]+dpos[2]*dpos[2];
-//                    ASSERT(dr2<1e-10);
-//#endif
-                }
-                else {
-                    auto* pj = _bin.getMember(k);
-                    Float* pos = pj->getPos();
-                    Float* vel = pj->getVel();
-                    Float vel_sd[3];
-                    driftPos(pos, vel, vel_sd);
-                }
+                const Float dvel[3] = {_dt * (acc[0] + pert[0]),
+                                       _dt * (acc[1] + pert[1]),
+                                       _dt * (acc[2] + pert[2])};
+                addToMemberPosVel(vel, i, 3, dvel);
             }
+            // update binary c.m. velocity
+            updateBinaryVel();
         }
 
         //! drift time and position with slowdown tree
-        /*! First (real) time is drifted, then positions are drifted
+        /*! First (real) time is drifted, then positions are drifted. 
+          The binary c.m. and member particle positions are drifted with the slowdown velocities by a flat walk over info.tree_preorder
           @param[in] _dt: time step
         */
         void driftTimeAndPos(const Float& _dt) {
             // drift time 
-            time_ += _dt;
+            addToIntegrated(time_, time_lo_, _dt);
 
             // the particle cm velocity is zero (assume in rest-frame)
             ASSERT(!particles.isOriginFrame());
-            auto& bin_root=info.getBinaryTreeRoot();
-            Float vel_cm[3] = {0.0,0.0,0.0};
-            Float sd_factor=1.0;
-
-            driftPosTreeIter(_dt, vel_cm, sd_factor, bin_root);
+            const int n_bin = info.binarytree.getSize();
+            COMM::ScratchScope scratch;
+            Float* inv_nest_sd = scratch.allocate<Float>(n_bin);
+            Float* vel_sd = scratch.allocate<Float>(3*n_bin);
+            calcTreeInvNestSlowDown(inv_nest_sd, vel_sd);
+
+            AR::BinaryTree<Tparticle>* bins = info.binarytree.getDataAddress();
+            const int* order = info.tree_preorder.getDataAddress();
+            for (int n=0; n<n_bin; n++) {
+                const int j = order[n];
+                auto& bin = bins[j];
+                Float* vel_cm = bin.getVel();
+                for (int k=0; k<2; k++) {
+                    if (bin.isMemberTree(k)) {
+                        // binary c.m. 
+                        auto* bink = bin.getMemberAsTree(k);
+                        const Float* vel_sdk = &vel_sd[3*info.getBinaryTreeIndex(bink)];
+                        Float* pos = bink->getPos();
+                        pos[0] += _dt * vel_sdk[0];
+                        pos[1] += _dt * vel_sdk[1];
+                        pos[2] += _dt * vel_sdk[2];
+                    }
+                    else {
+                        // members are drifted with compensated summation in the extended precision mode
+                        auto* pk = bin.getMember(k);
+                        Float* pos = pk->getPos();
+                        Float* vel = pk->getVel();
+                        //scale velocity referring to binary c.m.
+                        const Float dpos[3] = {_dt * ((vel[0] - vel_cm[0]) * inv_nest_sd[j] + vel_sd[3*j]),
+                                               _dt * ((vel[1] - vel_cm[1]) * inv_nest_sd[j] + vel_sd[3*j+1]),
+                                               _dt * ((vel[2] - vel_cm[2]) * inv_nest_sd[j] + vel_sd[3*j+2])};
+                        addToMemberPosVel(pos, bin.getMemberIndex(k), 0, dpos);
+                    }
+                }
+            }
         }
 
 #ifdef AR_TIME_FUNCTION_MULTI_R
@@ -639,183 +801,104 @@ namespace AR {
             return gt_kick_inv * _inv_nest_sd;
         }
 
-        //! calc force, potential and inverse time transformation factor for one particle by walking binary tree
-        /*!
-          @param[in] _inv_nest_sd: inverse nested slowdown factor
-          @param[in] _i: particle index
-          @param[in] _bin: binary tree for walking
-          \return gt_kick_inv: inverse time transformation factor for kick
-         */
-        Float calcAccPotAndGTKickInvOneTreeIter(const Float& _inv_nest_sd, const int _i, AR::BinaryTree<Tparticle>& _bin) {
-            Float gt_kick_inv=0.0;
-            for (int k=0; k<2; k++) {
-                if (_bin.isMemberTree(k)) // particle - tree
-                    gt_kick_inv += calcAccPotAndGTKickInvOneTreeIter(_inv_nest_sd, _i, *(_bin.getMemberAsTree(k)));
-                else  // particle - particle
-                    gt_kick_inv += calcAccPotAndGTKickInvTwo(_inv_nest_sd, _i, _bin.getMemberIndex(k));
-            }
-            return gt_kick_inv;
-        }
-
-        //! calc crossing force, potential and inverse time transformation factor between binary tree i and binary tree j
-        /*!
-          @param[in] _inv_nest_sd: inverse nested slowdown factor
-          @param[in] _bini: binary tree i for walking
-          @param[in] _binj: binary tree j for walking
-          \return gt_kick_inv: inverse time transformation factor for kick
-         */
-        Float calcAccPotAndGTKickInvCrossTreeIter(const Float& _inv_nest_sd, AR::BinaryTree<Tparticle>& _bini, AR::BinaryTree<Tparticle>& _binj) {
-            ASSERT(&_bini!=&_binj);
-            Float gt_kick_inv=0.0;
-            for (int k=0; k<2; k++) { 
-                if (_bini.isMemberTree(k))  // tree - tree
-                    gt_kick_inv += calcAccPotAndGTKickInvCrossTreeIter(_inv_nest_sd, *(_bini.getMemberAsTree(k)), _binj);
-                else  // particle - tree
-                    gt_kick_inv += calcAccPotAndGTKickInvOneTreeIter(_inv_nest_sd, _bini.getMemberIndex(k), _binj);
-            }
-            return gt_kick_inv;
-        }
-
         //! calc force, potential and inverse time transformation factor for kick
-        /*!
-          @param[in] _inv_nest_sd_up: upper inverse nested slowdown factor
-          @param[in] _bin: current binary to drift pos
+        /*! Flat loop over the pair list info.tree_pair, each pair is scaled by the inverse nested slowdown factor of its lowest common binary.
+          The pair contributions of gt_kick_inv are summed with a value stack (see AR::TreePair), thus the result is identical to the recursive walk of the binary tree
           \return gt_kick_inv: inverse time transformation factor for kick
          */
-        Float calcAccPotAndGTKickInvTreeIter(const Float& _inv_nest_sd_up, AR::BinaryTree<Tparticle>& _bin) {
-            // current nested sd factor
-            Float inv_nest_sd = _inv_nest_sd_up/_bin.slowdown.getSlowDownFactor();
-            Float gt_kick_inv = 0.0;
-
-            // check left 
-            if (_bin.isMemberTree(0)) { // left is tree
-                auto* bin_left = _bin.getMemberAsTree(0);
-                // inner interaction of left tree
-                gt_kick_inv += calcAccPotAndGTKickInvTreeIter(inv_nest_sd, *bin_left);
-
-                if (_bin.isMemberTree(1)) { // right is tree
-                    auto* bin_right = _bin.getMemberAsTree(1);
-
-                    // inner interaction of right tree
-                    gt_kick_inv += calcAccPotAndGTKickInvTreeIter(inv_nest_sd, *bin_right);
-                    
-                    // cross interaction
-                    gt_kick_inv += calcAccPotAndGTKickInvCrossTreeIter(inv_nest_sd, *bin_left, *bin_right);
-                }
-                else { // right is particle
-                    // cross interaction from particle j to tree left
-                    gt_kick_inv += calcAccPotAndGTKickInvOneTreeIter(inv_nest_sd,  _bin.getMemberIndex(1), *bin_left);
-                }
-            }
-            else { // left is particle
-                if (_bin.isMemberTree(1)) { // right is tree
-                    auto* bin_right = _bin.getMemberAsTree(1);
-                    // inner interaction of right tree
-                    gt_kick_inv += calcAccPotAndGTKickInvTreeIter(inv_nest_sd, *bin_right);
+        inline Float calcAccPotAndGTKickInv() {
+            epot_ = 0.0;
+            epot_sd_ = 0.0;
+            for (int i=0; i<force_.getSize(); i++) force_[i].clear();
 
-                    // cross interaction from particle i to tree right
-                    gt_kick_inv += calcAccPotAndGTKickInvOneTreeIter(inv_nest_sd, _bin.getMemberIndex(0), *bin_right);
-                }
-                else { // right is particle
-                    // particle - particle interaction
-                    gt_kick_inv += calcAccPotAndGTKickInvTwo(inv_nest_sd, _bin.getMemberIndex(0), _bin.getMemberIndex(1));
+            const int n_bin = info.binarytree.getSize();
+            COMM::ScratchScope scratch;
+            Float* inv_nest_sd = scratch.allocate<Float>(n_bin);
+            calcTreeInvNestSlowDown(inv_nest_sd, NULL);
+
+            const TreePair* pairs = info.tree_pair.getDataAddress();
+            const int n_pair = info.tree_pair.getSize();
+            Float* gt_stack = scratch.allocate<Float>(n_pair);
+            int n_stack = 0;
+            for (int n=0; n<n_pair; n++) {
+                gt_stack[n_stack++] = calcAccPotAndGTKickInvTwo(inv_nest_sd[pairs[n].bin], pairs[n].i, pairs[n].j);
+                for (int k=0; k<pairs[n].n_add; k++) {
+                    n_stack--;
+                    gt_stack[n_stack-1] += gt_stack[n_stack];
                 }
             }
-
+            ASSERT(n_stack==1);
+            Float gt_kick_inv = gt_stack[0];
 
 #ifdef AR_TIME_FUNCTION_MULTI_R
-            gt_kick_inv = calcMultiInvRIter(_bin);
+            gt_kick_inv = calcMultiInvRIter(info.getBinaryTreeRoot());
 #endif
-
-            return gt_kick_inv;
-        }
-        
-
-        //! calc force, potential and inverse time transformation factor for kick
-        /*!
-          \return gt_kick_inv: inverse time transformation factor for kick
-         */
-        inline Float calcAccPotAndGTKickInv() {
-            epot_ = 0.0;
-            epot_sd_ = 0.0;
-            for (int i=0; i<force_.getSize(); i++) force_[i].clear();
-
-            Float gt_kick_inv = calcAccPotAndGTKickInvTreeIter(1.0, info.getBinaryTreeRoot());
             // pertuber force
             manager->interaction.calcAccPert(force_.getDataAddress(), particles.getDataAddress(), particles.getSize(), particles.cm, perturber, getTime());
             return gt_kick_inv;
         }
 
 #ifdef AR_TTL
-        //! kick energy and time transformation function for drift of binary tree 
-        /*!
+        //! kick energy and time transformation function for drift
+        /*! Flat walk over info.tree_member_postorder, the partial sums of each binary are accumulated in the same order as the recursive walk of the binary tree
           @param[in] _dt: time step
-          @param[in] _vel_sd_up: upper cm sd vel
-          @param[in] _inv_nest_sd_up: upper inverse nested slowdown factor
-          @param[in] _bin: current binary tree for kick etot and calc dgt_drift
-          \return gt_drift_inv change 
         */
-        Float kickEtotAndGTDriftTreeIter(const Float& _dt, const Float* _vel_sd_up, const Float& _inv_nest_sd_up, AR::BinaryTree<Tparticle>& _bin) {
-            // current nested sd factor
-            Float inv_nest_sd = _inv_nest_sd_up/_bin.slowdown.getSlowDownFactor();
-            Float dgt_drift_inv = 0.0;
-            Float de = 0.0;
-
-            Float* vel_cm = _bin.getVel();
-
-            for (int k=0; k<2; k++) {
-                if (_bin.isMemberTree(k)) {
-                    auto* bink = _bin.getMemberAsTree(k);
-                    Float* vel = bink->getVel();
-                    Float vel_sd[3] = {(vel[0] - vel_cm[0]) * inv_nest_sd + _vel_sd_up[0], 
-                                       (vel[1] - vel_cm[1]) * inv_nest_sd + _vel_sd_up[1], 
-                                       (vel[2] - vel_cm[2]) * inv_nest_sd + _vel_sd_up[2]}; 
-                    dgt_drift_inv += kickEtotAndGTDriftTreeIter(_dt, vel_sd, inv_nest_sd, *bink);
+        void kickEtotAndGTDrift(const Float _dt) {
+            // the particle cm velocity is zero (assume in rest-frame)
+            ASSERT(!particles.isOriginFrame());
+            const int n_bin = info.binarytree.getSize();
+            COMM::ScratchScope scratch;
+            Float* inv_nest_sd = scratch.allocate<Float>(n_bin);
+            Float* vel_sd_up = scratch.allocate<Float>(3*n_bin);
+            Float* dgt_bin = scratch.allocate<Float>(n_bin);
+            Float* de_bin = scratch.allocate<Float>(n_bin);
+            calcTreeInvNestSlowDown(inv_nest_sd, vel_sd_up);
+
+            AR::BinaryTree<Tparticle>* bins = info.binarytree.getDataAddress();
+            const int* members = info.tree_member_postorder.getDataAddress();
+            const int n_member = info.tree_member_postorder.getSize();
+            for (int n=0; n<n_member; n++) {
+                const int j = members[n]>>1;
+                const int k = members[n]&1;
+                auto& bin = bins[j];
+                if (k==0) dgt_bin[j] = de_bin[j] = 0.0;
+                if (bin.isMemberTree(k)) {
+                    dgt_bin[j] += dgt_bin[info.getBinaryTreeIndex(bin.getMemberAsTree(k))];
                 }
                 else {
-                    int i = _bin.getMemberIndex(k);
+                    int i = bin.getMemberIndex(k);
                     ASSERT(i>=0&&i<particles.getSize());
-                    ASSERT(&particles[i]==_bin.getMember(k));
+                    ASSERT(&particles[i]==bin.getMember(k));
                     
+                    Float* vel_cm = bin.getVel();
                     Float* gtgrad = force_[i].gtgrad;
                     Float* pert   = force_[i].acc_pert;
                     Float* vel = particles[i].getVel();
-                    Float vel_sd[3] = {(vel[0] - vel_cm[0]) * inv_nest_sd + _vel_sd_up[0], 
-                                       (vel[1] - vel_cm[1]) * inv_nest_sd + _vel_sd_up[1], 
-                                       (vel[2] - vel_cm[2]) * inv_nest_sd + _vel_sd_up[2]};
+                    Float vel_sd[3] = {(vel[0] - vel_cm[0]) * inv_nest_sd[j] + vel_sd_up[3*j], 
+                                       (vel[1] - vel_cm[1]) * inv_nest_sd[j] + vel_sd_up[3*j+1], 
+                                       (vel[2] - vel_cm[2]) * inv_nest_sd[j] + vel_sd_up[3*j+2]};
 
-                    de += particles[i].mass * (vel[0] * pert[0] +
-                                               vel[1] * pert[1] +
-                                               vel[2] * pert[2]);
+                    de_bin[j] += particles[i].mass * (vel[0] * pert[0] +
+                                                      vel[1] * pert[1] +
+                                                      vel[2] * pert[2]);
 #ifndef AR_TIME_FUNCTION_MULTI_R
-                    dgt_drift_inv +=  (vel_sd[0] * gtgrad[0] +
-                                       vel_sd[1] * gtgrad[1] +
-                                       vel_sd[2] * gtgrad[2]);
+                    dgt_bin[j] +=  (vel_sd[0] * gtgrad[0] +
+                                    vel_sd[1] * gtgrad[1] +
+                                    vel_sd[2] * gtgrad[2]);
 #endif
                 }
+                // binary is finished
+                if (k==1) {
+                    addToIntegrated(etot_ref_, etot_ref_lo_, _dt * de_bin[j]);
+                    addToIntegrated(etot_sd_ref_, etot_sd_ref_lo_, _dt * de_bin[j]);
+                }
             }
-            etot_ref_     += _dt * de;
-            etot_sd_ref_ += _dt * de;
-
-            return dgt_drift_inv;
-        }
 
-        //! kick energy and time transformation function for drift
-        /*!
-          @param[in] _dt: time step
-        */
-        void kickEtotAndGTDrift(const Float _dt) {
-            // the particle cm velocity is zero (assume in rest-frame)
-            ASSERT(!particles.isOriginFrame());
-            auto& bin_root=info.getBinaryTreeRoot();
-            Float vel_cm[3] = {0.0,0.0,0.0};
-            Float sd_factor=1.0;
-
-            Float dgt_drift_inv = kickEtotAndGTDriftTreeIter(_dt, vel_cm, sd_factor, bin_root);
+            Float dgt_drift_inv = dgt_bin[info.getBinaryTreeIndex(&info.getBinaryTreeRoot())];
 #ifdef AR_TIME_FUNCTION_MULTI_R
-            dgt_drift_inv = calcGTDriftInvIter(bin_root);
+            dgt_drift_inv = calcGTDriftInvIter(info.getBinaryTreeRoot());
 #endif
-            gt_drift_inv_ += dgt_drift_inv*_dt;
+            addToIntegrated(gt_drift_inv_, gt_drift_inv_lo_, dgt_drift_inv*_dt);
         }
 
 #else //! AR_TTL
@@ -836,8 +919,8 @@ namespace AR {
                               vel[1] * pert[1] +
                               vel[2] * pert[2]);
             }
-            etot_sd_ref_ += _dt * de;
-            etot_ref_ += _dt * de;
+            addToIntegrated(etot_sd_ref_, etot_sd_ref_lo_, _dt * de);
+            addToIntegrated(etot_ref_, etot_ref_lo_, _dt * de);
         }
 #endif // AR_TTL
 
@@ -1069,9 +1152,10 @@ namespace AR {
                 Float* acc = force[i].acc_in;
                 Float* pert= force[i].acc_pert;
                 // half dv 
-                vel[0] += _dt * (acc[0] + pert[0]);
-                vel[1] += _dt * (acc[1] + pert[1]);
-                vel[2] += _dt * (acc[2] + pert[2]);
+                const Float dvel[3] = {_dt * (acc[0] + pert[0]),
+                                       _dt * (acc[1] + pert[1]),
+                                       _dt * (acc[2] + pert[2])};
+                addToMemberPosVel(vel, i, 3, dvel);
             }
 #ifdef AR_SLOWDOWN_ARRAY
             // update c.m. of binaries 
@@ -1085,7 +1169,7 @@ namespace AR {
         */
         inline void driftTimeAndPos(const Float _dt) {
             // drift time 
-            time_ += _dt;
+            addToIntegrated(time_, time_lo_, _dt);
 
             // drift position
             const int num = particles.getSize();
@@ -1097,9 +1181,10 @@ namespace AR {
             for (int i=0; i<num; i++) {
                 Float* pos = pdat[i].getPos();
                 Float* vel = pdat[i].getVel();
-                pos[0] += dt_sd * vel[0]; 
-                pos[1] += dt_sd * vel[1];
-                pos[2] += dt_sd * vel[2];
+                const Float dpos[3] = {dt_sd * vel[0],
+                                       dt_sd * vel[1],
+                                       dt_sd * vel[2]};
+                addToMemberPosVel(pos, i, 0, dpos);
             }
 
             // correct postion drift due to inner binary slowdown
@@ -1108,9 +1193,10 @@ namespace AR {
             for (int i=0; i<num; i++) {
                 Float* pos = pdat[i].getPos();
                 Float* vel = pdat[i].getVel();
-                pos[0] += _dt * vel[0];
-                pos[1] += _dt * vel[1];
-                pos[2] += _dt * vel[2];
+                const Float dpos[3] = {_dt * vel[0],
+                                       _dt * vel[1],
+                                       _dt * vel[2]};
+                addToMemberPosVel(pos, i, 0, dpos);
             }
 #endif
         }
@@ -1182,10 +1268,10 @@ namespace AR {
                         vel[1] * gtgrad[1] +
                         vel[2] * gtgrad[2]);
             }
-            etot_ref_ += _dt * de;
+            addToIntegrated(etot_ref_, etot_ref_lo_, _dt * de);
 
 #ifdef AR_SLOWDOWN_ARRAY
-            etot_sd_ref_ += _dt * de;
+            addToIntegrated(etot_sd_ref_, etot_sd_ref_lo_, _dt * de);
 
             // correct gt_drift_inv
             const Float kappa_inv_global = 1.0/binary_slowdown[0]->slowdown.getSlowDownFactor();
@@ -1211,9 +1297,9 @@ namespace AR {
                     }
                 }
             }
-            gt_drift_inv_ += _dt * dg *kappa_inv_global;
+            addToIntegrated(gt_drift_inv_, gt_drift_inv_lo_, _dt * dg *kappa_inv_global);
 #else
-            gt_drift_inv_ += _dt * dg;
+            addToIntegrated(gt_drift_inv_, gt_drift_inv_lo_, _dt * dg);
 #endif
         }
 
@@ -1236,76 +1322,79 @@ namespace AR {
                               vel[2] * pert[2]);
             }
 #ifdef AR_SLOWDOWN_ARRAY
-            etot_sd_ref_ += _dt * de;
+            addToIntegrated(etot_sd_ref_, etot_sd_ref_lo_, _dt * de);
 #endif
-            etot_ref_ += _dt * de;
+            addToIntegrated(etot_ref_, etot_ref_lo_, _dt * de);
         }
 #endif //AR_TTL
 
 #endif // AR_SLOWDOWN_TREE
 
-        //! update slowdown velocity iteration function with binary tree
-        void updateBinaryVelIter(AR::BinaryTree<Tparticle>& _bin) {
-            _bin.vel[0]= _bin.vel[1] = _bin.vel[2] = 0.0;
-            Float mcm_inv = 1.0/_bin.mass;
-            for (int k=0; k<2; k++) {
-                if (_bin.isMemberTree(k)) {
-                    auto* bink = _bin.getMemberAsTree(k);
-                    updateBinaryVelIter(*bink);
-                    _bin.vel[0] += bink->mass*bink->vel[0];
-                    _bin.vel[1] += bink->mass*bink->vel[1];
-                    _bin.vel[2] += bink->mass*bink->vel[2];
-                }
-                else {
-                    auto* pk = _bin.getMember(k);
-                    _bin.vel[0] += pk->mass*pk->vel[0];
-                    _bin.vel[1] += pk->mass*pk->vel[1];
-                    _bin.vel[2] += pk->mass*pk->vel[2];
+        //! update binary c.m. velocity
+        /*! Flat walk over info.tree_member_postorder, the members of a binary are updated before it
+         */
+        void updateBinaryVel() {
+            AR::BinaryTree<Tparticle>* bins = info.binarytree.getDataAddress();
+            const int* members = info.tree_member_postorder.getDataAddress();
+            const int n_member = info.tree_member_postorder.getSize();
+            for (int n=0; n<n_member; n++) {
+                const int j = members[n]>>1;
+                const int k = members[n]&1;
+                auto& bin = bins[j];
+                if (k==0) bin.vel[0]= bin.vel[1] = bin.vel[2] = 0.0;
+                Tparticle* pk = bin.getMember(k);
+                // binary tree is also a particle type (c.m.)
+                bin.vel[0] += pk->mass*pk->vel[0];
+                bin.vel[1] += pk->mass*pk->vel[1];
+                bin.vel[2] += pk->mass*pk->vel[2];
+                if (k==1) {
+                    Float mcm_inv = 1.0/bin.mass;
+                    bin.vel[0] *= mcm_inv;
+                    bin.vel[1] *= mcm_inv;
+                    bin.vel[2] *= mcm_inv;
                 }
             }
-            _bin.vel[0] *= mcm_inv;
-            _bin.vel[1] *= mcm_inv;
-            _bin.vel[2] *= mcm_inv;
         }
 
-        //! update binary cm iteratively
-        void updateBinaryCMIter(AR::BinaryTree<Tparticle>& _bin) {
-            _bin.pos[0]= _bin.pos[1] = _bin.pos[2] = 0.0;
-            _bin.vel[0]= _bin.vel[1] = _bin.vel[2] = 0.0;
-            Float mcm_member = 0.0;
-            for (int k=0; k<2; k++) {
-                if (_bin.isMemberTree(k)) {
-                    auto* bink = _bin.getMemberAsTree(k);
-                    updateBinaryCMIter(*bink);
-                    mcm_member  += bink->mass;
-                    _bin.pos[0] += bink->mass*bink->pos[0];
-                    _bin.pos[1] += bink->mass*bink->pos[1];
-                    _bin.pos[2] += bink->mass*bink->pos[2];
-                    _bin.vel[0] += bink->mass*bink->vel[0];
-                    _bin.vel[1] += bink->mass*bink->vel[1];
-                    _bin.vel[2] += bink->mass*bink->vel[2];
+        //! update binary c.m. mass, position and velocity
+        /*! Flat walk over info.tree_member_postorder, the members of a binary are updated before it
+         */
+        void updateBinaryCM() {
+            AR::BinaryTree<Tparticle>* bins = info.binarytree.getDataAddress();
+            const int* members = info.tree_member_postorder.getDataAddress();
+            const int n_member = info.tree_member_postorder.getSize();
+            COMM::ScratchScope scratch;
+            Float* mcm_member = scratch.allocate<Float>(info.binarytree.getSize());
+            for (int n=0; n<n_member; n++) {
+                const int j = members[n]>>1;
+                const int k = members[n]&1;
+                auto& bin = bins[j];
+                if (k==0) {
+                    bin.pos[0]= bin.pos[1] = bin.pos[2] = 0.0;
+                    bin.vel[0]= bin.vel[1] = bin.vel[2] = 0.0;
+                    mcm_member[j] = 0.0;
                 }
-                else {
-                    auto* pk = _bin.getMember(k);
-                    mcm_member  += pk->mass;
-                    _bin.pos[0] += pk->mass*pk->pos[0];
-                    _bin.pos[1] += pk->mass*pk->pos[1];
-                    _bin.pos[2] += pk->mass*pk->pos[2];
-                    _bin.vel[0] += pk->mass*pk->vel[0];
-                    _bin.vel[1] += pk->mass*pk->vel[1];
-                    _bin.vel[2] += pk->mass*pk->vel[2];
-                }
-            }
-            Float mcm_inv = 1.0/mcm_member;
-            _bin.mass = mcm_member;
-            _bin.m1 = _bin.getLeftMember()->mass;
-            _bin.m2 = _bin.getRightMember()->mass;
-            _bin.vel[0] *= mcm_inv;
-            _bin.vel[1] *= mcm_inv;
-            _bin.vel[2] *= mcm_inv;
-            _bin.pos[0] *= mcm_inv;
-            _bin.pos[1] *= mcm_inv;
-            _bin.pos[2] *= mcm_inv;
+                Tparticle* pk = bin.getMember(k);
+                mcm_member[j] += pk->mass;
+                bin.pos[0] += pk->mass*pk->pos[0];
+                bin.pos[1] += pk->mass*pk->pos[1];
+                bin.pos[2] += pk->mass*pk->pos[2];
+                bin.vel[0] += pk->mass*pk->vel[0];
+                bin.vel[1] += pk->mass*pk->vel[1];
+                bin.vel[2] += pk->mass*pk->vel[2];
+                if (k==1) {
+                    Float mcm_inv = 1.0/mcm_member[j];
+                    bin.mass = mcm_member[j];
+                    bin.m1 = bin.getLeftMember()->mass;
+                    bin.m2 = bin.getRightMember()->mass;
+                    bin.vel[0] *= mcm_inv;
+                    bin.vel[1] *= mcm_inv;
+                    bin.vel[2] *= mcm_inv;
+                    bin.pos[0] *= mcm_inv;
+                    bin.pos[1] *= mcm_inv;
+                    bin.pos[2] *= mcm_inv;
+                }
+            }
         }
 
         //! set all binary c.m. mass to zero
@@ -1778,7 +1867,7 @@ namespace AR {
                 ASSERT(!ISNAN(dt));
                 
                 // drift time 
-                time_ += dt;
+                addToIntegrated(time_, time_lo_, dt);
 
                 // update real time
                 _time_table[i] = time_;
@@ -1787,22 +1876,16 @@ namespace AR {
                 Float dt_sd = dt*kappa_inv;
 
                 // drift position
-                pos1[0] += dt_sd * vel1[0];
-                pos1[1] += dt_sd * vel1[1];
-                pos1[2] += dt_sd * vel1[2];
-
-                pos2[0] += dt_sd * vel2[0];
-                pos2[1] += dt_sd * vel2[1];
-                pos2[2] += dt_sd * vel2[2];
+                const Float dpos1[3] = {dt_sd * vel1[0], dt_sd * vel1[1], dt_sd * vel1[2]};
+                const Float dpos2[3] = {dt_sd * vel2[0], dt_sd * vel2[1], dt_sd * vel2[2]};
+                addToMemberPosVel(pos1, 0, 0, dpos1);
+                addToMemberPosVel(pos2, 1, 0, dpos2);
 #else
                 // drift position
-                pos1[0] += dt * vel1[0];
-                pos1[1] += dt * vel1[1];
-                pos1[2] += dt * vel1[2];
-
-                pos2[0] += dt * vel2[0];
-                pos2[1] += dt * vel2[1];
-                pos2[2] += dt * vel2[2];
+                const Float dpos1[3] = {dt * vel1[0], dt * vel1[1], dt * vel1[2]};
+                const Float dpos2[3] = {dt * vel2[0], dt * vel2[1], dt * vel2[2]};
+                addToMemberPosVel(pos1, 0, 0, dpos1);
+                addToMemberPosVel(pos2, 1, 0, dpos2);
 #endif
 
                 // step for kick
@@ -1848,13 +1931,8 @@ namespace AR {
                 dvel2[2] = dt * (acc2[2] + pert2[2]);
 #endif
 
-                vel1[0] += dvel1[0];
-                vel1[1] += dvel1[1];
-                vel1[2] += dvel1[2];
-
-                vel2[0] += dvel2[0];
-                vel2[1] += dvel2[1];
-                vel2[2] += dvel2[2];
+                addToMemberPosVel(vel1, 0, 3, dvel1);
+                addToMemberPosVel(vel2, 1, 3, dvel2);
 
 #ifdef AR_DEBUG_PRINT_DKD
                 std::cout<<"D "<<time_<<" "
@@ -1864,12 +1942,13 @@ namespace AR {
 #endif
 
                 // kick total energy and time transformation factor for drift
-                etot_ref_ += 2.0*dt * (mass1* (vel1[0] * pert1[0] + 
-                                               vel1[1] * pert1[1] + 
-                                               vel1[2] * pert1[2]) +
-                                       mass2* (vel2[0] * pert2[0] + 
-                                               vel2[1] * pert2[1] + 
-                                               vel2[2] * pert2[2]));
+                addToIntegrated(etot_ref_, etot_ref_lo_,
+                                2.0*dt * (mass1* (vel1[0] * pert1[0] + 
+                                                  vel1[1] * pert1[1] + 
+                                                  vel1[2] * pert1[2]) +
+                                          mass2* (vel2[0] * pert2[0] + 
+                                                  vel2[1] * pert2[1] + 
+                                                  vel2[2] * pert2[2])));
 
 #ifdef AR_TTL   
                 // back up gt_kick_inv
@@ -1877,32 +1956,29 @@ namespace AR {
 
 #if (defined AR_SLOWDOWN_ARRAY ) || (defined AR_SLOWDOWN_TREE)
                 // integrate gt_drift_inv
-                gt_drift_inv_ +=  2.0*dt*kappa_inv*kappa_inv* (vel1[0] * gtgrad1[0] +
-                                                               vel1[1] * gtgrad1[1] +
-                                                               vel1[2] * gtgrad1[2] +
-                                                               vel2[0] * gtgrad2[0] +
-                                                               vel2[1] * gtgrad2[1] +
-                                                               vel2[2] * gtgrad2[2]);
+                addToIntegrated(gt_drift_inv_, gt_drift_inv_lo_,
+                                2.0*dt*kappa_inv*kappa_inv* (vel1[0] * gtgrad1[0] +
+                                                             vel1[1] * gtgrad1[1] +
+                                                             vel1[2] * gtgrad1[2] +
+                                                             vel2[0] * gtgrad2[0] +
+                                                             vel2[1] * gtgrad2[1] +
+                                                             vel2[2] * gtgrad2[2]));
 #else
                 // integrate gt_drift_inv
-                gt_drift_inv_ +=  2.0*dt* (vel1[0] * gtgrad1[0] +
-                                           vel1[1] * gtgrad1[1] +
-                                           vel1[2] * gtgrad1[2] +
-                                           vel2[0] * gtgrad2[0] +
-                                           vel2[1] * gtgrad2[1] +
-                                           vel2[2] * gtgrad2[2]);
+                addToIntegrated(gt_drift_inv_, gt_drift_inv_lo_,
+                                2.0*dt* (vel1[0] * gtgrad1[0] +
+                                         vel1[1] * gtgrad1[1] +
+                                         vel1[2] * gtgrad1[2] +
+                                         vel2[0] * gtgrad2[0] +
+                                         vel2[1] * gtgrad2[1] +
+                                         vel2[2] * gtgrad2[2]));
 #endif 
 
 #endif // AR_TTL
 
                 // kick half step for velocity
-                vel1[0] += dvel1[0];
-                vel1[1] += dvel1[1];
-                vel1[2] += dvel1[2];
-                
-                vel2[0] += dvel2[0];
-                vel2[1] += dvel2[1];
-                vel2[2] += dvel2[2];
+                addToMemberPosVel(vel1, 0, 3, dvel1);
+                addToMemberPosVel(vel2, 1, 3, dvel2);
                                                                                                                 
                 // calculate kinetic energy
                 ekin_ = 0.5 * (mass1 * (vel1[0]*vel1[0]+vel1[1]*vel1[1]+vel1[2]*vel1[2]) +
@@ -1917,7 +1993,251 @@ namespace AR {
             epot_sd_ = epot_*kappa_inv;
 #endif
         }
+
+        //! Gragg-Bulirsch-Stoer extrapolation of one step
+        /*! The step _ds is integrated in stage j (j=1,2,...) by j symplectic steps (integrateOneStep or integrateTwoOneStep) with the step size _ds/j from the same initial data.
+          Since the symplectic step is time symmetric, its error has an expansion in even powers of the step size,
+          thus all integrated data (see backupIntData) are extrapolated to zero step size by the Aitken-Neville scheme in (_ds/j)^2.
+          The order is adaptive: the stages stop when the difference of the last two extrapolated values of positions and velocities (relative to their maximum values) is below manager->energy_error_relative_max,
+          or manager->extrapolation_stage_max is reached. 
+          Then the force, potential and kinetic energy are recalculated from the extrapolated data. 
+          The slowdown factors are fixed during the step.
+          @param[in] _ds: step size
+          @param[out] _time_table: sub-step times interpolated from the sub-step times of the last stage to the cumsum of c_k in the symplectic step, used for the time synchronization, size should be consistent with step.getCDPairSize().
+          @param[out] _ds_modify_factor: step modification factor for the next step (or for redoing this step if the extrapolation does not converge), chosen by the minimum number of sub-steps per step size over all stages; if the last stage is the optimal one, the step is enlarged to use one more stage
+          \return true: the extrapolation converges
+        */
+        bool integrateExtrapolationOneStep(const Float _ds, Float _time_table[], Float& _ds_modify_factor) {
+            ASSERT(checkParams());
+            ASSERT(_ds>0);
+
+            const int n_particle = particles.getSize();
+            const int n_stage_max = manager->extrapolation_stage_max;
+            ASSERT(n_stage_max>=2);
+            const int bk_size = getBackupDataSize();
+            // offset and size of particle positions and velocities in the backup data
+            const int n_pos_vel = 6*n_particle;
+            const int i_pos_vel = bk_size - n_pos_vel - (manager->precision_extend_option>0? getBackupLowDataSize(): 0);
+
+            COMM::ScratchScope scratch;
+            Float* data_init = scratch.allocate<Float>(bk_size);
+            Float* data = scratch.allocate<Float>(bk_size);
+            Float* table = scratch.allocate<Float>(n_stage_max*bk_size); // Aitken-Neville table, row l: extrapolation with l+1 stages
+            Float* time_sub = scratch.allocate<Float>(n_stage_max+1); // sub-step times of the current stage
+            Float* ds_factor = scratch.allocate<Float>(n_stage_max); // optimal step modification factor of each stage
+
+            backupIntData(data_init);
+
+            // scale of positions and velocities for the error estimation, maximum of the initial and the first stage values
+            Float pos_scale = 0.0, vel_scale = 0.0;
+            auto updateScale = [&](const Float* _data) {
+                for (int i=0; i<n_particle; i++) {
+                    const Float* pv = &_data[i_pos_vel+6*i];
+                    pos_scale = std::max(pos_scale, sqrt(pv[0]*pv[0]+pv[1]*pv[1]+pv[2]*pv[2]));
+                    vel_scale = std::max(vel_scale, sqrt(pv[3]*pv[3]+pv[4]*pv[4]+pv[5]*pv[5]));
+                }
+            };
+            updateScale(data_init);
+            const Float error_tol = manager->energy_error_relative_max;
+
+            bool converge_flag = false;
+            int n_stage = 0;
+            for (int j=0; j<n_stage_max; j++) {
+                const int n_sub = j+1;
+                if (j>0) {
+                    restoreIntData(data_init);
+                    updateBinaryCM();
+                }
+                time_sub[0] = time_;
+                const Float ds_sub = _ds/n_sub;
+                for (int k=0; k<n_sub; k++) {
+                    if(n_particle==2) integrateTwoOneStep(ds_sub, _time_table);
+                    else integrateOneStep(ds_sub, _time_table);
+                    time_sub[k+1] = time_;
+                }
+                profile.step_count_extrapolation_sum += n_sub;
+                n_stage = j+1;
+
+                // Aitken-Neville extrapolation in (_ds/n_sub)^2, row l is overwritten by the new one from the previous rows l-1 
+                backupIntData(data);
+                for (int i=0; i<bk_size; i++) {
+                    Float t_prev = j>0? table[i]: 0.0;
+                    table[i] = data[i];
+                    for (int l=1; l<=j; l++) {
+                        const Float n_ratio = Float(n_sub)/Float(n_sub-l);
+                        const Float t_tmp = table[l*bk_size+i];
+                        table[l*bk_size+i] = table[(l-1)*bk_size+i] + (table[(l-1)*bk_size+i] - t_prev)/(n_ratio*n_ratio - 1.0);
+                        t_prev = t_tmp;
+                    }
+                }
+                if (j==0) {
+                    updateScale(data);
+                    ASSERT(pos_scale>0.0&&vel_scale>0.0);
+                    continue;
+                }
+
+                // error estimation from the last two extrapolated values
+                Float error = 0.0;
+                const Float* t_new = &table[j*bk_size+i_pos_vel];
+                const Float* t_old = &table[(j-1)*bk_size+i_pos_vel];
+                for (int i=0; i<n_pos_vel; i+=6) {
+                    for (int k=0; k<3; k++) {
+                        error = std::max(error, abs(t_new[i+k]-t_old[i+k])/pos_scale);
+                        error = std::max(error, abs(t_new[i+k+3]-t_old[i+k+3])/vel_scale);
+                    }
+                }
+                error = std::max(error/error_tol, Float(1e-4));
+
+                // the error of the row j-1 extrapolation scales as _ds^(2j+1)
+                ds_factor[j] = 0.94*pow(0.65/error, Float(1.0/(2*j+1)));
+
+                if (error<=1.0) {
+                    converge_flag = true;
+                    break;
+                }
+            }
+
+            // use the last extrapolated data
+            restoreIntData(&table[(n_stage-1)*bk_size]);
+            updateBinaryCM();
+            Float gt_kick_inv = calcAccPotAndGTKickInv();
+#ifdef AR_TTL
+            gt_kick_inv_ = gt_kick_inv;
+#else
+            (void)gt_kick_inv;
+#endif
+            calcEKin();
+#if (defined AR_SLOWDOWN_ARRAY ) || (defined AR_SLOWDOWN_TREE)
+            if (n_particle==2) {
+                const Float kappa_inv = 1.0/info.getBinaryTreeRoot().slowdown.getSlowDownFactor();
+                ekin_sd_ = ekin_*kappa_inv;
+                epot_sd_ = epot_*kappa_inv;
+            }
+#endif
+
+            // sub-step time table from the last stage, linearly interpolated to cumsum c_k
+            time_sub[n_stage] = time_;
+            Float cck = 0.0;
+            for (int k=0; k<manager->step.getCDPairSize(); k++) {
+                cck += manager->step.getCK(k);
+                const Float x = cck*n_stage;
+                const int i = std::min(std::max(to_int(x), 0), n_stage-1);
+                _time_table[k] = time_sub[i] + (x-i)*(time_sub[i+1]-time_sub[i]);
+            }
+
+            // choose the stage with the minimum number of sub-steps per step size: stage j costs (j+1)(j+2)/2 sub-steps
+            auto calcWork = [](const int _j) { return Float((_j+1)*(_j+2)/2); };
+            Float work_min = NUMERIC_FLOAT_MAX;
+            int j_opt = 1;
+            for (int j=1; j<n_stage; j++) {
+                const Float work = calcWork(j)/ds_factor[j];
+                if (work<work_min) {
+                    work_min = work;
+                    j_opt = j;
+                }
+            }
+            _ds_modify_factor = ds_factor[j_opt];
+            // if the last stage is the optimal one, increase the order: enlarge the step by the work ratio of one more stage
+            if (converge_flag && j_opt==n_stage-1 && n_stage<n_stage_max) _ds_modify_factor *= calcWork(j_opt+1)/calcWork(j_opt);
+            _ds_modify_factor = std::min(std::max(_ds_modify_factor, Float(0.2)), Float(4.0));
+
+            return converge_flag;
+        }
         
+#ifdef AR_SLOWDOWN_TREE
+        //! integrate a weakly perturbed two-body system to the given time by the Kepler drift
+        /*! Used when manager->kepler_pert_ratio_max>0, interruption detection is off, the system is a bound binary and the slowdown perturbation ratio pert_out/pert_in (updated by updateSlowDownAndCorrectEnergy) is below manager->kepler_pert_ratio_max.
+          The relative orbit is evolved analytically by the slowdown time (_time_end - time_)/kappa with COMM::KeplerUniversal, the c.m. of the members drifts with the same time. The perturbation is included to first order by two half kicks before and after the Kepler drift (the first one uses force_ from the end of the last integration), and the work is added to the integrated energy.
+          The Kepler solution is exact only without softening in the interaction.
+          @param[in] _time_end: the expected finishing time without offset
+          \return true: integrated to _time_end; false: conditions are not satisfied or the Kepler solver fails, the system is not changed
+        */
+        bool integrateTwoKeplerToTime(const Float _time_end) {
+            if (manager->kepler_pert_ratio_max<=0.0 || manager->interrupt_detection_option>0 || particles.getSize()!=2) return false;
+            auto& sd_root = info.getBinaryTreeRoot().slowdown;
+            if (sd_root.pert_in<=0.0 || sd_root.pert_out>=manager->kepler_pert_ratio_max*sd_root.pert_in) return false;
+
+            Tparticle* p = particles.getDataAddress();
+            const Float G = manager->interaction.gravitational_constant;
+            COMM::Binary bin;
+            bin.calcOrbit(p[0], p[1], G);
+            if (bin.semi<=0.0 || bin.ecc>=1.0) return false;
+
+            const Float dt = _time_end - time_;
+            const Float kappa_inv = 1.0/sd_root.getSlowDownFactor();
+            Force* force = force_.getDataAddress();
+
+            // backup for the case that the Kepler solver fails
+            const Float etot_ref_bk = etot_ref_;
+            Float vel_bk[2][3];
+            for (int i=0; i<2; i++) 
+                for (int k=0; k<3; k++) vel_bk[i][k] = p[i].vel[k];
+
+            // kick velocities by perturbation and integrate the work
+            auto kickPert = [&](const Float _dt) {
+                for (int i=0; i<2; i++) {
+                    const Float* pert = force[i].acc_pert;
+                    Float* vel = p[i].getVel();
+                    const Float dvel[3] = {_dt*pert[0], _dt*pert[1], _dt*pert[2]};
+                    // m (v_old + v_new)/2 * dv
+                    etot_ref_ += p[i].mass*((vel[0]+0.5*dvel[0])*dvel[0] + (vel[1]+0.5*dvel[1])*dvel[1] + (vel[2]+0.5*dvel[2])*dvel[2]);
+                    vel[0] += dvel[0];
+                    vel[1] += dvel[1];
+                    vel[2] += dvel[2];
+                }
+            };
+
+            // the first half kick uses the perturbation from the end of the last integration
+            kickPert(0.5*dt);
+
+            // Kepler drift of the relative orbit, the c.m. of members drifts linearly
+            const Float dt_sd = dt*kappa_inv;
+            const Float mtot = p[0].mass + p[1].mass;
+            Float pos_cm[3], vel_cm[3];
+            for (int k=0; k<3; k++) {
+                vel_cm[k] = (p[0].mass*p[0].vel[k] + p[1].mass*p[1].vel[k])/mtot;
+                pos_cm[k] = (p[0].mass*p[0].pos[k] + p[1].mass*p[1].pos[k])/mtot + dt_sd*vel_cm[k];
+            }
+            Float dpos[3] = {p[1].pos[0]-p[0].pos[0], p[1].pos[1]-p[0].pos[1], p[1].pos[2]-p[0].pos[2]};
+            Float dvel[3] = {p[1].vel[0]-p[0].vel[0], p[1].vel[1]-p[0].vel[1], p[1].vel[2]-p[0].vel[2]};
+            if (!COMM::KeplerUniversal::propagate(G*mtot, dpos, dvel, dt_sd)) {
+                // undo the first half kick and use the AR integration
+                etot_ref_ = etot_ref_bk;
+                for (int i=0; i<2; i++) 
+                    for (int k=0; k<3; k++) p[i].vel[k] = vel_bk[i][k];
+                return false;
+            }
+            const Float m1_mt = p[0].mass/mtot;
+            const Float m2_mt = p[1].mass/mtot;
+            for (int k=0; k<3; k++) {
+                p[0].pos[k] = pos_cm[k] - m2_mt*dpos[k];
+                p[0].vel[k] = vel_cm[k] - m2_mt*dvel[k];
+                p[1].pos[k] = pos_cm[k] + m1_mt*dpos[k];
+                p[1].vel[k] = vel_cm[k] + m1_mt*dvel[k];
+            }
+            time_ = _time_end;
+
+#ifdef AR_TTL
+            // the integrated gt_drift_inv is not available, reset to the current value
+            gt_kick_inv_ = kappa_inv*manager->interaction.calcAccPotAndGTKickInv(force, epot_, p, 2, particles.cm, perturber, time_);
+            gt_drift_inv_ = gt_kick_inv_;
+#else
+            manager->interaction.calcAccPotAndGTKickInv(force, epot_, p, 2, particles.cm, perturber, time_);
+#endif
+            kickPert(0.5*dt);
+
+            ekin_ = 0.5 * (p[0].mass * (p[0].vel[0]*p[0].vel[0]+p[0].vel[1]*p[0].vel[1]+p[0].vel[2]*p[0].vel[2]) +
+                           p[1].mass * (p[1].vel[0]*p[1].vel[0]+p[1].vel[1]*p[1].vel[1]+p[1].vel[2]*p[1].vel[2]));
+
+            // make consistent slowdown inner energy 
+            etot_sd_ref_ = etot_ref_*kappa_inv;
+            ekin_sd_ = ekin_*kappa_inv;
+            epot_sd_ = epot_*kappa_inv;
+
+            return true;
+        }
+#endif
+
         // Integrate the system to a given time
         /*!
           @param[in] _time_end: the expected finishing time without offset
@@ -1938,18 +2258,27 @@ namespace AR {
             //const Float energy_error_rel_max_half_step = energy_error_rel_max * manager->step.calcErrorRatioFromStepModifyFactor(0.5);
             //const Float dt_min = manager->time_step_min;
 
+            // temporary arrays in the scratch arena of the thread, released at return
+            COMM::ScratchScope scratch;
+
+            // the extended precision mode is only used inside one call, switch back at return
+            struct PrecisionScope {
+                TimeTransformedSymplecticIntegrator* sym;
+                ~PrecisionScope() { sym->reducePrecision(); }
+            } precision_scope = {this};
+
             // backup data size
             const int bk_data_size = getBackupDataSize();
             
-            Float backup_data[bk_data_size]; // for backup chain data
+            Float* backup_data = scratch.allocate<Float>(bk_data_size); // for backup chain data
 #ifdef AR_DEBUG_DUMP
-            Float backup_data_init[bk_data_size]; // for backup initial data
+            Float* backup_data_init = scratch.allocate<Float>(bk_data_size); // for backup initial data
 #endif
             bool backup_flag=true; // flag for backup or restore
 
             // time table
             const int cd_pair_size = manager->step.getCDPairSize();
-            Float time_table[cd_pair_size]; // for storing sub-integrated time 
+            Float* time_table = scratch.allocate<Float>(cd_pair_size); // for storing sub-integrated time 
 
             // two switch step control
             Float ds[2] = {info.ds,info.ds}; // step with a buffer
@@ -2026,6 +2355,14 @@ namespace AR {
             Float previous_error_ratio=-1; // previous error ratio when ds is reduced
             bool previous_is_restore=false; // previous step is reduced or not
 
+            // predictive step size control (ds_control_option=1)
+            Float ds_control_error_ratio_prev=-1; // integration error / energy_error_rel_max of the previous accepted step
+            bool ds_control_reject=false; // the previous step is rejected, do not increase ds in the next step
+
+            // extrapolation driver (extrapolation_option=1)
+            bool extrapolation_converge_flag=true; // the extrapolation of the last step converges
+            Float extrapolation_ds_factor=1.0; // step modification factor suggested by the extrapolation
+
             // time end control
             int n_step_end=0;  // number of steps integrated to reach the time end for one during the time sychronization sub steps
             bool time_end_flag=false; // indicate whether time reach the end
@@ -2078,6 +2415,16 @@ namespace AR {
 #ifdef AR_SLOWDOWN_TREE
             // update slowdown and correct slowdown energy and gt_inv
             updateSlowDownAndCorrectEnergy(true, true);
+
+            // weakly perturbed binary, use the Kepler drift instead of AR steps
+            if (integrateTwoKeplerToTime(_time_end)) {
+                // count the Kepler drift as one step
+                profile.step_count = 1;
+                profile.step_count_tsyn = 0;
+                profile.step_count_sum++;
+                profile.kepler_count_sum++;
+                return bin_interrupt_return;
+            }
 #endif
 
 
@@ -2369,7 +2716,7 @@ namespace AR {
                     // binary c.m. is not backup, thus recalculate to get correct c.m. velocity for position drift correction due to slowdown inner (the first drift in integrateonestep assume c.m. vel is up to date)
 //                    updateCenterOfMassForBinaryWithSlowDownInner();
 //#elif AR_SLOWDOWN_TREE
-                    updateBinaryCMIter(info.getBinaryTreeRoot());
+                    updateBinaryCM();
 //#endif
                 }
 
@@ -2378,7 +2725,8 @@ namespace AR {
 
                 // integrate one step
                 ASSERT(!ISINF(ds[ds_switch]));
-                if(n_particle==2) integrateTwoOneStep(ds[ds_switch], time_table);
+                if(manager->extrapolation_option>0) extrapolation_converge_flag = integrateExtrapolationOneStep(ds[ds_switch], time_table, extrapolation_ds_factor);
+                else if(n_particle==2) integrateTwoOneStep(ds[ds_switch], time_table);
                 else integrateOneStep(ds[ds_switch], time_table);
                 //info.generateBinaryTree(particles, G);
 
@@ -2387,6 +2735,7 @@ namespace AR {
 //                ASSERT(dt>0.0);
                 
                 step_count++;
+                if (precision_extended_flag_) profile.step_count_extended_sum++;
 
                 // energy check
 #if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
@@ -2489,6 +2838,21 @@ namespace AR {
                 };
 #endif 
 
+                // if the extrapolation does not converge, reduce step and redo
+                if (manager->extrapolation_option>0 && !extrapolation_converge_flag && info.fix_step_option!=FixStepOption::always) {
+                    ASSERT(extrapolation_ds_factor<1.0);
+                    ds[ds_switch] *= extrapolation_ds_factor;
+                    ds[1-ds_switch] = ds[ds_switch];
+                    ASSERT(!ISINF(ds[ds_switch]));
+                    ds_control_reject = true;
+                    backup_flag = false;
+                    profile.step_count_reject_sum++;
+#ifdef AR_COLLECT_DS_MODIFY_INFO
+                    collectDsModifyInfo("Extrapolation_not_converge");
+#endif
+                    continue;
+                }
+
 //#ifdef AR_WARN
                 // warning for large number of steps
                 if(warning_print_once&&step_count>=manager->step_count_max) {
@@ -2584,6 +2948,17 @@ namespace AR {
                         if (integration_error_ratio>0.5*previous_error_ratio) check_flag=false;
                     }
 
+                    // if error does not reduce, the round-off error may dominate, extend precision and redo the step
+                    if (!check_flag && manager->precision_extend_option>0 && !precision_extended_flag_) {
+                        extendPrecision();
+                        backup_flag = false;
+                        profile.step_count_reject_sum++;
+#ifdef AR_COLLECT_DS_MODIFY_INFO
+                        collectDsModifyInfo("Extend_precision");
+#endif
+                        continue;
+                    }
+
                     if (check_flag) {
                         // for initial steps, reduce step permanently 
                         if(step_count<5) {
@@ -2604,6 +2979,7 @@ namespace AR {
                             ds_backup.initial(info.ds);
 
                             backup_flag = false;
+                            profile.step_count_reject_sum++;
 #ifdef AR_COLLECT_DS_MODIFY_INFO
                             collectDsModifyInfo("Large_energy_error");
 #endif
@@ -2620,7 +2996,9 @@ namespace AR {
                             previous_step_modify_factor = step_modify_factor;
                             previous_error_ratio = integration_error_ratio;
 
-                            ds_backup.backup(ds[ds_switch], step_modify_factor);
+                            // the predictive controller recovers ds itself, no backup level is needed
+                            if (manager->ds_control_option>0 || manager->extrapolation_option>0) ds_control_reject = true;
+                            else ds_backup.backup(ds[ds_switch], step_modify_factor);
                             if(previous_is_restore) reduce_ds_count++;
 
                             ds[ds_switch] *= step_modify_factor;
@@ -2636,6 +3014,7 @@ namespace AR {
                             //}
 
                             backup_flag = false;
+                            profile.step_count_reject_sum++;
 #ifdef AR_COLLECT_DS_MODIFY_INFO
                             collectDsModifyInfo("Large_energy_error");
 #endif
@@ -2667,11 +3046,13 @@ namespace AR {
                         //info.ds = ds[ds_switch];
                         ds_backup.initial(info.ds);
                     }
+                    else if (manager->ds_control_option>0 || manager->extrapolation_option>0) ds_control_reject = true;
                     else { // reduce step temparely
                         ds_backup.backup(ds[ds_switch], step_modify_factor);
                     }
 
                     backup_flag = false;
+                    profile.step_count_reject_sum++;
 
 #ifdef AR_COLLECT_DS_MODIFY_INFO
                     collectDsModifyInfo("Negative_step");
@@ -2688,11 +3069,35 @@ namespace AR {
                 // if no modification, reset previous values
                 previous_step_modify_factor = 1.0;
                 previous_error_ratio = -1.0;
+                profile.step_count_accept_sum++;
+
+                // if the rounding error of time is larger than the energy error criterion times the step, extend precision for the following steps
+                if (manager->precision_extend_option>0 && !precision_extended_flag_ && dt>0 && ROUND_OFF_ERROR_LIMIT*abs(time_)>energy_error_rel_max*dt) 
+                    extendPrecision();
 
                 // check integration time
                 if(time_ < _time_end - time_error){
                     // step increase depend on n_step_wait_recover_ds
-                    if(info.fix_step_option==FixStepOption::none && !time_end_flag) {
+                    if(info.fix_step_option==FixStepOption::none && !time_end_flag && manager->extrapolation_option>0) {
+                        // the extrapolation suggests the step size from the work per step of stages, not increased after a rejected step, kept for the next integration
+                        step_modify_factor = extrapolation_ds_factor;
+                        if (ds_control_reject) step_modify_factor = std::min(step_modify_factor, Float(1.0));
+                        ds[1-ds_switch] *= step_modify_factor;
+                        info.ds = ds[1-ds_switch];
+                        ASSERT(!ISINF(ds[1-ds_switch]));
+                        ds_control_reject = false;
+                    }
+                    else if(info.fix_step_option==FixStepOption::none && !time_end_flag && manager->ds_control_option>0) {
+                        // predictive controller, ds is not increased after a rejected step and is limited by the initial ds
+                        const Float error_ratio = integration_error_rel_abs/energy_error_rel_max;
+                        step_modify_factor = calcDsControlFactor(error_ratio, ds_control_error_ratio_prev);
+                        if (ds_control_reject) step_modify_factor = std::min(step_modify_factor, Float(1.0));
+                        ds[1-ds_switch] = std::min(ds[1-ds_switch]*step_modify_factor, ds_init);
+                        ASSERT(!ISINF(ds[1-ds_switch]));
+                        ds_control_error_ratio_prev = error_ratio;
+                        ds_control_reject = false;
+                    }
+                    else if(info.fix_step_option==FixStepOption::none && !time_end_flag) {
                         // waiting step count reach
                         previous_is_restore=ds_backup.countAndRecover(ds[1-ds_switch], step_modify_factor, integration_error_ratio>error_increase_ratio_regular);
                         if (previous_is_restore) {
@@ -2717,8 +3122,26 @@ namespace AR {
                         }
                     }
 
+                    // one-shot time sychronization: Newton step on ds to reach the time end, dt/ds = 1/gt_drift_inv at the current state
+                    if(time_end_flag && manager->time_sync_option>0) {
+                        step_count_tsyn++;
+
+#ifdef AR_TTL
+                        const Float gt_drift_inv = gt_drift_inv_;
+#elif (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+                        const Float gt_drift_inv = manager->interaction.calcGTDriftInv(ekin_sd_-etot_sd_ref_);
+#else
+                        const Float gt_drift_inv = manager->interaction.calcGTDriftInv(ekin_-etot_ref_);
+#endif
+                        ds[1-ds_switch] = (_time_end - time_)*gt_drift_inv;
+                        ASSERT(ds[1-ds_switch]>0.0);
+                        ASSERT(!ISINF(ds[1-ds_switch]));
+#ifdef AR_DEEP_DEBUG
+                        std::cerr<<"Time_end not reach, time= "<<time_<<" gt_drift_inv= "<<gt_drift_inv<<" ds(next) = "<<ds[1-ds_switch]<<"\n";
+#endif
+                    }
                     // time sychronization on case, when step size too small to reach time end, increase step size
-                    if(time_end_flag && ds[ds_switch]==ds[1-ds_switch]) {
+                    else if(time_end_flag && ds[ds_switch]==ds[1-ds_switch]) {
                         step_count_tsyn++;
 
                         Float dt_end = _time_end - time_;
@@ -2764,7 +3187,27 @@ namespace AR {
                         k = manager->step.getSortCumSumCKIndex(i);
                         if(_time_end<time_table[k]) break;
                     }
-                    if (i==0) { // first step case
+                    if (manager->time_sync_option>0) {
+                        // one-shot estimation: linear interpolation of the sorted time table t(cumsum ck*ds), starting from the time before this step
+                        ASSERT(i<cd_pair_size);
+                        Float time_prev = time_ - dt;
+                        Float cck_prev = 0.0;
+                        if (i>0) {
+                            time_prev = time_table[manager->step.getSortCumSumCKIndex(i-1)];
+                            cck_prev = manager->step.getSortCumSumCK(i-1);
+                        }
+                        Float cck = manager->step.getSortCumSumCK(i);
+                        Float dt_k = time_table[k] - time_prev;
+                        ASSERT(dt_k>0.0);
+                        ds[ds_switch] *= cck_prev + (cck-cck_prev)*std::min(Float(1.0), std::max(Float(0.0), (_time_end-time_prev)/dt_k));
+                        ds[1-ds_switch] = ds[ds_switch];
+                        ASSERT(ds[ds_switch]>0.0);
+                        ASSERT(!ISINF(ds[ds_switch]));
+#ifdef AR_DEEP_DEBUG
+                        std::cerr<<"Time_end reach, time_prev= "<<time_prev<<" time[k]= "<<time_table[k]<<" time= "<<time_<<" CumSum_CK="<<cck<<" CumSum_CK(prev)="<<cck_prev<<" ds(next) = "<<ds[ds_switch]<<" \n";
+#endif
+                    }
+                    else if (i==0) { // first step case
                         ASSERT(time_table[k]>0.0);
                         ds[ds_switch] *= manager->step.getSortCumSumCK(i)*_time_end/time_table[k];
                         ds[1-ds_switch] = ds[ds_switch];
@@ -3239,6 +3682,21 @@ namespace AR {
             bk_size += 2;
 #endif
             bk_size += particles.getBackupDataSize();
+            // low parts of the extended precision mode
+            if (manager->precision_extend_option>0) bk_size += getBackupLowDataSize();
+            return bk_size;
+        }
+
+        //! get backup data size of low parts in the extended precision mode
+        int getBackupLowDataSize() const {
+            int bk_size = 2;
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+            bk_size++;
+#endif
+#ifdef AR_TTL
+            bk_size++;
+#endif
+            bk_size += 6*particles.getSize();
             return bk_size;
         }
 
@@ -3274,6 +3732,20 @@ namespace AR {
 //#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
 //            bk_size += info.getBinaryTreeRoot().slowdown.backup(&_bk[bk_size]); // slowdownfactor
 //#endif
+            // low parts, zero if precision is not extended
+            if (manager->precision_extend_option>0) {
+                const bool flag = precision_extended_flag_;
+                _bk[bk_size++] = flag? time_lo_: Float(0.0);
+                _bk[bk_size++] = flag? etot_ref_lo_: Float(0.0);
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+                _bk[bk_size++] = flag? etot_sd_ref_lo_: Float(0.0);
+#endif
+#ifdef AR_TTL
+                _bk[bk_size++] = flag? gt_drift_inv_lo_: Float(0.0);
+#endif
+                const int n_lo = 6*particles.getSize();
+                for (int i=0; i<n_lo; i++) _bk[bk_size++] = flag? pos_vel_lo_[i]: Float(0.0);
+            }
             return bk_size;
         }
 
@@ -3308,9 +3780,106 @@ namespace AR {
 //#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
 //            bk_size += info.getBinaryTreeRoot().slowdown.restore(&_bk[bk_size]);
 //#endif
+            // low parts, ignored if precision is not extended
+            if (manager->precision_extend_option>0) {
+                if (precision_extended_flag_) {
+                    time_lo_     = _bk[bk_size++];
+                    etot_ref_lo_ = _bk[bk_size++];
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+                    etot_sd_ref_lo_ = _bk[bk_size++];
+#endif
+#ifdef AR_TTL
+                    gt_drift_inv_lo_ = _bk[bk_size++];
+#endif
+                    const int n_lo = 6*particles.getSize();
+                    for (int i=0; i<n_lo; i++) pos_vel_lo_[i] = _bk[bk_size++];
+                }
+                else bk_size += getBackupLowDataSize();
+            }
             return bk_size;
         }
 
+        //! switch to the extended precision mode
+        /*! The positions and velocities of members, time, reference energies (and the integrated inverse time transformation factor with AR_TTL) are updated with compensated summation, the rounding errors are kept in the low parts.
+          Thus the round-off error of the integrated variables is reduced to the order of the truncation error of the step for a much smaller cost than using a higher-precision Float for the whole group.
+          The low parts are initialized to zero. Notice that the particle number should not change in this mode.
+         */
+        void extendPrecision() {
+            const int n = particles.getSize();
+            if (pos_vel_lo_.getSizeMax()<6*n) {
+                pos_vel_lo_.clear();
+                pos_vel_lo_.setMode(COMM::ListMode::local);
+                pos_vel_lo_.reserveMem(6*std::max(n, particles.getSizeMax()));
+            }
+            pos_vel_lo_.resizeNoInitialize(6*n);
+            for (int i=0; i<6*n; i++) pos_vel_lo_[i] = Float(0.0);
+            time_lo_ = Float(0.0);
+            etot_ref_lo_ = Float(0.0);
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+            etot_sd_ref_lo_ = Float(0.0);
+#endif
+#ifdef AR_TTL
+            gt_drift_inv_lo_ = Float(0.0);
+#endif
+            precision_extended_flag_ = true;
+        }
+
+        //! switch back to the normal precision mode
+        /*! The low parts are added to the integrated variables. Nothing is done if the precision is not extended.
+         */
+        void reducePrecision() {
+            if (!precision_extended_flag_) return;
+            const int n = particles.getSize();
+            ASSERT(pos_vel_lo_.getSize()==6*n);
+            for (int i=0; i<n; i++) {
+                Float* pos = particles[i].getPos();
+                Float* vel = particles[i].getVel();
+                const Float* lo = &pos_vel_lo_[6*i];
+                pos[0] += lo[0];
+                pos[1] += lo[1];
+                pos[2] += lo[2];
+                vel[0] += lo[3];
+                vel[1] += lo[4];
+                vel[2] += lo[5];
+            }
+            pos_vel_lo_.resizeNoInitialize(0);
+            time_ += time_lo_;
+            time_lo_ = Float(0.0);
+            etot_ref_ += etot_ref_lo_;
+            etot_ref_lo_ = Float(0.0);
+#if (defined AR_SLOWDOWN_ARRAY) || (defined AR_SLOWDOWN_TREE)
+            etot_sd_ref_ += etot_sd_ref_lo_;
+            etot_sd_ref_lo_ = Float(0.0);
+#endif
+#ifdef AR_TTL
+            gt_drift_inv_ += gt_drift_inv_lo_;
+            gt_drift_inv_lo_ = Float(0.0);
+#endif
+            precision_extended_flag_ = false;
+        }
+
+        //! return true if the extended precision mode is used
+        bool isPrecisionExtended() const {
+            return precision_extended_flag_;
+        }
+
+        //! calculate the step size modification factor of the predictive (PI) step size controller
+        /*! The factor is \f$ (e/e_t)^{-0.7/p} (e_{prev}/e_t)^{0.4/p} \f$, where e and e_prev are the integration errors of the present and previous accepted steps in the unit of energy_error_relative_max and p is the symplectic order.
+          The target e_t is the error ratio of a step reduced by 0.8 from the one reaching the maximum error (SymplecticStep::calcErrorRatioFromStepModifyFactor). The step size follows the error trend before the maximum is reached, thus the rejected steps become rare.
+          The errors are floored to 1e-4 e_t, otherwise the round-off level errors of a single step can reduce the step size to zero.
+          @param[in] _error_ratio: integration error of the present step / energy_error_relative_max
+          @param[in] _error_ratio_prev: integration error of the previous accepted step / energy_error_relative_max, if negative, the present one is used
+          \return step size modification factor, limited in [0.5, 1.2]
+         */
+        Float calcDsControlFactor(const Float _error_ratio, const Float _error_ratio_prev) const {
+            auto& step = manager->step;
+            const Float error_target = step.calcErrorRatioFromStepModifyFactor(0.8);
+            const Float error = std::max(_error_ratio/error_target, Float(1e-4));
+            const Float error_prev = _error_ratio_prev<0.0 ? error : std::max(_error_ratio_prev/error_target, Float(1e-4));
+            Float factor = pow(step.calcStepModifyFactorFromErrorRatio(1.0/error), Float(0.7)) * pow(step.calcStepModifyFactorFromErrorRatio(error_prev), Float(0.4));
+            return std::min(std::max(factor, Float(0.5)), Float(1.2));
+        }
+
 #ifdef AR_TTL
         //! Get integrated inverse time transformation factor
         /*! In TTF case, it is calculated by integrating \f$ \frac{dg}{dt} = \sum_k \frac{\partial g}{\partial \vec{r_k}} \bullet \vec{v_k} \f$.
@@ -3522,8 +4091,9 @@ namespace AR {
 
         //! read class data with BINARY format and initial the array
         /*! @param[in] _fin: file IO for read
+          @param[in] _version: version for reading the profile, see Profile::readBinary. 0: default; 1: dumped before the profile counters after step_count_tsyn were added
          */
-        void readBinary(FILE *_fin) {
+        void readBinary(FILE *_fin, int _version=0) {
             size_t rcount = fread(&time_, sizeof(Float), 1, _fin);
             rcount += fread(&etot_ref_, sizeof(Float), 1, _fin);
             rcount += fread(&ekin_, sizeof(Float), 1, _fin);
@@ -3560,7 +4130,7 @@ namespace AR {
             particles.readBinary(_fin);
             perturber.readBinary(_fin);
             info.readBinary(_fin);
-            profile.readBinary(_fin);
+            profile.readBinary(_fin, _version);
         }
 
     };
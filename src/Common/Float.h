@@ -20,6 +20,16 @@ const Float NUMERIC_FLOAT_MAX = std::numeric_limits<double>::max();
 const int WRITE_WIDTH=38;
 const int WRITE_PRECISION=30;
 
+#elif USE_DD_FMA
+#include "Common/double_double.h"
+typedef COMM::DoubleDouble Float;
+using COMM::to_int;
+using COMM::to_double;
+const Float ROUND_OFF_ERROR_LIMIT=1e-30;
+const Float NUMERIC_FLOAT_MAX = std::numeric_limits<double>::max();
+const int WRITE_WIDTH=38;
+const int WRITE_PRECISION=30;
+
 #else
 #include <limits>
 typedef double Float;
@@ -43,7 +53,7 @@ using std::cos;
 //#endif
 #endif
 
-#if (defined USE_QD) || (defined USE_DD)
+#if (defined USE_QD) || (defined USE_DD) || (defined USE_DD_FMA)
 #define ISNAN(x) isnan(x)
 #define ISINF(x) isinf(x)
 #else
@@ -217,6 +217,24 @@ namespace COMM{
             period = semiToPeriod(semi, mtot, _G);
         }
 
+        //! calcualte masses, separation, semi, ecc, period and angular momentum
+        /*! The orientation angles, eccentric anomaly and t_peri are not updated, thus the trigonometric functions in particleToOrbit are avoided.
+           @param[in]  _p1: particle 1
+           @param[in]  _p2: particle 2
+           @param[in]  _G: gravitational constant
+        */
+        template <class Tpi, class Tpj>
+        void particleToSemiEccPeriodAm(const Tpi& _p1, const Tpj& _p2, const Float _G) {
+            Float rv;
+            m1 = _p1.mass;
+            m2 = _p2.mass;
+            particleToSemiEcc(semi, ecc, r, rv, _p1, _p2, _G);
+            Vector3<Float> pos_red(_p2.pos[0] - _p1.pos[0], _p2.pos[1] - _p1.pos[1], _p2.pos[2] - _p1.pos[2]);
+            Vector3<Float> vel_red(_p2.vel[0] - _p1.vel[0], _p2.vel[1] - _p1.vel[1], _p2.vel[2] - _p1.vel[2]);
+            am = pos_red ^ vel_red;
+            period = semiToPeriod(semi, m1+m2, _G);
+        }
+
         //! calculate eccentric anomaly from separation (0-pi)
         /*!
           @param[in] _r: seperation
@@ -257,15 +275,18 @@ namespace COMM{
             // e: eccentricity
             // u: eccentric anomaly
             // n: mean mortion
-            Float u0 = _mean_anomaly;
+            // reduce to (-pi, pi] and start from the guess of Danby (1987)
+            const Float twopi = 2.0*PI;
+            const Float mean_anomaly = _mean_anomaly - twopi*floor(_mean_anomaly/twopi + 0.5);
+            Float u0 = mean_anomaly + (sin(mean_anomaly)>=0.0 ? 0.85 : -0.85)*_ecc;
             Float u1;
             int loop = 0;
             while(1){
                 loop++;
                 Float su0 = sin(u0);
-                Float cu0 = sqrt(1.0 - su0*su0);
+                Float cu0 = cos(u0);
                 //u1 = u0 - keplereq(l, e, u0)/keplereq_dot(e, u0);
-                u1 = u0 - ((u0- _ecc*su0-_mean_anomaly)/(1.0 - _ecc*cu0));
+                u1 = u0 - ((u0- _ecc*su0-mean_anomaly)/(1.0 - _ecc*cu0));
                 //if( fabs(u1-u0) < 1e-13 ){ return u1; }
                 if( fabs(u1-u0) < 1e-15 ){ return u1; }
                 else{ u0 = u1; }
@@ -283,7 +304,8 @@ namespace COMM{
         */
         static void solveKepler(Binary& _bin,
                                 const Float _dt) {
-            Float freq = sqrt( (_bin.m1+_bin.m2) / (_bin.semi*_bin.semi*_bin.semi) );
+            // mean motion, the period includes the gravitational constant
+            Float freq = 2.0*PI/_bin.period;
             Float mean_anomaly_old = _bin.ecca - _bin.ecc * sin(_bin.ecca);
             Float dt_tmp = _dt - to_int(_dt/_bin.period)*_bin.period;
             Float mean_anomaly_new = freq * dt_tmp + mean_anomaly_old; // mean anomaly
@@ -661,13 +683,15 @@ namespace COMM{
            @param[in] _n: number of particles in _ptcl_list
            @param[in] _ptcl: particle data array
            @param[in] _G: gravtational constant
+           @param[out] _pair_order: if not NULL, save the index i in the reordered _ptcl_list of the pair (i,i+1) that forms _bins[k] to _pair_order[k] (size of n_members-1)
            \return binary tree number
         */
         static void generateBinaryTree(BinaryTreeLocal _bins[],  // make sure bins.size = n_members-1!
                                        int _ptcl_list[],   // make sure list.size = n_members!
                                        const int _n,
                                        Tptcl* _ptcl,
-                                       const Float _G) {
+                                       const Float _G,
+                                       int _pair_order[]=NULL) {
             ASSERT(_n>=2);
 
             R2Index r2_list[_n];
@@ -684,6 +708,7 @@ namespace COMM{
             for(int i=0; i<_n-1; i++) {
                 // get the pair index k in _ptcl_list with sorted r2_list, i represent the sorted r2min order.
                 int k = r2_list[i].second;
+                if (_pair_order!=NULL) _pair_order[i] = k;
                 Tptcl* p[2];
                 int pindex[2]={-1,-1};
                 // if no tree root assign, set member 1 to particle and their host to current bins i
@@ -700,7 +725,7 @@ namespace COMM{
                 else {
                     p[0] = bin_host[k];
                     int ki = k;
-                    while(bin_host[ki]==p[0]&&ki>=0) bin_host[ki--] = &_bins[i];
+                    while(ki>=0&&bin_host[ki]==p[0]) bin_host[ki--] = &_bins[i];
                 }
 
                 // if no tree root assign, set member 2 to particle and their host to current bins i
@@ -717,7 +742,7 @@ namespace COMM{
                 else {
                     p[1] = bin_host[k+1];
                     int ki = k+1;
-                    while(bin_host[ki]==p[1]&&ki<_n) bin_host[ki++] = &_bins[i];
+                    while(ki<_n&&bin_host[ki]==p[1]) bin_host[ki++] = &_bins[i];
                 }
 
                 // calculate binary parameter
@@ -773,6 +798,11 @@ namespace COMM{
             Tbinary::particleToSemiEccPeriod(*member[0], *member[1], _G);
         }
 
+        //! calculate masses, separation, semi, ecc, period and angular momentum from members
+        void calcSemiEccPeriodAm(const Float _G) {
+            Tbinary::particleToSemiEccPeriodAm(*member[0], *member[1], _G);
+        }
+
         //! calculate Kepler orbit from members
         void calcOrbit(const Float _G) {
             Tbinary::calcOrbit(*member[0], *member[1], _G);
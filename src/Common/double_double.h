@@ -0,0 +1,716 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+namespace COMM{
+
+    //! double-double floating point number
+    /*! The value is the unevaluated sum hi+lo with |lo| <= ulp(hi)/2, which gives about 31 significant decimal digits.
+      The arithmetic is built on the error-free transformations (twoSum, twoProd). twoProd uses one fused multiply-add when the target supports FMA (__FMA__, __ARM_FEATURE_FMA or FP_FAST_FMA) and the Dekker splitting otherwise.
+      All operators are inline, branch-free and work on plain doubles, thus the compiler can inline and vectorize the loops of the force kernels. The type is trivially copyable, thus arrays can be written in binary directly.
+      The algorithms follow the QD library (Hida, Li and Bailey 2000), thus the class can replace dd_real as Float (USE_DD_FMA in Common/Float.h).
+      By default the addition and division are the fast versions which are also the defaults of QD, define DD_IEEE_ADD for the IEEE-style versions that are accurate also under the cancellation of the leading parts.
+      Notice that the compiler options that break the IEEE rounding (e.g. -ffast-math, -fassociative-math) must not be used.
+     */
+    class DoubleDouble{
+    public:
+        double hi; ///> leading part
+        double lo; ///> trailing part
+
+        DoubleDouble() = default;
+        DoubleDouble(const double _hi): hi(_hi), lo(0.0) {}
+        DoubleDouble(const double _hi, const double _lo): hi(_hi), lo(_lo) {}
+
+        //! s + err = a + b exactly
+        static inline double twoSum(const double _a, const double _b, double& _err) {
+            const double s = _a + _b;
+            const double bb = s - _a;
+            _err = (_a - (s - bb)) + (_b - bb);
+            return s;
+        }
+
+        //! s + err = a + b exactly, assuming |a| >= |b|
+        static inline double quickTwoSum(const double _a, const double _b, double& _err) {
+            const double s = _a + _b;
+            _err = _b - (s - _a);
+            return s;
+        }
+
+        //! p + err = a * b exactly
+        static inline double twoProd(const double _a, const double _b, double& _err) {
+            const double p = _a * _b;
+#if defined(__FMA__) || defined(__ARM_FEATURE_FMA) || defined(FP_FAST_FMA)
+            _err = std::fma(_a, _b, -p);
+#else
+            // Dekker splitting
+            const double split = 134217729.0; // 2^27+1
+            double t = split*_a;
+            const double ahi = t - (t - _a);
+            const double alo = _a - ahi;
+            t = split*_b;
+            const double bhi = t - (t - _b);
+            const double blo = _b - bhi;
+            _err = ((ahi*bhi - p) + ahi*blo + alo*bhi) + alo*blo;
+#endif
+            return p;
+        }
+
+        //! normalized sum of two doubles
+        static inline DoubleDouble add(const double _a, const double _b) {
+            double e;
+            const double s = twoSum(_a, _b, e);
+            return DoubleDouble(s, e);
+        }
+
+        //! normalized product of two doubles
+        static inline DoubleDouble mul(const double _a, const double _b) {
+            double e;
+            const double p = twoProd(_a, _b, e);
+            return DoubleDouble(p, e);
+        }
+
+        //! square
+        static inline DoubleDouble sqr(const DoubleDouble& _a) {
+            double p2;
+            const double p1 = twoProd(_a.hi, _a.hi, p2);
+            p2 += 2.0*_a.hi*_a.lo;
+            p2 += _a.lo*_a.lo;
+            double e;
+            const double s = quickTwoSum(p1, p2, e);
+            return DoubleDouble(s, e);
+        }
+
+        DoubleDouble operator-() const {
+            return DoubleDouble(-hi, -lo);
+        }
+
+        DoubleDouble& operator+=(const DoubleDouble& _a);
+        DoubleDouble& operator-=(const DoubleDouble& _a);
+        DoubleDouble& operator*=(const DoubleDouble& _a);
+        DoubleDouble& operator/=(const DoubleDouble& _a);
+    };
+
+    // arithmetic operators
+
+    inline DoubleDouble operator+(const DoubleDouble& _a, const DoubleDouble& _b) {
+#ifdef DD_IEEE_ADD
+        // accurate also for the cancellation of the leading parts
+        double s2, t2;
+        double s1 = DoubleDouble::twoSum(_a.hi, _b.hi, s2);
+        const double t1 = DoubleDouble::twoSum(_a.lo, _b.lo, t2);
+        s2 += t1;
+        s1 = DoubleDouble::quickTwoSum(s1, s2, s2);
+        s2 += t2;
+        s1 = DoubleDouble::quickTwoSum(s1, s2, s2);
+        return DoubleDouble(s1, s2);
+#else
+        // the same as the default of QD
+        double s2;
+        double s1 = DoubleDouble::twoSum(_a.hi, _b.hi, s2);
+        s2 += (_a.lo + _b.lo);
+        s1 = DoubleDouble::quickTwoSum(s1, s2, s2);
+        return DoubleDouble(s1, s2);
+#endif
+    }
+
+    inline DoubleDouble operator+(const DoubleDouble& _a, const double _b) {
+        double s2;
+        double s1 = DoubleDouble::twoSum(_a.hi, _b, s2);
+        s2 += _a.lo;
+        s1 = DoubleDouble::quickTwoSum(s1, s2, s2);
+        return DoubleDouble(s1, s2);
+    }
+
+    inline DoubleDouble operator+(const double _a, const DoubleDouble& _b) {
+        return _b + _a;
+    }
+
+    inline DoubleDouble operator-(const DoubleDouble& _a, const DoubleDouble& _b) {
+        return _a + (-_b);
+    }
+
+    inline DoubleDouble operator-(const DoubleDouble& _a, const double _b) {
+        return _a + (-_b);
+    }
+
+    inline DoubleDouble operator-(const double _a, const DoubleDouble& _b) {
+        return (-_b) + _a;
+    }
+
+    inline DoubleDouble operator*(const DoubleDouble& _a, const DoubleDouble& _b) {
+        double p2;
+        double p1 = DoubleDouble::twoProd(_a.hi, _b.hi, p2);
+        p2 += (_a.hi*_b.lo + _a.lo*_b.hi);
+        p1 = DoubleDouble::quickTwoSum(p1, p2, p2);
+        return DoubleDouble(p1, p2);
+    }
+
+    inline DoubleDouble operator*(const DoubleDouble& _a, const double _b) {
+        double p2;
+        double p1 = DoubleDouble::twoProd(_a.hi, _b, p2);
+        p2 += _a.lo*_b;
+        p1 = DoubleDouble::quickTwoSum(p1, p2, p2);
+        return DoubleDouble(p1, p2);
+    }
+
+    inline DoubleDouble operator*(const double _a, const DoubleDouble& _b) {
+        return _b * _a;
+    }
+
+    inline DoubleDouble operator/(const DoubleDouble& _a, const DoubleDouble& _b) {
+#ifdef DD_IEEE_ADD
+        // three quotient digits by long division, the error of the approximate digits is removed by the residuals, thus one reciprocal is enough
+        const double binv = 1.0 / _b.hi;
+        const double q1 = _a.hi * binv;
+        DoubleDouble r = _a - q1*_b;
+        const double q2 = r.hi * binv;
+        r = r - q2*_b;
+        const double q3 = r.hi * binv;
+        double e;
+        const double s = DoubleDouble::quickTwoSum(q1, q2, e);
+        return DoubleDouble(s, e) + q3;
+#else
+        // two quotient digits, the same as the default of QD
+        const double q1 = _a.hi / _b.hi;
+        const DoubleDouble r = q1*_b;
+        double s2;
+        const double s1 = DoubleDouble::twoSum(_a.hi, -r.hi, s2);
+        s2 -= r.lo;
+        s2 += _a.lo;
+        const double q2 = (s1 + s2) / _b.hi;
+        double e;
+        const double q = DoubleDouble::quickTwoSum(q1, q2, e);
+        return DoubleDouble(q, e);
+#endif
+    }
+
+    inline DoubleDouble operator/(const DoubleDouble& _a, const double _b) {
+        const double q1 = _a.hi / _b;
+        double p2, e;
+        const double p1 = DoubleDouble::twoProd(q1, _b, p2);
+        const double s = DoubleDouble::twoSum(_a.hi, -p1, e);
+        e -= p2;
+        e += _a.lo;
+        const double q2 = (s + e) / _b;
+        double q;
+        const double qhi = DoubleDouble::quickTwoSum(q1, q2, q);
+        return DoubleDouble(qhi, q);
+    }
+
+    inline DoubleDouble operator/(const double _a, const DoubleDouble& _b) {
+        return DoubleDouble(_a) / _b;
+    }
+
+    inline DoubleDouble& DoubleDouble::operator+=(const DoubleDouble& _a) {
+        return *this = *this + _a;
+    }
+
+    inline DoubleDouble& DoubleDouble::operator-=(const DoubleDouble& _a) {
+        return *this = *this - _a;
+    }
+
+    inline DoubleDouble& DoubleDouble::operator*=(const DoubleDouble& _a) {
+        return *this = *this * _a;
+    }
+
+    inline DoubleDouble& DoubleDouble::operator/=(const DoubleDouble& _a) {
+        return *this = *this / _a;
+    }
+
+    // comparison operators
+
+    inline bool operator==(const DoubleDouble& _a, const DoubleDouble& _b) {
+        return _a.hi==_b.hi && _a.lo==_b.lo;
+    }
+
+    inline bool operator!=(const DoubleDouble& _a, const DoubleDouble& _b) {
+        return _a.hi!=_b.hi || _a.lo!=_b.lo;
+    }
+
+    inline bool operator<(const DoubleDouble& _a, const DoubleDouble& _b) {
+        return _a.hi<_b.hi || (_a.hi==_b.hi && _a.lo<_b.lo);
+    }
+
+    inline bool operator>(const DoubleDouble& _a, const DoubleDouble& _b) {
+        return _a.hi>_b.hi || (_a.hi==_b.hi && _a.lo>_b.lo);
+    }
+
+    inline bool operator<=(const DoubleDouble& _a, const DoubleDouble& _b) {
+        return _a.hi<_b.hi || (_a.hi==_b.hi && _a.lo<=_b.lo);
+    }
+
+    inline bool operator>=(const DoubleDouble& _a, const DoubleDouble& _b) {
+        return _a.hi>_b.hi || (_a.hi==_b.hi && _a.lo>=_b.lo);
+    }
+
+    inline bool operator==(const DoubleDouble& _a, const double _b) { return _a==DoubleDouble(_b); }
+    inline bool operator!=(const DoubleDouble& _a, const double _b) { return _a!=DoubleDouble(_b); }
+    inline bool operator< (const DoubleDouble& _a, const double _b) { return _a< DoubleDouble(_b); }
+    inline bool operator> (const DoubleDouble& _a, const double _b) { return _a> DoubleDouble(_b); }
+    inline bool operator<=(const DoubleDouble& _a, const double _b) { return _a<=DoubleDouble(_b); }
+    inline bool operator>=(const DoubleDouble& _a, const double _b) { return _a>=DoubleDouble(_b); }
+    inline bool operator==(const double _a, const DoubleDouble& _b) { return DoubleDouble(_a)==_b; }
+    inline bool operator!=(const double _a, const DoubleDouble& _b) { return DoubleDouble(_a)!=_b; }
+    inline bool operator< (const double _a, const DoubleDouble& _b) { return DoubleDouble(_a)< _b; }
+    inline bool operator> (const double _a, const DoubleDouble& _b) { return DoubleDouble(_a)> _b; }
+    inline bool operator<=(const double _a, const DoubleDouble& _b) { return DoubleDouble(_a)<=_b; }
+    inline bool operator>=(const double _a, const DoubleDouble& _b) { return DoubleDouble(_a)>=_b; }
+
+    // the functions below hide the ones of double in namespace COMM, thus bring them back
+    using std::abs;
+    using std::fabs;
+    using std::ldexp;
+    using std::floor;
+    using std::ceil;
+    using std::fmod;
+    using std::sqrt;
+    using std::pow;
+    using std::exp;
+    using std::log;
+    using std::sin;
+    using std::cos;
+    using std::atan2;
+    using std::atan;
+    using std::acos;
+    using std::asin;
+    using std::sinh;
+    using std::cosh;
+    using std::tanh;
+    using std::asinh;
+    using std::acosh;
+    using std::atanh;
+    using std::isnan;
+    using std::isinf;
+
+    // conversion and basic functions
+
+    inline double to_double(const DoubleDouble& _a) {
+        return _a.hi;
+    }
+
+    inline double to_double(const double _a) {
+        return _a;
+    }
+
+    inline int to_int(const DoubleDouble& _a) {
+        return static_cast<int>(_a.hi);
+    }
+
+    inline int to_int(const double _a) {
+        return static_cast<int>(_a);
+    }
+
+    inline bool isnan(const DoubleDouble& _a) {
+        return std::isnan(_a.hi) || std::isnan(_a.lo);
+    }
+
+    inline bool isinf(const DoubleDouble& _a) {
+        return std::isinf(_a.hi);
+    }
+
+    inline DoubleDouble abs(const DoubleDouble& _a) {
+        return _a.hi<0.0 ? -_a : _a;
+    }
+
+    inline DoubleDouble fabs(const DoubleDouble& _a) {
+        return abs(_a);
+    }
+
+    inline DoubleDouble ldexp(const DoubleDouble& _a, const int _exp) {
+        return DoubleDouble(std::ldexp(_a.hi, _exp), std::ldexp(_a.lo, _exp));
+    }
+
+    inline DoubleDouble floor(const DoubleDouble& _a) {
+        double hi = std::floor(_a.hi);
+        double lo = 0.0;
+        if (hi==_a.hi) {
+            // hi is an integer, floor the trailing part
+            lo = std::floor(_a.lo);
+            hi = DoubleDouble::quickTwoSum(hi, lo, lo);
+        }
+        return DoubleDouble(hi, lo);
+    }
+
+    inline DoubleDouble ceil(const DoubleDouble& _a) {
+        return -floor(-_a);
+    }
+
+    //! round to nearest integer
+    inline DoubleDouble nint(const DoubleDouble& _a) {
+        return floor(_a + 0.5);
+    }
+
+    inline DoubleDouble fmod(const DoubleDouble& _a, const DoubleDouble& _b) {
+        const DoubleDouble q = _a / _b;
+        const DoubleDouble n = q.hi<0.0 ? ceil(q) : floor(q);
+        return _a - n*_b;
+    }
+
+    inline DoubleDouble sqrt(const DoubleDouble& _a) {
+        if (_a.hi==0.0) return DoubleDouble(0.0);
+        if (_a.hi<0.0) return DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+        // one Newton step from the double result (Karp's trick)
+        const double x = 1.0/std::sqrt(_a.hi);
+        const double ax = _a.hi*x;
+        const double corr = (_a - DoubleDouble::mul(ax, ax)).hi * (x*0.5);
+        return DoubleDouble::add(ax, corr);
+    }
+
+    //! integer power by binary exponentiation
+    inline DoubleDouble pow(const DoubleDouble& _a, const int _n) {
+        if (_n==0) return DoubleDouble(1.0);
+        int n = _n<0 ? -_n : _n;
+        DoubleDouble r = _a;
+        DoubleDouble s(1.0);
+        while (n>0) {
+            if (n&1) s *= r;
+            n >>= 1;
+            if (n>0) r = DoubleDouble::sqr(r);
+        }
+        return _n<0 ? DoubleDouble(1.0)/s : s;
+    }
+
+    //! constants of double-double
+    struct DoubleDoubleConst{
+        static DoubleDouble ln2()   { return DoubleDouble(6.931471805599452862e-01, 2.319046813846299558e-17); }
+        static DoubleDouble pi()    { return DoubleDouble(3.141592653589793116e+00, 1.224646799147353207e-16); }
+        static DoubleDouble twopi() { return DoubleDouble(6.283185307179586232e+00, 2.449293598294706414e-16); }
+        static DoubleDouble pi2()   { return DoubleDouble(1.570796326794896558e+00, 6.123233995736766036e-17); }
+        static DoubleDouble pi4()   { return DoubleDouble(7.853981633974482790e-01, 3.061616997868383018e-17); }
+        static DoubleDouble pi34()  { return DoubleDouble(2.356194490192344837e+00, 9.1848509936051484375e-17); }
+        static double eps() { return 4.93038065763132e-32; } // 2^-104
+    };
+
+    inline DoubleDouble exp(const DoubleDouble& _a) {
+        if (_a.hi>709.0) return DoubleDouble(std::numeric_limits<double>::infinity());
+        if (_a.hi<-745.0) return DoubleDouble(0.0);
+        if (_a.hi==0.0) return DoubleDouble(1.0);
+        // a = m ln2 + 1024 r
+        const double m = std::floor(_a.hi/DoubleDoubleConst::ln2().hi + 0.5);
+        const DoubleDouble r = ldexp(_a - DoubleDoubleConst::ln2()*m, -10);
+        // expm1(r) by Taylor series
+        DoubleDouble s = r;
+        DoubleDouble t = r;
+        for (int k=2; k<20; k++) {
+            t = t*r/double(k);
+            s += t;
+            if (std::abs(t.hi) <= DoubleDoubleConst::eps()*std::abs(s.hi)) break;
+        }
+        // expm1(2x) = 2 expm1(x) + expm1(x)^2
+        for (int k=0; k<10; k++) s = ldexp(s, 1) + DoubleDouble::sqr(s);
+        s += 1.0;
+        return ldexp(s, int(m));
+    }
+
+    inline DoubleDouble log(const DoubleDouble& _a) {
+        if (_a.hi<0.0) return DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+        if (_a.hi==0.0) return DoubleDouble(-std::numeric_limits<double>::infinity());
+        if (_a.hi==1.0 && _a.lo==0.0) return DoubleDouble(0.0);
+        // one Newton step x = x + a exp(-x) - 1
+        DoubleDouble x(std::log(_a.hi));
+        x = x + _a*exp(-x) - 1.0;
+        return x;
+    }
+
+    inline DoubleDouble pow(const DoubleDouble& _a, const DoubleDouble& _b) {
+        if (_b.lo==0.0 && _b.hi==std::floor(_b.hi) && std::abs(_b.hi)<=1024.0) return pow(_a, int(_b.hi));
+        return exp(_b*log(_a));
+    }
+
+    inline DoubleDouble pow(const DoubleDouble& _a, const double _b) {
+        return pow(_a, DoubleDouble(_b));
+    }
+
+    //! sin and cos for |a| <= pi/4 by Taylor series
+    inline void sinCosTaylor(const DoubleDouble& _a, DoubleDouble& _sin, DoubleDouble& _cos) {
+        if (_a.hi==0.0) {
+            _sin = DoubleDouble(0.0);
+            _cos = DoubleDouble(1.0);
+            return;
+        }
+        const DoubleDouble x2 = -DoubleDouble::sqr(_a);
+        DoubleDouble s = _a;
+        DoubleDouble t = _a;
+        for (int k=1; k<20; k++) {
+            t = t*x2/double((2*k)*(2*k+1));
+            s += t;
+            if (std::abs(t.hi) <= DoubleDoubleConst::eps()*std::abs(s.hi)) break;
+        }
+        _sin = s;
+        _cos = sqrt(1.0 - DoubleDouble::sqr(s));
+    }
+
+    //! sin and cos with argument reduction
+    inline void sinCos(const DoubleDouble& _a, DoubleDouble& _sin, DoubleDouble& _cos) {
+        // a = 2pi z + pi/2 j + t, |t| <= pi/4
+        const DoubleDouble z = nint(_a/DoubleDoubleConst::twopi());
+        const DoubleDouble r = _a - DoubleDoubleConst::twopi()*z;
+        const double j = std::floor(r.hi/DoubleDoubleConst::pi2().hi + 0.5);
+        const DoubleDouble t = r - DoubleDoubleConst::pi2()*j;
+        DoubleDouble st, ct;
+        sinCosTaylor(t, st, ct);
+        switch (int(j)) {
+        case 0:
+            _sin = st;
+            _cos = ct;
+            break;
+        case 1:
+            _sin = ct;
+            _cos = -st;
+            break;
+        case -1:
+            _sin = -ct;
+            _cos = st;
+            break;
+        default:
+            _sin = -st;
+            _cos = -ct;
+            break;
+        }
+    }
+
+    inline DoubleDouble sin(const DoubleDouble& _a) {
+        DoubleDouble s, c;
+        sinCos(_a, s, c);
+        return s;
+    }
+
+    inline DoubleDouble cos(const DoubleDouble& _a) {
+        DoubleDouble s, c;
+        sinCos(_a, s, c);
+        return c;
+    }
+
+    inline DoubleDouble atan2(const DoubleDouble& _y, const DoubleDouble& _x) {
+        if (_x.hi==0.0) {
+            if (_y.hi==0.0) return DoubleDouble(0.0);
+            return _y.hi>0.0 ? DoubleDoubleConst::pi2() : -DoubleDoubleConst::pi2();
+        }
+        if (_y.hi==0.0) return _x.hi>0.0 ? DoubleDouble(0.0) : DoubleDoubleConst::pi();
+        if (_x==_y) return _y.hi>0.0 ? DoubleDoubleConst::pi4() : -DoubleDoubleConst::pi34();
+        if (_x==-_y) return _y.hi>0.0 ? DoubleDoubleConst::pi34() : -DoubleDoubleConst::pi4();
+        // one Newton step from the double result
+        const DoubleDouble r = sqrt(DoubleDouble::sqr(_x) + DoubleDouble::sqr(_y));
+        const DoubleDouble xx = _x/r;
+        const DoubleDouble yy = _y/r;
+        DoubleDouble z(std::atan2(_y.hi, _x.hi));
+        DoubleDouble sz, cz;
+        sinCos(z, sz, cz);
+        if (std::abs(xx.hi)>std::abs(yy.hi)) z += (yy - sz)/cz;
+        else z -= (xx - cz)/sz;
+        return z;
+    }
+
+    inline DoubleDouble atan(const DoubleDouble& _a) {
+        return atan2(_a, DoubleDouble(1.0));
+    }
+
+    inline DoubleDouble acos(const DoubleDouble& _a) {
+        if (abs(_a)>1.0) return DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+        return atan2(sqrt(1.0 - DoubleDouble::sqr(_a)), _a);
+    }
+
+    inline DoubleDouble asin(const DoubleDouble& _a) {
+        if (abs(_a)>1.0) return DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+        return atan2(_a, sqrt(1.0 - DoubleDouble::sqr(_a)));
+    }
+
+    inline DoubleDouble sinh(const DoubleDouble& _a) {
+        if (std::abs(_a.hi)<0.05) {
+            // Taylor series to avoid the cancellation
+            const DoubleDouble x2 = DoubleDouble::sqr(_a);
+            DoubleDouble s = _a;
+            DoubleDouble t = _a;
+            for (int k=1; k<20; k++) {
+                t = t*x2/double((2*k)*(2*k+1));
+                s += t;
+                if (std::abs(t.hi) <= DoubleDoubleConst::eps()*std::abs(s.hi)) break;
+            }
+            return s;
+        }
+        const DoubleDouble e = exp(_a);
+        return (e - 1.0/e)*0.5;
+    }
+
+    inline DoubleDouble cosh(const DoubleDouble& _a) {
+        const DoubleDouble e = exp(_a);
+        return (e + 1.0/e)*0.5;
+    }
+
+    inline DoubleDouble tanh(const DoubleDouble& _a) {
+        if (_a.hi==0.0) return DoubleDouble(0.0);
+        return sinh(_a)/cosh(_a);
+    }
+
+    inline DoubleDouble asinh(const DoubleDouble& _a) {
+        const DoubleDouble s = log(abs(_a) + sqrt(DoubleDouble::sqr(_a) + 1.0));
+        return _a.hi<0.0 ? -s : s;
+    }
+
+    inline DoubleDouble acosh(const DoubleDouble& _a) {
+        if (_a.hi<1.0) return DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+        return log(_a + sqrt(DoubleDouble::sqr(_a) - 1.0));
+    }
+
+    inline DoubleDouble atanh(const DoubleDouble& _a) {
+        if (abs(_a)>=1.0) return DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+        return 0.5*log((1.0 + _a)/(1.0 - _a));
+    }
+
+    // input and output
+
+    //! decimal digits of |a|
+    /*! @param[out] _digits: decimal digits (0-9), size should be >= _n_digit
+      @param[out] _expn: decimal exponent of the first digit
+      @param[in] _a: value (finite and non-zero)
+      @param[in] _n_digit: number of digits, the last one is rounded
+     */
+    inline void toDigits(int* _digits, int& _expn, const DoubleDouble& _a, const int _n_digit) {
+        DoubleDouble r = abs(_a);
+        int e = int(std::floor(std::log10(r.hi)));
+        if (e<-300) {
+            r *= pow(DoubleDouble(10.0), 300);
+            r /= pow(DoubleDouble(10.0), e+300);
+        }
+        else if (e>0) r /= pow(DoubleDouble(10.0), e);
+        else if (e<0) r *= pow(DoubleDouble(10.0), -e);
+        // fix the exponent if log10 is off by one
+        if (r>=10.0) {
+            r /= 10.0;
+            e++;
+        }
+        else if (r<1.0) {
+            r *= 10.0;
+            e--;
+        }
+        // one extra digit for rounding
+        const int n = std::min(_n_digit+1, 33);
+        int d[33];
+        for (int i=0; i<n; i++) {
+            const int di = int(r.hi);
+            r -= double(di);
+            r *= 10.0;
+            d[i] = di;
+        }
+        // fix the digits out of range
+        for (int i=n-1; i>0; i--) {
+            if (d[i]<0) {
+                d[i-1]--;
+                d[i] += 10;
+            }
+            else if (d[i]>9) {
+                d[i-1]++;
+                d[i] -= 10;
+            }
+        }
+        // round
+        if (d[n-1]>=5) {
+            d[n-2]++;
+            for (int i=n-2; i>0 && d[i]>9; i--) {
+                d[i] -= 10;
+                d[i-1]++;
+            }
+        }
+        if (d[0]>9) {
+            e++;
+            d[0] = 1;
+            for (int i=1; i<n; i++) d[i] = 0;
+        }
+        for (int i=0; i<_n_digit; i++) _digits[i] = d[i];
+        _expn = e;
+    }
+
+    //! convert to string in scientific format
+    /*! @param[in] _a: value
+      @param[in] _precision: number of digits after the decimal point (<=31)
+     */
+    inline std::string toString(const DoubleDouble& _a, const int _precision) {
+        if (std::isnan(_a.hi)) return "nan";
+        if (std::isinf(_a.hi)) return _a.hi>0.0 ? "inf" : "-inf";
+        const int prec = std::max(0, std::min(_precision, 31));
+        std::string s;
+        if (_a.hi<0.0) s += '-';
+        int d[32] = {0};
+        int e = 0;
+        if (_a.hi!=0.0) toDigits(d, e, _a, prec+1);
+        s += char('0'+d[0]);
+        if (prec>0) s += '.';
+        for (int i=1; i<=prec; i++) s += char('0'+d[i]);
+        s += 'e';
+        s += e<0 ? '-' : '+';
+        const int ea = e<0 ? -e : e;
+        if (ea<10) s += '0';
+        s += std::to_string(ea);
+        return s;
+    }
+
+    //! convert from string
+    /*! @param[out] _a: value
+      @param[in] _s: decimal string like -1.234e-5
+      \return true: success
+     */
+    inline bool fromString(DoubleDouble& _a, const std::string& _s) {
+        if (_s=="nan") {
+            _a = DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+            return true;
+        }
+        if (_s=="inf" || _s=="-inf") {
+            _a = DoubleDouble(_s[0]=='-' ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity());
+            return true;
+        }
+        std::size_t i = 0;
+        bool neg = false;
+        if (i<_s.size() && (_s[i]=='-' || _s[i]=='+')) neg = _s[i++]=='-';
+        DoubleDouble r(0.0);
+        int n_frac = 0;
+        int n_digit = 0;
+        bool point = false;
+        for (; i<_s.size(); i++) {
+            const char c = _s[i];
+            if (c>='0' && c<='9') {
+                r = r*10.0 + double(c-'0');
+                if (point) n_frac++;
+                n_digit++;
+            }
+            else if (c=='.' && !point) point = true;
+            else break;
+        }
+        if (n_digit==0) return false;
+        int e = 0;
+        if (i<_s.size() && (_s[i]=='e' || _s[i]=='E')) {
+            i++;
+            std::size_t pos = 0;
+            try {
+                e = std::stoi(_s.substr(i), &pos);
+            }
+            catch (...) {
+                return false;
+            }
+            i += pos;
+        }
+        if (i!=_s.size()) return false;
+        e -= n_frac;
+        if (e>0) r *= pow(DoubleDouble(10.0), e);
+        else if (e<0) r /= pow(DoubleDouble(10.0), -e);
+        _a = neg ? -r : r;
+        return true;
+    }
+
+    inline std::ostream& operator<<(std::ostream& _os, const DoubleDouble& _a) {
+        const int prec = _os.precision();
+        _os<<toString(_a, prec);
+        return _os;
+    }
+
+    inline std::istream& operator>>(std::istream& _is, DoubleDouble& _a) {
+        std::string s;
+        if (!(_is>>s)) return _is;
+        if (!fromString(_a, s)) _is.setstate(std::ios::failbit);
+        return _is;
+    }
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include "Common/Float.h"
+
+namespace COMM{
+
+    //! Kepler propagator with universal variables
+    /*! The relative position and velocity of a two-body orbit are evolved by the f and g functions of the universal anomaly chi, which covers elliptic, parabolic and hyperbolic orbits in one formula with the Stumpff functions c2 and c3.
+      The universal Kepler equation F(chi)=0 is monotonic (dF/dchi = r >= pericenter distance q), thus the root is bracketed by 0 and sqrt(mu)*dt/q initially; for elliptic orbits the time is first reduced to within half a period (the mean anomaly changes by at most pi), thus the eccentric anomaly changes by less than 2pi and |chi| < 2pi/sqrt(alpha).
+      It is solved by the Laguerre-Conway iteration from the standard starting guesses, safeguarded by the bisection of the bracket when a step leaves the bracket or does not halve the step before the last one.
+      When no upper bound is available (radial orbits), the bracket grows geometrically up to the overflow limit of the Stumpff functions.
+      F is not evaluated where the Stumpff functions overflow (or give NaN), since F is finite at the root such points are only used as bounds with the sign of chi.
+      The iteration typically takes 5-15 steps. If it does not converge in #n_iter_max steps, the orbit is not changed and a failure is returned.
+      propagateBatch evolves arrays of orbits in tiles, each iteration is done for all orbits of a tile in one loop, thus the independent evaluations of the Stumpff functions are interleaved and the number of loop passes is set by the slowest orbit of the tile.
+     */
+    class KeplerUniversal{
+    public:
+        static const int n_iter_max = 128; ///> maximum number of iterations
+        static const int n_tile = 64; ///> number of orbits in one tile of propagateBatch
+        static constexpr double psi_overflow = 490000.0; ///> maximum -psi (=(700)^2) for hyperbolic Stumpff functions to avoid the overflow of cosh and sinh
+
+        //! Stumpff functions c2 and c3
+        /*! The series expansion is used for |psi|<0.1 to avoid the cancellation.
+          @param[in] _psi: alpha*chi^2
+          @param[out] _c2: (1-cos(sqrt(psi)))/psi
+          @param[out] _c3: (sqrt(psi)-sin(sqrt(psi)))/psi^1.5
+         */
+        static inline void calcStumpff(const Float _psi, Float& _c2, Float& _c3) {
+            if (_psi>0.1) {
+                const Float s = sqrt(_psi);
+                _c2 = (1.0 - cos(s))/_psi;
+                _c3 = (s - sin(s))/(_psi*s);
+            }
+            else if (_psi<-0.1) {
+                const Float s = sqrt(-_psi);
+                _c2 = (1.0 - cosh(s))/_psi;
+                _c3 = (sinh(s) - s)/(-_psi*s);
+            }
+            else {
+                // c2 = sum (-psi)^k/(2k+2)!, c3 = sum (-psi)^k/(2k+3)!
+                _c2 = 1.0/2.0 - _psi*(1.0/24.0 - _psi*(1.0/720.0 - _psi*(1.0/40320.0 - _psi*(1.0/3628800.0 - _psi*(1.0/479001600.0)))));
+                _c3 = 1.0/6.0 - _psi*(1.0/120.0 - _psi*(1.0/5040.0 - _psi*(1.0/362880.0 - _psi*(1.0/39916800.0 - _psi*(1.0/6227020800.0)))));
+            }
+        }
+
+        //! parameters of one orbit for the iteration
+        struct Orbit{
+            Float r0;     // initial distance
+            Float sigma;  // r0.v0/sqrt(mu)
+            Float alpha;  // 1/semi = 2/r0 - v0^2/mu
+            Float beta;   // 1 - alpha*r0
+            Float sqrt_mu;// sqrt(G*m_tot)
+            Float dt;     // time to evolve (reduced for elliptic orbits)
+            Float chi;    // universal anomaly
+            Float lo;     // lower bound of chi
+            Float hi;     // upper bound of chi
+            Float chi_max;// maximum |chi| for the geometric growth of a one-sided bracket
+            Float dchi;   // last step
+            Float dchi_old; // step before the last one
+            bool lo_flag; // lower bound is found
+            bool hi_flag; // upper bound is found
+            bool converged; // iteration converged
+        };
+
+        //! initialize one orbit, the bracket and the starting guess
+        /*! @param[out] _orb: orbit parameters
+          @param[in] _gm: G*(m1+m2)
+          @param[in] _pos: relative position
+          @param[in] _vel: relative velocity
+          @param[in] _dt: time to evolve
+         */
+        static inline void initial(Orbit& _orb, const Float _gm, const Float* _pos, const Float* _vel, const Float _dt) {
+            const Float r0 = sqrt(_pos[0]*_pos[0] + _pos[1]*_pos[1] + _pos[2]*_pos[2]);
+            const Float v2 = _vel[0]*_vel[0] + _vel[1]*_vel[1] + _vel[2]*_vel[2];
+            const Float rv = _pos[0]*_vel[0] + _pos[1]*_vel[1] + _pos[2]*_vel[2];
+            _orb.sqrt_mu = sqrt(_gm);
+            _orb.r0 = r0;
+            _orb.sigma = rv/_orb.sqrt_mu;
+            _orb.alpha = 2.0/r0 - v2/_gm;
+            _orb.beta = 1.0 - _orb.alpha*r0;
+            Float dt = _dt;
+            // bound of |chi| at the root: sqrt(mu)*|dt|/q from dF/dchi = r >= q, q = h^2/(mu(1+ecc))
+            const Float h2 = std::max(r0*r0*v2 - rv*rv, Float(0.0));
+            const Float ecc = sqrt(std::max(Float(1.0 - _orb.alpha*h2/_gm), Float(0.0)));
+            const Float q = h2/(_gm*(1.0 + ecc));
+            _orb.chi_max = NUMERIC_FLOAT_MAX;
+            const Float alpha_eps = 1e-12/r0;
+            if (_orb.alpha>alpha_eps) {
+                // elliptic: reduce to [-period/2, period/2], where |chi| < 2pi/sqrt(alpha)
+                const Float pi = 4.0*atan(Float(1.0));
+                const Float period = 2.0*pi/(_orb.sqrt_mu*_orb.alpha*sqrt(_orb.alpha));
+                dt -= period*floor(dt/period + 0.5);
+                _orb.chi = _orb.sqrt_mu*_orb.alpha*dt;
+                _orb.chi_max = 2.02*pi/sqrt(_orb.alpha);
+            }
+            else if (_orb.alpha<-alpha_eps) {
+                // hyperbolic
+                const Float a = 1.0/_orb.alpha;
+                const Float sign = dt>=0.0 ? 1.0 : -1.0;
+                const Float arg = -2.0*_gm*_orb.alpha*dt/(rv + sign*sqrt(-_gm*a)*_orb.beta);
+                _orb.chi = arg>0.0 ? sign*sqrt(-a)*log(arg) : _orb.sqrt_mu*dt/r0;
+                _orb.chi_max = sqrt(psi_overflow/(-_orb.alpha));
+            }
+            else {
+                // parabolic
+                _orb.chi = _orb.sqrt_mu*dt/r0;
+            }
+            _orb.dt = dt;
+            // F(0) = -sqrt(mu) dt
+            Float chi_bound = q>0.0 ? 1.01*_orb.sqrt_mu*abs(dt)/q : NUMERIC_FLOAT_MAX;
+            // for elliptic orbits, 2pi/sqrt(alpha) is always a bound
+            if (_orb.alpha>alpha_eps) chi_bound = std::min(chi_bound, _orb.chi_max);
+            const bool bound_flag = chi_bound<NUMERIC_FLOAT_MAX;
+            if (dt>=0.0) {
+                _orb.lo = 0.0;
+                _orb.hi = chi_bound;
+                _orb.lo_flag = true;
+                _orb.hi_flag = bound_flag;
+            }
+            else {
+                _orb.lo = -chi_bound;
+                _orb.hi = 0.0;
+                _orb.lo_flag = bound_flag;
+                _orb.hi_flag = true;
+            }
+            // the starting guess should be inside the bracket
+            if ((_orb.lo_flag && !(_orb.chi>_orb.lo)) || (_orb.hi_flag && !(_orb.chi<_orb.hi))) 
+                _orb.chi = (_orb.lo_flag && _orb.hi_flag) ? 0.5*(_orb.lo + _orb.hi) : _orb.sqrt_mu*dt/r0;
+            _orb.dchi = _orb.dchi_old = NUMERIC_FLOAT_MAX;
+            _orb.converged = dt==0.0;
+            if (_orb.converged) _orb.chi = 0.0;
+        }
+
+        //! calculate F(chi) and derivatives
+        static inline void calcF(const Orbit& _orb, const Float _chi, Float& _f, Float& _df, Float& _d2f) {
+            const Float chi2 = _chi*_chi;
+            const Float psi = _orb.alpha*chi2;
+            Float c2, c3;
+            calcStumpff(psi, c2, c3);
+            _f = _orb.sigma*chi2*c2 + _orb.beta*chi2*_chi*c3 + _orb.r0*_chi - _orb.sqrt_mu*_orb.dt;
+            _df = _orb.sigma*_chi*(1.0 - psi*c3) + _orb.beta*chi2*c2 + _orb.r0;
+            _d2f = _orb.sigma*(1.0 - psi*c2) + _orb.beta*_chi*(1.0 - psi*c3);
+        }
+
+        //! one safeguarded Laguerre-Conway iteration
+        /*! Nothing is done if the orbit is converged
+         */
+        static inline void iterate(Orbit& _orb) {
+            if (_orb.converged) return;
+            const Float chi = _orb.chi;
+            Float f=0.0, df=0.0, d2f=0.0;
+            // F is finite at the root, an overflow only happens far away from it with the sign of chi
+            bool finite_flag = _orb.alpha*chi*chi > -psi_overflow;
+            if (finite_flag) {
+                calcF(_orb, chi, f, df, d2f);
+                finite_flag = abs(f)<NUMERIC_FLOAT_MAX && abs(df)<NUMERIC_FLOAT_MAX && abs(d2f)<NUMERIC_FLOAT_MAX;
+                if (f==0.0) {
+                    _orb.converged = true;
+                    return;
+                }
+            }
+            // update bracket, F is monotonically increasing
+            const bool f_pos = finite_flag ? f>0.0 : chi>0.0;
+            if (f_pos) {
+                _orb.hi = chi;
+                _orb.hi_flag = true;
+            }
+            else {
+                _orb.lo = chi;
+                _orb.lo_flag = true;
+            }
+            const bool bracket_flag = _orb.lo_flag && _orb.hi_flag;
+
+            // Laguerre-Conway step with n=5
+            Float chi_new = chi;
+            bool step_flag = false;
+            if (finite_flag) {
+                const Float n = 5.0;
+                const Float disc = sqrt(abs((n-1.0)*(n-1.0)*df*df - n*(n-1.0)*f*d2f));
+                chi_new = chi - n*f/(df + (df>=0.0 ? disc : -disc));
+                // the step should be inside the bracket and, once bracketed, should halve the step before the last one
+                step_flag = (!_orb.lo_flag || chi_new>_orb.lo) && (!_orb.hi_flag || chi_new<_orb.hi)
+                    && (!bracket_flag || abs(chi_new-chi) <= 0.5*abs(_orb.dchi_old));
+            }
+            if (!step_flag) {
+                // bisection, or grow a one-sided bracket geometrically up to chi_max
+                if (bracket_flag) chi_new = 0.5*(_orb.lo + _orb.hi);
+                else if (_orb.lo_flag) chi_new = std::min(_orb.lo + std::max(abs(_orb.lo), _orb.sqrt_mu*abs(_orb.dt)/_orb.r0), _orb.chi_max);
+                else chi_new = std::max(_orb.hi - std::max(abs(_orb.hi), _orb.sqrt_mu*abs(_orb.dt)/_orb.r0), -_orb.chi_max);
+            }
+            _orb.dchi_old = _orb.dchi;
+            _orb.dchi = chi_new - chi;
+            _orb.chi = chi_new;
+            // a one-sided bracket growth is never converged
+            if (!step_flag && !bracket_flag) return;
+            const Float tol = 0.1*ROUND_OFF_ERROR_LIMIT*abs(chi_new);
+            _orb.converged = abs(_orb.dchi) <= tol || (bracket_flag && _orb.hi - _orb.lo <= tol);
+        }
+
+        //! evolve position and velocity by f and g functions after the iteration
+        static inline void update(const Orbit& _orb, Float* _pos, Float* _vel) {
+            const Float chi = _orb.chi;
+            const Float chi2 = chi*chi;
+            const Float psi = _orb.alpha*chi2;
+            Float c2, c3;
+            calcStumpff(psi, c2, c3);
+            const Float r = _orb.sigma*chi*(1.0 - psi*c3) + _orb.beta*chi2*c2 + _orb.r0;
+            const Float f = 1.0 - chi2*c2/_orb.r0;
+            const Float g = _orb.dt - chi2*chi*c3/_orb.sqrt_mu;
+            const Float fdot = _orb.sqrt_mu/(r*_orb.r0)*chi*(psi*c3 - 1.0);
+            const Float gdot = 1.0 - chi2*c2/r;
+            for (int k=0; k<3; k++) {
+                const Float x = _pos[k];
+                const Float v = _vel[k];
+                _pos[k] = f*x + g*v;
+                _vel[k] = fdot*x + gdot*v;
+            }
+        }
+
+        //! evolve one two-body orbit
+        /*! @param[in] _gm: G*(m1+m2)
+          @param[in,out] _pos: relative position
+          @param[in,out] _vel: relative velocity
+          @param[in] _dt: time to evolve (can be negative)
+          \return true: success; false: the iteration does not converge, _pos and _vel are not changed
+         */
+        static bool propagate(const Float _gm, Float* _pos, Float* _vel, const Float _dt) {
+            Orbit orb;
+            initial(orb, _gm, _pos, _vel, _dt);
+            for (int n_iter=0; n_iter<n_iter_max && !orb.converged; n_iter++) iterate(orb);
+            if (!orb.converged) return false;
+            update(orb, _pos, _vel);
+            return true;
+        }
+
+        //! evolve an array of two-body orbits
+        /*! The orbits are processed in tiles of #n_tile, the scalar iterations of the orbits in one tile are interleaved, see the class description. The results are identical to propagate.
+          @param[in] _n: number of orbits
+          @param[in] _gm: G*(m1+m2) of orbits
+          @param[in] _dt: time to evolve of orbits
+          @param[in,out] _x, _y, _z: relative positions
+          @param[in,out] _vx, _vy, _vz: relative velocities
+          \return number of orbits where the iteration does not converge, these orbits are not changed
+         */
+        static int propagateBatch(const int _n, const Float* _gm, const Float* _dt,
+                                  Float* _x, Float* _y, Float* _z,
+                                  Float* _vx, Float* _vy, Float* _vz) {
+            Orbit orb[n_tile];
+            const int n_tile_local = n_tile; // std::min takes a reference, n_tile has no out-of-class definition
+            int n_fail = 0;
+            for (int i0=0; i0<_n; i0+=n_tile) {
+                const int n = std::min(n_tile_local, _n-i0);
+                for (int k=0; k<n; k++) {
+                    const int i = i0 + k;
+                    const Float pos[3] = {_x[i], _y[i], _z[i]};
+                    const Float vel[3] = {_vx[i], _vy[i], _vz[i]};
+                    initial(orb[k], _gm[i], pos, vel, _dt[i]);
+                }
+                for (int n_iter=0; n_iter<n_iter_max; n_iter++) {
+                    int n_converged = 0;
+                    for (int k=0; k<n; k++) {
+                        iterate(orb[k]);
+                        n_converged += orb[k].converged;
+                    }
+                    if (n_converged==n) break;
+                }
+                for (int k=0; k<n; k++) {
+                    if (!orb[k].converged) {
+                        n_fail++;
+                        continue;
+                    }
+                    const int i = i0 + k;
+                    Float pos[3] = {_x[i], _y[i], _z[i]};
+                    Float vel[3] = {_vx[i], _vy[i], _vz[i]};
+                    update(orb[k], pos, vel);
+                    _x[i] = pos[0];
+                    _y[i] = pos[1];
+                    _z[i] = pos[2];
+                    _vx[i] = vel[0];
+                    _vy[i] = vel[1];
+                    _vz[i] = vel[2];
+                }
+            }
+            return n_fail;
+        }
+    };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace COMM {
+
+    //! sum of an array by a fixed-order pairwise tree
+    /*! The array is divided into two halves recursively until no more than 8 values are left, which are summed in sequence. 
+      The order of additions only depends on _n, thus the result is bitwise reproducible no matter how (and by how many threads) the values are calculated. The round-off error increases as O(log n) instead of O(n) for the sequential sum.
+      @param[in] _data: array of values
+      @param[in] _n: number of values
+      \return sum
+     */
+    template <class T>
+    T reduceSumTree(const T* _data, const int _n) {
+        if (_n<=8) {
+            T sum = T(0.0);
+            for (int i=0; i<_n; i++) sum += _data[i];
+            return sum;
+        }
+        const int n_half = _n/2;
+        return reduceSumTree(_data, n_half) + reduceSumTree(_data+n_half, _n-n_half);
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "Common/Float.h"
+
+namespace COMM {
+
+    //! Scratch memory arena with bump allocation
+    /*! Temporary arrays are allocated by moving a pointer in large memory blocks and released together by rewinding to a mark.
+      The blocks are kept after rewinding, so that the same memory is reused in the next call without new allocation or page faults.
+      If a block is full, a new block with at least the double size is added, thus the arrays allocated before are not moved.
+      Each thread has its own arena (getThreadLocal), no lock is needed.
+     */
+    class ScratchArena{
+    private:
+        struct Block{
+            char* data;  // memory address
+            size_t size; // block size in bytes
+        };
+        std::vector<Block> blocks_; //!< memory blocks
+        int i_block_;   //!< current block index
+        size_t offset_; //!< used bytes in the current block
+
+    public:
+        static const size_t block_size_default = 1<<20; //!< size of the first block in bytes
+        static const size_t align = 64; //!< alignment of all allocations in bytes
+
+        //! position of the arena to rewind
+        struct Mark{
+            int i_block;
+            size_t offset;
+        };
+
+        ScratchArena(): blocks_(), i_block_(-1), offset_(0) {}
+
+        ~ScratchArena() { clear(); }
+
+        ScratchArena(const ScratchArena&) = delete;
+        ScratchArena& operator = (const ScratchArena&) = delete;
+
+        //! free all memory blocks
+        void clear() {
+            for (auto& b: blocks_) free(b.data);
+            blocks_.clear();
+            i_block_ = -1;
+            offset_ = 0;
+        }
+
+        //! get current position
+        Mark mark() const {
+            return Mark{i_block_, offset_};
+        }
+
+        //! release all arrays allocated after the mark
+        /*! @param[in] _mark: position from mark()
+         */
+        void rewind(const Mark& _mark) {
+            ASSERT(_mark.i_block<=i_block_);
+            i_block_ = _mark.i_block;
+            offset_ = _mark.offset;
+        }
+
+        //! allocate an array
+        /*! Trivial types are not initialized (same as variable-length arrays), other types are default constructed. The destructors are never called.
+          @param[in] _n: number of elements
+          \return address of the array
+         */
+        template <class T>
+        T* allocate(const size_t _n) {
+            static_assert(std::is_trivially_destructible<T>::value, "ScratchArena only supports trivially destructible types");
+            static_assert(alignof(T)<=align, "alignment of the type is too large");
+            const size_t size = ((sizeof(T)*_n + align - 1)/align)*align;
+            // move to the next block if the current one is not big enough
+            while (i_block_<0 || offset_+size>blocks_[i_block_].size) {
+                i_block_++;
+                offset_ = 0;
+                if (i_block_==int(blocks_.size())) {
+                    size_t size_new = blocks_.size()>0 ? 2*blocks_.back().size : block_size_default;
+                    while (size_new<size) size_new *= 2;
+                    char* data = (char*)aligned_alloc(align, size_new);
+                    if (data==NULL) {
+                        std::cerr<<"Error: scratch arena allocation fails! requiring "<<size_new<<" bytes.\n";
+                        abort();
+                    }
+                    blocks_.push_back(Block{data, size_new});
+                }
+            }
+            T* ptr = (T*)(blocks_[i_block_].data + offset_);
+            offset_ += size;
+            if (!std::is_trivially_default_constructible<T>::value)
+                for (size_t i=0; i<_n; i++) new (ptr+i) T();
+            return ptr;
+        }
+
+        //! get the arena of the current thread
+        static ScratchArena& getThreadLocal() {
+            static thread_local ScratchArena arena;
+            return arena;
+        }
+    };
+
+    //! Scope of scratch arrays
+    /*! Marks the thread-local arena at construction and rewinds it at destruction, so that all arrays allocated through the scope are released when the scope ends (also for early returns).
+     */
+    class ScratchScope{
+    private:
+        ScratchArena& arena_;
+        ScratchArena::Mark mark_;
+
+    public:
+        ScratchScope(): arena_(ScratchArena::getThreadLocal()), mark_(arena_.mark()) {}
+
+        ~ScratchScope() { arena_.rewind(mark_); }
+
+        ScratchScope(const ScratchScope&) = delete;
+        ScratchScope& operator = (const ScratchScope&) = delete;
+
+        //! allocate an array in the arena, see ScratchArena::allocate
+        template <class T>
+        T* allocate(const size_t _n) {
+            return arena_.template allocate<T>(_n);
+        }
+    };
+}
@@ -32,7 +32,7 @@ namespace TF
             }
             }
     
-            executor_ = std::make_unique<tf::Executor>(256*1024*1024, threads_to_use); });
+            executor_ = std::make_unique<tf::Executor>(threads_to_use); });
             return *executor_;
         }
 
@@ -37,10 +37,11 @@ namespace H4{
 
     public:
         Float dt_limit;       ///> hermite time step limit for this group
+        Float dt_integrate_last; ///> time interval of the last AR integration, used to estimate integration cost
         COMM::List<int> particle_index; // particle index in original array (Hermite particles)
         Float vcm_record[3];  // record the last group c.m. velocity before the energy correction after interruption. This is used to get correct kinetic energy corretion for perturbation in hermite_manager.calcEnergy
 
-        ARInformation(): ARInfoBase(), dt_limit(NUMERIC_FLOAT_MAX), particle_index(), vcm_record{0,0,0}{}
+        ARInformation(): ARInfoBase(), dt_limit(NUMERIC_FLOAT_MAX), dt_integrate_last(0.0), particle_index(), vcm_record{0,0,0}{}
 
         //! check whether parameters values are correct
         /*! \return true: all correct
@@ -80,6 +81,7 @@ namespace H4{
         void clear() {
             ARInfoBase::clear();
             dt_limit = NUMERIC_FLOAT_MAX;
+            dt_integrate_last = 0.0;
             particle_index.clear();
             vcm_record[0] = vcm_record[1] =vcm_record[2] = 0.0;
         }
@@ -100,6 +102,7 @@ namespace H4{
             auto& bin_root=ARInfoBase::getBinaryTreeRoot();
             ASSERT(bin_root.getMemberN() == n_members);
             bin_root.processLeafIter(_particles, addOneParticleAndReLinkPointer);
+            ARInfoBase::buildTreeSchedule();
         }
 
         //! get two branch particle index
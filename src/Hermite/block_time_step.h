@@ -34,6 +34,30 @@ namespace H4{
         }
 
 
+        //! calculate 2nd order time step from squared norms
+        /*! Branch-free, thus it can be used in vectorized loops (see CorrectorTileSoA)
+          @param[in] _s0: |acc0|^2 + acc0_offset_sq
+          @param[in] _s1: |acc1|^2
+          \return time step
+        */
+        Float calcDt2ndSq(const Float _s0, const Float _s1) const {
+            const Float dt = eta_2nd * sqrt( _s0 / _s1 );
+            return (_s0 == acc0_offset_sq || _s1 == 0.0) ? NUMERIC_FLOAT_MAX : dt;
+        }
+
+        //! calculate 4th order time step from squared norms
+        /*! Branch-free, thus it can be used in vectorized loops (see CorrectorTileSoA)
+          @param[in] _s0: |acc0|^2 + acc0_offset_sq
+          @param[in] _s1: |acc1|^2
+          @param[in] _s2: |acc2|^2
+          @param[in] _s3: |acc3|^2
+          \return time step
+        */
+        Float calcDt4thSq(const Float _s0, const Float _s1, const Float _s2, const Float _s3) const {
+            const Float dt = eta_4th * sqrt( (sqrt(_s0*_s2) + _s1) / (sqrt(_s1*_s3) + _s2) );
+            return (_s0 == acc0_offset_sq || _s1 == 0.0) ? NUMERIC_FLOAT_MAX : dt;
+        }
+
         //! calculate 2nd order time step 
         /*! calculate time step based on Acc and its derivatives
           @param[in] acc0: acceleration
@@ -44,10 +68,7 @@ namespace H4{
                         const Float* acc1) const {
             const Float s0 = acc0[0] * acc0[0] + acc0[1] * acc0[1] + acc0[2] * acc0[2] + acc0_offset_sq;
             const Float s1 = acc1[0] * acc1[0] + acc1[1] * acc1[1] + acc1[2] * acc1[2];
-            if(s0 == acc0_offset_sq || s1 == 0.0)
-                return NUMERIC_FLOAT_MAX;
-            else 
-                return eta_2nd * sqrt( s0 / s1 );
+            return calcDt2ndSq(s0, s1);
         }
 
         //! calculate 4th order time step 
@@ -66,10 +87,7 @@ namespace H4{
             const Float s1 = acc1[0] * acc1[0] + acc1[1] * acc1[1] + acc1[2] * acc1[2];
             const Float s2 = acc2[0] * acc2[0] + acc2[1] * acc2[1] + acc2[2] * acc2[2];
             const Float s3 = acc3[0] * acc3[0] + acc3[1] * acc3[1] + acc3[2] * acc3[2];
-            if(s0 == acc0_offset_sq || s1 == 0.0) 
-                return NUMERIC_FLOAT_MAX;
-            else 
-                return eta_4th * sqrt( (sqrt(s0*s2) + s1) / (sqrt(s1*s3) + s2) );
+            return calcDt4thSq(s0, s1, s2, s3);
         }
 
         void print(std::ostream & _fout) const{
@@ -121,6 +139,24 @@ namespace H4{
     private:
         Float dt_max_; // maximum time step
         Float dt_min_; // minimum time step
+
+        //! get the largest block step _dt_limit*0.5^k (k>=0) not larger than the reference step
+        /*! The same as halving _dt_limit until it is not larger than _dt_ref, but k is obtained from the difference of the binary exponents, thus no loop is needed.
+          @param[in] _dt_ref: reference step size
+          @param[in] _dt_limit: maximum step limit
+          \return block step size (0 if _dt_ref<=0)
+        */
+        Float roundToBlockDt(const Float _dt_ref, const Float _dt_limit) const {
+            // also for NaN and infinite reference
+            if (!(_dt_limit > _dt_ref)) return _dt_limit;
+            if (_dt_ref<=0.0) return 0.0;
+            // after scaling dt has the same exponent as _dt_ref, at most one more halving is needed in double precision
+            // the exponents from to_double can be off by one for multi-precision Float, corrected by the loops
+            Float dt = ldexp(_dt_limit, ilogb(to_double(_dt_ref))-ilogb(to_double(_dt_limit)));
+            while (dt > _dt_ref) dt *= 0.5;
+            while (2.0*dt <= _dt_ref && 2.0*dt <= _dt_limit) dt *= 2.0;
+            return dt;
+        }
     public:
         //! contructor
         BlockTimeStep4th(): TimeStep4th(), dt_max_(-1.0), dt_min_(-1.0) {}
@@ -185,23 +221,18 @@ namespace H4{
             }
         }
 
-        //! Calculate 2nd order block time step
-        /*! calculate block time step based on Acc and its derivatives
-          @param[in] _acc0: acceleration
-          @param[in] _acc1: first order derivative of acc0
+        //! Calculate block time step from a reference step
+        /*! @param[in] _dt_ref: reference step from calcDt2nd/calcDt4th (or the squared norm versions)
           @param[in] _dt_limit: maximum step limit
-          \return step size, if dt<dt_min, return -dt;
+          \return step size, if dt<dt_min, abort
         */
-        Float calcBlockDt2nd(const Float* _acc0, 
-                             const Float* _acc1,
-                             const Float _dt_limit) const{
+        Float calcBlockDtFromRef(const Float _dt_ref,
+                                 const Float _dt_limit) const{
             ASSERT(dt_max_>dt_min_);
             ASSERT(_dt_limit<=dt_max_);
             ASSERT(_dt_limit>=dt_min_);
 
-            const Float dt_ref = TimeStep4th::calcDt2nd(_acc0, _acc1);
-            Float dt = _dt_limit;
-            while(dt > dt_ref) dt *= 0.5;
+            const Float dt = roundToBlockDt(_dt_ref, _dt_limit);
 
             if(dt<dt_min_) {
                 std::cerr<<"Error: time step size too small: ("<<dt<<") < dt_min ("<<dt_min_<<")!"<<std::endl;
@@ -211,6 +242,19 @@ namespace H4{
             else return dt;
         }
 
+        //! Calculate 2nd order block time step
+        /*! calculate block time step based on Acc and its derivatives
+          @param[in] _acc0: acceleration
+          @param[in] _acc1: first order derivative of acc0
+          @param[in] _dt_limit: maximum step limit
+          \return step size, if dt<dt_min, return -dt;
+        */
+        Float calcBlockDt2nd(const Float* _acc0, 
+                             const Float* _acc1,
+                             const Float _dt_limit) const{
+            return calcBlockDtFromRef(TimeStep4th::calcDt2nd(_acc0, _acc1), _dt_limit);
+        }
+
         //! Calculate 4th order block time step
         /*! calculate 4th order block time step based on Acc and its derivatives
           @param[in] acc0: acceleration
@@ -225,20 +269,7 @@ namespace H4{
                              const Float* acc2,
                              const Float* acc3,
                              const Float _dt_limit) const {
-            ASSERT(dt_max_>dt_min_);
-            ASSERT(_dt_limit<=dt_max_);
-            ASSERT(_dt_limit>=dt_min_);
-
-            const Float dt_ref = TimeStep4th::calcDt4th(acc0, acc1, acc2, acc3);
-            Float dt = _dt_limit;
-            while(dt > dt_ref) dt *= 0.5;
-
-            if(dt<dt_min_) {
-                std::cerr<<"Error: time step size too small: ("<<dt<<") < dt_min ("<<dt_min_<<")!"<<std::endl;
-                DATADUMP("hard_dump");
-                abort();
-            }
-            else return dt;
+            return calcBlockDtFromRef(TimeStep4th::calcDt4th(acc0, acc1, acc2, acc3), _dt_limit);
         }
 
         void print(std::ostream & _fout) const{
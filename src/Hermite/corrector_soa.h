@@ -0,0 +1,229 @@
+#pragma once
+
+#if (defined __AVX512F__) || (defined __AVX2__)
+#include <immintrin.h>
+#endif
+#include "Common/Float.h"
+#include "Hermite/block_time_step.h"
+
+namespace H4{
+
+    //! Structure-of-arrays tile for the Hermite corrector and time step calculation
+    /*! Up to #n_tile particles are gathered from the AoS particle and force arrays, corrected and their block steps are calculated together in branch-free loops of fixed length, which the compiler can vectorize.
+      The results are scattered back to the particles.
+      With AVX2 or AVX-512, the reference steps (TimeStep4th::calcDt4thSq, or calcDt2ndSq for initial steps) and the rounding to block steps are calculated with SIMD instructions.
+      Used with HERMITE_SIMD, only works with Float=double.
+      The expressions are the same as the scalar corrector and BlockTimeStep4th, thus the results are identical if the compiler does not contract them to fused multiply-add.
+     */
+    template <class Tparticle, class Tforce>
+    class CorrectorTileSoA{
+    public:
+        static const int n_tile = 64; ///> maximum number of particles in one tile
+
+        int n; ///> number of particles in the tile
+        Tparticle* ptcl[n_tile];    ///> particles to correct
+        const Tforce* force[n_tile]; ///> new forces
+        alignas(64) Float init_step_flag[n_tile]; ///> 1: only calculate the 2nd order step; 0: 4th order step
+        alignas(64) Float dt_limit[n_tile]; ///> maximum step size
+        alignas(64) Float dt[n_tile];       ///> current step size
+        alignas(64) Float dt_ref[n_tile];   ///> reference step size before rounding to block steps
+        alignas(64) Float dt_new[n_tile];   ///> new block step size
+        alignas(64) Float pos[3][n_tile];   ///> position, corrected in place
+        alignas(64) Float vel[3][n_tile];   ///> velocity, corrected in place
+        alignas(64) Float acc0[3][n_tile];  ///> acceleration of the last step
+        alignas(64) Float acc1[3][n_tile];  ///> jerk of the last step
+        alignas(64) Float facc0[3][n_tile]; ///> new acceleration
+        alignas(64) Float facc1[3][n_tile]; ///> new jerk
+        alignas(64) Float acc2[3][n_tile];  ///> second order derivative of acceleration
+        alignas(64) Float acc3[3][n_tile];  ///> third order derivative of acceleration
+
+        CorrectorTileSoA(): n(0) {}
+
+        //! check whether the tile is full
+        bool isFull() const {
+            return n==n_tile;
+        }
+
+        //! gather one particle
+        /*! @param[in] _p: particle to correct (with dt, pos, vel, acc0, acc1)
+          @param[in] _f: new force
+          @param[in] _dt_limit: maximum step size allown
+          @param[in] _init_step_flag: true: only calculate dt 2nd instead of 4th
+         */
+        void add(Tparticle& _p, const Tforce& _f, const Float _dt_limit, const bool _init_step_flag) {
+            ASSERT(n<n_tile);
+            ptcl[n] = &_p;
+            force[n] = &_f;
+            init_step_flag[n] = _init_step_flag ? 1.0 : 0.0;
+            dt_limit[n] = _dt_limit;
+            dt[n] = _p.dt;
+            for (int j=0; j<3; j++) {
+                pos[j][n]   = _p.pos[j];
+                vel[j][n]   = _p.vel[j];
+                acc0[j][n]  = _p.acc0[j];
+                acc1[j][n]  = _p.acc1[j];
+                facc0[j][n] = _f.acc0[j];
+                facc1[j][n] = _f.acc1[j];
+            }
+            n++;
+        }
+
+        //! correct one component of position and velocity and calculate the acceleration derivatives of all particles (including the dummy ones) in the tile
+        /*! The arrays do not overlap (restrict) and the loop has the fixed length n_tile, so that the compiler can vectorize it without run-time checks.
+          @param[in,out] _x: position
+          @param[in,out] _v: velocity
+          @param[out] _a2: second order derivative of acceleration
+          @param[out] _a3: third order derivative of acceleration
+          @param[in] _a0: acceleration of the last step
+          @param[in] _a1: jerk of the last step
+          @param[in] _fa0: new acceleration
+          @param[in] _fa1: new jerk
+          @param[in] _h: half step size
+          @param[in] _hinv: inverse of the half step size
+         */
+        static void correctComponent(Float* __restrict__ _x, Float* __restrict__ _v, Float* __restrict__ _a2, Float* __restrict__ _a3,
+                                     const Float* __restrict__ _a0, const Float* __restrict__ _a1, const Float* __restrict__ _fa0, const Float* __restrict__ _fa1,
+                                     const Float* __restrict__ _h, const Float* __restrict__ _hinv) {
+            const Float inv3 = 1.0 / 3.0;
+            for (int k=0; k<n_tile; k++) {
+                const Float h = _h[k];
+                const Float hinv = _hinv[k];
+                const Float A0p = _fa0[k] + _a0[k];
+                const Float A0m = _fa0[k] - _a0[k];
+                const Float A1p = (_fa1[k] + _a1[k])*h;
+                const Float A1m = (_fa1[k] - _a1[k])*h;
+                const Float vel_new = _v[k] + h*( A0p - inv3*A1m );
+                _x[k] += h*( (_v[k] + vel_new) + h*(-inv3*A0m));
+                _v[k] = vel_new;
+                _a3[k] = (1.5*hinv*hinv*hinv) * (A1p - A0m);
+                _a2[k] = (0.5*hinv*hinv) * A1m + h*_a3[k];
+            }
+        }
+
+        //! calculate the reference steps and the block steps of all particles (including the dummy ones) in the tile
+        /*! The same as BlockTimeStep4th::calcBlockDt4th, or calcBlockDt2nd if init_step_flag is set, but without the check of the minimum step size.
+          @param[in] _step: time step calculator
+         */
+        void calcBlockDt(const BlockTimeStep4th& _step) {
+#if (defined __AVX512F__)
+            const __m512d off = _mm512_set1_pd(_step.acc0_offset_sq), zero = _mm512_setzero_pd(), half = _mm512_set1_pd(0.5);
+            const __m512d eta_2nd = _mm512_set1_pd(_step.eta_2nd), eta_4th = _mm512_set1_pd(_step.eta_4th), dt_max = _mm512_set1_pd(NUMERIC_FLOAT_MAX);
+            auto norm2 = [](const Float (&_v)[3][n_tile], const int _k) {
+                const __m512d x = _mm512_load_pd(_v[0]+_k), y = _mm512_load_pd(_v[1]+_k), z = _mm512_load_pd(_v[2]+_k);
+                return _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(x,x), _mm512_mul_pd(y,y)), _mm512_mul_pd(z,z));
+            };
+            for (int k=0; k<n_tile; k+=8) {
+                const __m512d s0 = _mm512_add_pd(norm2(facc0, k), off);
+                const __m512d s1 = norm2(facc1, k);
+                const __m512d s2 = norm2(acc2, k);
+                const __m512d s3 = norm2(acc3, k);
+                const __m512d dt_2nd = _mm512_mul_pd(eta_2nd, _mm512_sqrt_pd(_mm512_div_pd(s0, s1)));
+                const __m512d dt_4th = _mm512_mul_pd(eta_4th, _mm512_sqrt_pd(_mm512_div_pd(_mm512_add_pd(_mm512_sqrt_pd(_mm512_mul_pd(s0,s2)), s1),
+                                                                                           _mm512_add_pd(_mm512_sqrt_pd(_mm512_mul_pd(s1,s3)), s2))));
+                const __mmask8 init = _mm512_cmp_pd_mask(_mm512_load_pd(init_step_flag+k), zero, _CMP_NEQ_OQ);
+                const __mmask8 no_step = _mm512_cmp_pd_mask(s0, off, _CMP_EQ_OQ) | _mm512_cmp_pd_mask(s1, zero, _CMP_EQ_OQ);
+                const __m512d ref = _mm512_mask_blend_pd(no_step, _mm512_mask_blend_pd(init, dt_4th, dt_2nd), dt_max);
+                _mm512_store_pd(dt_ref+k, ref);
+                // block step: limit*2^(exponent(ref)-exponent(limit)), halved once if it is larger than ref
+                const __m512d limit = _mm512_load_pd(dt_limit+k);
+                __m512d dtb = _mm512_scalef_pd(limit, _mm512_sub_pd(_mm512_getexp_pd(ref), _mm512_getexp_pd(limit)));
+                dtb = _mm512_mask_mul_pd(dtb, _mm512_cmp_pd_mask(dtb, ref, _CMP_GT_OQ), dtb, half);
+                dtb = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(ref, zero, _CMP_LE_OQ), dtb, zero);
+                dtb = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(limit, ref, _CMP_GT_OQ), limit, dtb);
+                _mm512_store_pd(dt_new+k, dtb);
+            }
+#elif (defined __AVX2__)
+            const __m256d off = _mm256_set1_pd(_step.acc0_offset_sq), zero = _mm256_setzero_pd(), half = _mm256_set1_pd(0.5);
+            const __m256d eta_2nd = _mm256_set1_pd(_step.eta_2nd), eta_4th = _mm256_set1_pd(_step.eta_4th), dt_max = _mm256_set1_pd(NUMERIC_FLOAT_MAX);
+            const __m256d exp_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FF0000000000000LL));
+            auto norm2 = [](const Float (&_v)[3][n_tile], const int _k) {
+                const __m256d x = _mm256_load_pd(_v[0]+_k), y = _mm256_load_pd(_v[1]+_k), z = _mm256_load_pd(_v[2]+_k);
+                return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x,x), _mm256_mul_pd(y,y)), _mm256_mul_pd(z,z));
+            };
+            for (int k=0; k<n_tile; k+=4) {
+                const __m256d s0 = _mm256_add_pd(norm2(facc0, k), off);
+                const __m256d s1 = norm2(facc1, k);
+                const __m256d s2 = norm2(acc2, k);
+                const __m256d s3 = norm2(acc3, k);
+                const __m256d dt_2nd = _mm256_mul_pd(eta_2nd, _mm256_sqrt_pd(_mm256_div_pd(s0, s1)));
+                const __m256d dt_4th = _mm256_mul_pd(eta_4th, _mm256_sqrt_pd(_mm256_div_pd(_mm256_add_pd(_mm256_sqrt_pd(_mm256_mul_pd(s0,s2)), s1),
+                                                                                           _mm256_add_pd(_mm256_sqrt_pd(_mm256_mul_pd(s1,s3)), s2))));
+                const __m256d init = _mm256_cmp_pd(_mm256_load_pd(init_step_flag+k), zero, _CMP_NEQ_OQ);
+                const __m256d no_step = _mm256_or_pd(_mm256_cmp_pd(s0, off, _CMP_EQ_OQ), _mm256_cmp_pd(s1, zero, _CMP_EQ_OQ));
+                const __m256d ref = _mm256_blendv_pd(_mm256_blendv_pd(dt_4th, dt_2nd, init), dt_max, no_step);
+                _mm256_store_pd(dt_ref+k, ref);
+                // block step: the mantissa of limit with the exponent of ref, halved once if it is larger than ref
+                // not exact for subnormal ref, but then the step is below dt_min and is recalculated in correctAndScatter
+                const __m256d limit = _mm256_load_pd(dt_limit+k);
+                __m256d dtb = _mm256_or_pd(_mm256_andnot_pd(exp_mask, limit), _mm256_and_pd(exp_mask, ref));
+                dtb = _mm256_blendv_pd(dtb, _mm256_mul_pd(dtb, half), _mm256_cmp_pd(dtb, ref, _CMP_GT_OQ));
+                dtb = _mm256_blendv_pd(dtb, zero, _mm256_cmp_pd(ref, zero, _CMP_LE_OQ));
+                dtb = _mm256_blendv_pd(limit, dtb, _mm256_cmp_pd(limit, ref, _CMP_GT_OQ));
+                _mm256_store_pd(dt_new+k, dtb);
+            }
+#else
+            const Float acc0_offset_sq = _step.acc0_offset_sq;
+            for (int k=0; k<n_tile; k++) {
+                const Float s0 = facc0[0][k] * facc0[0][k] + facc0[1][k] * facc0[1][k] + facc0[2][k] * facc0[2][k] + acc0_offset_sq;
+                const Float s1 = facc1[0][k] * facc1[0][k] + facc1[1][k] * facc1[1][k] + facc1[2][k] * facc1[2][k];
+                const Float s2 = acc2[0][k] * acc2[0][k] + acc2[1][k] * acc2[1][k] + acc2[2][k] * acc2[2][k];
+                const Float s3 = acc3[0][k] * acc3[0][k] + acc3[1][k] * acc3[1][k] + acc3[2][k] * acc3[2][k];
+                const Float dt_2nd = _step.calcDt2ndSq(s0, s1);
+                const Float dt_4th = _step.calcDt4thSq(s0, s1, s2, s3);
+                dt_ref[k] = (init_step_flag[k]!=0.0) ? dt_2nd : dt_4th;
+            }
+            for (int k=0; k<n_tile; k++) dt_new[k] = _step.calcBlockDtFromRef(dt_ref[k], dt_limit[k]);
+#endif
+        }
+
+        //! correct all particles in the tile, calculate new steps and write back to particles, then reset the tile
+        /*! @param[in] _step: time step calculator
+         */
+        void correctAndScatter(const BlockTimeStep4th& _step) {
+            if (n==0) return;
+            // fill the unused part with dummy particles, so that all loops have the fixed length n_tile
+            for (int k=n; k<n_tile; k++) {
+                init_step_flag[k] = 0.0;
+                dt_limit[k] = _step.getDtMax();
+                dt[k] = 1.0;
+                for (int j=0; j<3; j++)
+                    pos[j][k] = vel[j][k] = acc0[j][k] = acc1[j][k] = facc0[j][k] = facc1[j][k] = 0.0;
+            }
+            alignas(64) Float h[n_tile], hinv[n_tile];
+            for (int k=0; k<n_tile; k++) {
+                h[k] = 0.5 * dt[k];
+                hinv[k] = 2.0 / dt[k];
+            }
+            for (int j=0; j<3; j++)
+                correctComponent(pos[j], vel[j], acc2[j], acc3[j], acc0[j], acc1[j], facc0[j], facc1[j], h, hinv);
+
+            calcBlockDt(_step);
+
+            const Float dt_min = _step.getDtMin();
+            for (int k=0; k<n; k++) {
+                auto& pk = *ptcl[k];
+                const auto& fk = *force[k];
+                for (int j=0; j<3; j++) {
+                    pk.pos[j] = pos[j][k];
+                    pk.vel[j] = vel[j][k];
+                    pk.acc0[j] = facc0[j][k];
+                    pk.acc1[j] = facc1[j][k];
+#ifdef HERMITE_DEBUG_ACC
+                    pk.acc2[j] = acc2[j][k];
+                    pk.acc3[j] = acc3[j][k];
+#endif
+                }
+                pk.time += dt[k];
+                pk.pot = fk.pot;
+                // too small step: recalculate by the scalar function to report the error
+                pk.dt = (dt_new[k] < dt_min) ? _step.calcBlockDtFromRef(dt_ref[k], dt_limit[k]) : dt_new[k];
+#ifdef HERMITE_DEBUG
+                if (init_step_flag[k]!=0.0)
+                    std::cerr<<"Initial step flag on: pi.id: "<<pk.id<<" step size: "<<pk.dt<<" time: "<<pk.time<<std::endl;
+#endif
+                ASSERT((dt[k] > 0.0 && pk.dt >0.0));
+            }
+            n = 0;
+        }
+    };
+}
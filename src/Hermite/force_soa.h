@@ -0,0 +1,275 @@
+#pragma once
+
+#include <cstdlib>
+#include <type_traits>
+#if (defined __AVX512F__) || (defined __AVX2__)
+#include <immintrin.h>
+#endif
+#include "Common/Float.h"
+
+namespace H4{
+
+    //! Structure-of-arrays buffer of j particles for the Hermite force calculation
+    /*! The predicted positions, velocities, masses and ids of j particles are packed in aligned arrays, so that the acc/jerk/pot of one i particle can be calculated with SIMD instructions.
+      The buffer is padded with zero mass particles to the multiple of #simd_width.
+      Only works with Float=double.
+     */
+    class JParticleSoA{
+    public:
+        static const int simd_width = 8; ///> padding size, also the alignment (in number of doubles)
+
+        int n;    ///> number of j particles
+        int nmax; ///> maximum number of j particles (padded)
+        double* x;  ///> position x
+        double* y;  ///> position y
+        double* z;  ///> position z
+        double* vx; ///> velocity x
+        double* vy; ///> velocity y
+        double* vz; ///> velocity z
+        double* m;  ///> mass
+        double* id; ///> particle id, used to exclude the i particle itself
+        int* index; ///> index of the particle in the original (predictor) array
+
+        static_assert(std::is_same<Float, double>::value, "JParticleSoA only supports Float=double");
+
+        JParticleSoA(): n(0), nmax(0), x(NULL), y(NULL), z(NULL), vx(NULL), vy(NULL), vz(NULL), m(NULL), id(NULL), index(NULL) {}
+
+        ~JParticleSoA() { clear(); }
+
+        JParticleSoA(const JParticleSoA&) = delete;
+        JParticleSoA& operator = (const JParticleSoA&) = delete;
+
+        //! allocate aligned memory
+        /*! @param[in] _nmax: maximum number of j particles
+         */
+        void reserveMem(const int _nmax) {
+            ASSERT(nmax==0);
+            ASSERT(_nmax>0);
+            nmax = ((_nmax + simd_width - 1)/simd_width)*simd_width;
+            const size_t size = sizeof(double)*nmax;
+            const size_t align = sizeof(double)*simd_width;
+            x  = (double*)aligned_alloc(align, size);
+            y  = (double*)aligned_alloc(align, size);
+            z  = (double*)aligned_alloc(align, size);
+            vx = (double*)aligned_alloc(align, size);
+            vy = (double*)aligned_alloc(align, size);
+            vz = (double*)aligned_alloc(align, size);
+            m  = (double*)aligned_alloc(align, size);
+            id = (double*)aligned_alloc(align, size);
+            index = new int[nmax];
+            n = 0;
+        }
+
+        //! release memory
+        void clear() {
+            if (nmax>0) {
+                free(x);
+                free(y);
+                free(z);
+                free(vx);
+                free(vy);
+                free(vz);
+                free(m);
+                free(id);
+                delete[] index;
+            }
+            x = y = z = vx = vy = vz = m = id = NULL;
+            index = NULL;
+            n = nmax = 0;
+        }
+
+        //! get the padded size
+        int getSizePadded() const {
+            return ((n + simd_width - 1)/simd_width)*simd_width;
+        }
+
+        //! fill data from a list of particles
+        /*! The tail is padded with zero mass particles
+          @param[in] _ptcl: particle array (predictor)
+          @param[in] _index: index list of j particles in _ptcl
+          @param[in] _n: number of j particles
+         */
+        template <class Tparticle>
+        void fill(const Tparticle* _ptcl, const int* _index, const int _n) {
+            ASSERT(_n<=nmax);
+            n = _n;
+            for (int k=0; k<_n; k++) {
+                const int j = _index[k];
+                const auto& pj = _ptcl[j];
+                x[k]  = pj.pos[0];
+                y[k]  = pj.pos[1];
+                z[k]  = pj.pos[2];
+                vx[k] = pj.vel[0];
+                vy[k] = pj.vel[1];
+                vz[k] = pj.vel[2];
+                m[k]  = pj.mass;
+                id[k] = pj.id;
+                index[k] = j;
+            }
+            const int n_pad = getSizePadded();
+            for (int k=_n; k<n_pad; k++) {
+                x[k] = y[k] = z[k] = 0.0;
+                vx[k] = vy[k] = vz[k] = 0.0;
+                m[k] = 0.0;
+                id[k] = 0.0;
+                index[k] = -1;
+            }
+        }
+    };
+
+    //! calculate acceleration, jerk and potential of one i particle from j particles in the range [_j_start, _j_end) of SoA buffer
+    /*! j particles with zero mass or with the same id of i particle are skipped, their distance square in _r2 is set to -1.
+      _j_start should be a multiple of JParticleSoA::simd_width, _j_end should be either a multiple of simd_width or the padded size.
+      The acceleration, jerk and potential are added to _acc0, _acc1 and _pot. The summation order differs from the scalar loop, thus the results agree within round-off error. The distance squares are calculated in the same way as the scalar path.
+      @param[in,out] _acc0: acceleration of i
+      @param[in,out] _acc1: jerk of i
+      @param[in,out] _pot: potential of i
+      @param[out] _r2: distance square (without softening) to each j particle in the range, _r2[0] corresponds to _j_start
+      @param[in] _pj: j particle buffer
+      @param[in] _pos: position of i
+      @param[in] _vel: velocity of i
+      @param[in] _id: id of i
+      @param[in] _G: gravitational constant
+      @param[in] _eps_sq: softening parameter square
+      @param[in] _j_start: start index of j particles
+      @param[in] _j_end: end index of j particles (not included)
+     */
+    inline void calcAccJerkPotSoA(double* _acc0, double* _acc1, double& _pot, double* _r2,
+                                  const JParticleSoA& _pj, const double* _pos, const double* _vel, const double _id,
+                                  const double _G, const double _eps_sq, const int _j_start, const int _j_end) {
+        ASSERT(_j_start%JParticleSoA::simd_width==0);
+        ASSERT(_j_end<=_pj.getSizePadded());
+#if (defined __AVX512F__)
+        const __m512d xi = _mm512_set1_pd(_pos[0]), yi = _mm512_set1_pd(_pos[1]), zi = _mm512_set1_pd(_pos[2]);
+        const __m512d vxi = _mm512_set1_pd(_vel[0]), vyi = _mm512_set1_pd(_vel[1]), vzi = _mm512_set1_pd(_vel[2]);
+        const __m512d idi = _mm512_set1_pd(_id), eps_sq = _mm512_set1_pd(_eps_sq), G = _mm512_set1_pd(_G);
+        const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0), three = _mm512_set1_pd(3.0), minus_one = _mm512_set1_pd(-1.0);
+        __m512d ax = zero, ay = zero, az = zero, jx = zero, jy = zero, jz = zero, pot = zero;
+        for (int j=_j_start; j<_j_end; j+=8) {
+            const __m512d mj = _mm512_load_pd(_pj.m+j);
+            const __mmask8 mask = _mm512_cmp_pd_mask(mj, zero, _CMP_NEQ_OQ) & _mm512_cmp_pd_mask(_mm512_load_pd(_pj.id+j), idi, _CMP_NEQ_OQ);
+            const __m512d dx = _mm512_sub_pd(_mm512_load_pd(_pj.x+j), xi);
+            const __m512d dy = _mm512_sub_pd(_mm512_load_pd(_pj.y+j), yi);
+            const __m512d dz = _mm512_sub_pd(_mm512_load_pd(_pj.z+j), zi);
+            const __m512d dvx = _mm512_sub_pd(_mm512_load_pd(_pj.vx+j), vxi);
+            const __m512d dvy = _mm512_sub_pd(_mm512_load_pd(_pj.vy+j), vyi);
+            const __m512d dvz = _mm512_sub_pd(_mm512_load_pd(_pj.vz+j), vzi);
+            const __m512d dr2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx,dx), _mm512_mul_pd(dy,dy)), _mm512_mul_pd(dz,dz));
+            _mm512_storeu_pd(_r2+j-_j_start, _mm512_mask_blend_pd(mask, minus_one, dr2));
+            // masked lanes use r2=1 to avoid division by zero
+            const __m512d dr2_eps = _mm512_mask_blend_pd(mask, one, _mm512_add_pd(dr2, eps_sq));
+            const __m512d drdv = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx,dvx), _mm512_mul_pd(dy,dvy)), _mm512_mul_pd(dz,dvz));
+            const __m512d rinv = _mm512_div_pd(one, _mm512_sqrt_pd(dr2_eps));
+            const __m512d rinv2 = _mm512_mul_pd(rinv, rinv);
+            const __m512d gmor = _mm512_maskz_mov_pd(mask, _mm512_mul_pd(_mm512_mul_pd(G, mj), rinv));
+            const __m512d gmor3 = _mm512_mul_pd(gmor, rinv2);
+            const __m512d a0x = _mm512_mul_pd(gmor3, dx);
+            const __m512d a0y = _mm512_mul_pd(gmor3, dy);
+            const __m512d a0z = _mm512_mul_pd(gmor3, dz);
+            const __m512d alpha = _mm512_mul_pd(_mm512_mul_pd(three, drdv), rinv2);
+            ax = _mm512_add_pd(ax, a0x);
+            ay = _mm512_add_pd(ay, a0y);
+            az = _mm512_add_pd(az, a0z);
+            jx = _mm512_add_pd(jx, _mm512_sub_pd(_mm512_mul_pd(gmor3, dvx), _mm512_mul_pd(alpha, a0x)));
+            jy = _mm512_add_pd(jy, _mm512_sub_pd(_mm512_mul_pd(gmor3, dvy), _mm512_mul_pd(alpha, a0y)));
+            jz = _mm512_add_pd(jz, _mm512_sub_pd(_mm512_mul_pd(gmor3, dvz), _mm512_mul_pd(alpha, a0z)));
+            pot = _mm512_sub_pd(pot, gmor);
+        }
+        _acc0[0] += _mm512_reduce_add_pd(ax);
+        _acc0[1] += _mm512_reduce_add_pd(ay);
+        _acc0[2] += _mm512_reduce_add_pd(az);
+        _acc1[0] += _mm512_reduce_add_pd(jx);
+        _acc1[1] += _mm512_reduce_add_pd(jy);
+        _acc1[2] += _mm512_reduce_add_pd(jz);
+        _pot += _mm512_reduce_add_pd(pot);
+#elif (defined __AVX2__)
+        const __m256d xi = _mm256_set1_pd(_pos[0]), yi = _mm256_set1_pd(_pos[1]), zi = _mm256_set1_pd(_pos[2]);
+        const __m256d vxi = _mm256_set1_pd(_vel[0]), vyi = _mm256_set1_pd(_vel[1]), vzi = _mm256_set1_pd(_vel[2]);
+        const __m256d idi = _mm256_set1_pd(_id), eps_sq = _mm256_set1_pd(_eps_sq), G = _mm256_set1_pd(_G);
+        const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0), three = _mm256_set1_pd(3.0), minus_one = _mm256_set1_pd(-1.0);
+        __m256d ax = zero, ay = zero, az = zero, jx = zero, jy = zero, jz = zero, pot = zero;
+        for (int j=_j_start; j<_j_end; j+=4) {
+            const __m256d mj = _mm256_load_pd(_pj.m+j);
+            const __m256d mask = _mm256_and_pd(_mm256_cmp_pd(mj, zero, _CMP_NEQ_OQ), _mm256_cmp_pd(_mm256_load_pd(_pj.id+j), idi, _CMP_NEQ_OQ));
+            const __m256d dx = _mm256_sub_pd(_mm256_load_pd(_pj.x+j), xi);
+            const __m256d dy = _mm256_sub_pd(_mm256_load_pd(_pj.y+j), yi);
+            const __m256d dz = _mm256_sub_pd(_mm256_load_pd(_pj.z+j), zi);
+            const __m256d dvx = _mm256_sub_pd(_mm256_load_pd(_pj.vx+j), vxi);
+            const __m256d dvy = _mm256_sub_pd(_mm256_load_pd(_pj.vy+j), vyi);
+            const __m256d dvz = _mm256_sub_pd(_mm256_load_pd(_pj.vz+j), vzi);
+            const __m256d dr2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx,dx), _mm256_mul_pd(dy,dy)), _mm256_mul_pd(dz,dz));
+            _mm256_storeu_pd(_r2+j-_j_start, _mm256_blendv_pd(minus_one, dr2, mask));
+            // masked lanes use r2=1 to avoid division by zero
+            const __m256d dr2_eps = _mm256_blendv_pd(one, _mm256_add_pd(dr2, eps_sq), mask);
+            const __m256d drdv = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx,dvx), _mm256_mul_pd(dy,dvy)), _mm256_mul_pd(dz,dvz));
+            const __m256d rinv = _mm256_div_pd(one, _mm256_sqrt_pd(dr2_eps));
+            const __m256d rinv2 = _mm256_mul_pd(rinv, rinv);
+            const __m256d gmor = _mm256_and_pd(mask, _mm256_mul_pd(_mm256_mul_pd(G, mj), rinv));
+            const __m256d gmor3 = _mm256_mul_pd(gmor, rinv2);
+            const __m256d a0x = _mm256_mul_pd(gmor3, dx);
+            const __m256d a0y = _mm256_mul_pd(gmor3, dy);
+            const __m256d a0z = _mm256_mul_pd(gmor3, dz);
+            const __m256d alpha = _mm256_mul_pd(_mm256_mul_pd(three, drdv), rinv2);
+            ax = _mm256_add_pd(ax, a0x);
+            ay = _mm256_add_pd(ay, a0y);
+            az = _mm256_add_pd(az, a0z);
+            jx = _mm256_add_pd(jx, _mm256_sub_pd(_mm256_mul_pd(gmor3, dvx), _mm256_mul_pd(alpha, a0x)));
+            jy = _mm256_add_pd(jy, _mm256_sub_pd(_mm256_mul_pd(gmor3, dvy), _mm256_mul_pd(alpha, a0y)));
+            jz = _mm256_add_pd(jz, _mm256_sub_pd(_mm256_mul_pd(gmor3, dvz), _mm256_mul_pd(alpha, a0z)));
+            pot = _mm256_sub_pd(pot, gmor);
+        }
+        // horizontal summation
+        auto hsum = [](const __m256d _v) {
+            const __m128d lo = _mm256_castpd256_pd128(_v);
+            const __m128d hi = _mm256_extractf128_pd(_v, 1);
+            const __m128d s = _mm_add_pd(lo, hi);
+            return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+        };
+        _acc0[0] += hsum(ax);
+        _acc0[1] += hsum(ay);
+        _acc0[2] += hsum(az);
+        _acc1[0] += hsum(jx);
+        _acc1[1] += hsum(jy);
+        _acc1[2] += hsum(jz);
+        _pot += hsum(pot);
+#else
+        // scalar version, branch free inner loop for auto-vectorization
+        double ax = 0.0, ay = 0.0, az = 0.0, jx = 0.0, jy = 0.0, jz = 0.0, pot = 0.0;
+        for (int j=_j_start; j<_j_end; j++) {
+            const bool mask = (_pj.m[j]!=0.0) && (_pj.id[j]!=_id);
+            const double dx = _pj.x[j] - _pos[0];
+            const double dy = _pj.y[j] - _pos[1];
+            const double dz = _pj.z[j] - _pos[2];
+            const double dvx = _pj.vx[j] - _vel[0];
+            const double dvy = _pj.vy[j] - _vel[1];
+            const double dvz = _pj.vz[j] - _vel[2];
+            const double dr2 = dx*dx + dy*dy + dz*dz;
+            _r2[j-_j_start] = mask ? dr2 : -1.0;
+            const double dr2_eps = mask ? dr2 + _eps_sq : 1.0;
+            const double drdv = dx*dvx + dy*dvy + dz*dvz;
+            const double rinv = 1.0/sqrt(dr2_eps);
+            const double rinv2 = rinv*rinv;
+            const double gmor = mask ? _G*_pj.m[j]*rinv : 0.0;
+            const double gmor3 = gmor*rinv2;
+            const double a0x = gmor3*dx;
+            const double a0y = gmor3*dy;
+            const double a0z = gmor3*dz;
+            const double alpha = 3.0*drdv*rinv2;
+            ax += a0x;
+            ay += a0y;
+            az += a0z;
+            jx += gmor3*dvx - alpha*a0x;
+            jy += gmor3*dvy - alpha*a0y;
+            jz += gmor3*dvz - alpha*a0z;
+            pot -= gmor;
+        }
+        _acc0[0] += ax;
+        _acc0[1] += ay;
+        _acc0[2] += az;
+        _acc1[0] += jx;
+        _acc1[1] += jy;
+        _acc1[2] += jz;
+        _pot += pot;
+#endif
+    }
+}
@@ -3,12 +3,20 @@
 #include "Common/Float.h"
 #include "Common/list.h"
 #include "Common/taskflow_manager.h"
+#include "Common/scratch_arena.h"
+#include "Common/reduction.h"
 #include "AR/symplectic_integrator.h"
 #include "Hermite/ar_information.h"
 #include "Hermite/hermite_particle.h"
 #include "Hermite/block_time_step.h"
 #include "Hermite/neighbor.h"
 #include "Hermite/profile.h"
+#include "Hermite/octree.h"
+#include "Hermite/predictor_soa.h"
+#ifdef HERMITE_SIMD
+#include "Hermite/force_soa.h"
+#include "Hermite/corrector_soa.h"
+#endif
 #include <map>
 
 namespace H4{
@@ -35,13 +43,21 @@ namespace H4{
         //Float r_neighbor_crit; ///> the distance for neighbor search
         Tmethod interaction; ///> class contain interaction function
         BlockTimeStep4th step; ///> time step calculator
+        int n_group_ar_parallel_min; ///> minimum number of groups to integrate AR groups in parallel by taskflow; <=0: always serial
+        int ac_step_ratio; ///> Ahmad-Cohen scheme for singles: number of irregular (neighbor) steps per regular (full force) step; <=1: full force in every step
+        Float tree_theta; ///> opening angle of the octree for far-field force of singles and group c.m., far nodes are calculated by the single pair functions of the interaction class; <=0: direct summation
+        bool predict_stale_only; ///> only predict particles whose time differs from the prediction time, the others are copied; false: predict all
+        bool reproducible_flag; ///> results do not depend on the number of threads: sums of values calculated in parallel use the fixed-order tree reduction (COMM::reduceSumTree)
+        bool energy_from_pot; ///> calculate the potential energy from the potentials of the last force calculation when all particles are synchronized, instead of the O(N^2) pair summation
 #ifdef ADJUST_GROUP_PRINT
         bool adjust_group_write_flag; ///> flag to indicate whether to output new/end group information
         std::ofstream fgroup; ///> pointer to a file IO to output new/end group information
 #endif
 
 #ifdef ADJUST_GROUP_PRINT
-        HermiteManager(): interaction(), step(), adjust_group_write_flag(true), fgroup() {}
+        HermiteManager(): interaction(), step(), n_group_ar_parallel_min(0), ac_step_ratio(1), tree_theta(0.0), predict_stale_only(false), reproducible_flag(false), energy_from_pot(false), adjust_group_write_flag(true), fgroup() {}
+#else
+        HermiteManager(): interaction(), step(), n_group_ar_parallel_min(0), ac_step_ratio(1), tree_theta(0.0), predict_stale_only(false), reproducible_flag(false), energy_from_pot(false) {}
 #endif
 
 
@@ -65,6 +81,12 @@ namespace H4{
             //<<"r_neighbor_crit : "<<r_neighbor_crit<<std::endl;
             interaction.print(_fout);
             step.print(_fout);
+            _fout<<"n_group_ar_parallel_min : "<<n_group_ar_parallel_min<<std::endl
+                 <<"ac_step_ratio : "<<ac_step_ratio<<std::endl
+                 <<"tree_theta : "<<tree_theta<<std::endl
+                 <<"predict_stale_only : "<<predict_stale_only<<std::endl
+                 <<"reproducible_flag : "<<reproducible_flag<<std::endl
+                 <<"energy_from_pot : "<<energy_from_pot<<std::endl;
         }
 
 
@@ -89,7 +111,8 @@ namespace H4{
         }
 
         //! write class data to file with binary format
-        /*! @param[in] _fp: FILE type file for output
+        /*! The options added after the old versions are written at the end.
+          @param[in] _fp: FILE type file for output
          */
         void writeBinary(FILE *_fp) const {
             //size_t size = sizeof(*this) - sizeof(interaction) - sizeof(step);
@@ -99,18 +122,29 @@ namespace H4{
 #ifdef ADJUST_GROUP_PRINT
             fwrite(&adjust_group_write_flag, sizeof(bool),1,_fp);
 #endif
+            fwrite(&n_group_ar_parallel_min, sizeof(int),1,_fp);
+            fwrite(&ac_step_ratio, sizeof(int),1,_fp);
+            fwrite(&tree_theta, sizeof(Float),1,_fp);
+            fwrite(&predict_stale_only, sizeof(bool),1,_fp);
+            fwrite(&reproducible_flag, sizeof(bool),1,_fp);
+            fwrite(&energy_from_pot, sizeof(bool),1,_fp);
         }
 
         //! read class data to file with binary format
         /*! @param[in] _fin: FILE type file for reading
+          @param[in] _version: version for reading. 0: default; 1: missing the options after step (n_group_ar_parallel_min, ac_step_ratio, tree_theta, predict_stale_only, reproducible_flag, energy_from_pot), which are set to the default values of the constructor
          */
-        void readBinary(FILE *_fin) {
+        void readBinary(FILE *_fin, int _version=0) {
             //size_t size = sizeof(*this) - sizeof(interaction) - sizeof(step);
             //size_t rcount = fread(this, size, 1, _fin);
             //if (rcount<1) {
             //    std::cerr<<"Error: Data reading fails! requiring data number is 1, only obtain "<<rcount<<".\n";
             //    abort();
             //}
+            if (_version!=0&&_version!=1) {
+                std::cerr<<"Error: HermiteManager.readBinary unknown version "<<_version<<", should be 0 or 1."<<std::endl;
+                abort();
+            }
             interaction.readBinary(_fin);
             step.readBinary(_fin);
 #ifdef ADJUST_GROUP_PRINT
@@ -120,8 +154,33 @@ namespace H4{
                 abort();
             }
 #endif
+            if (_version==1) {
+                n_group_ar_parallel_min = 0;
+                ac_step_ratio = 1;
+                tree_theta = 0.0;
+                predict_stale_only = false;
+                reproducible_flag = false;
+                energy_from_pot = false;
+                return;
+            }
+            readBinaryMember(n_group_ar_parallel_min, _fin);
+            readBinaryMember(ac_step_ratio, _fin);
+            readBinaryMember(tree_theta, _fin);
+            readBinaryMember(predict_stale_only, _fin);
+            readBinaryMember(reproducible_flag, _fin);
+            readBinaryMember(energy_from_pot, _fin);
         }
 
+    private:
+        //! read one member with binary format
+        template <class T>
+        static void readBinaryMember(T& _data, FILE *_fin) {
+            size_t rcount = fread(&_data, sizeof(T), 1, _fin);
+            if (rcount<1) {
+                std::cerr<<"Error: Data reading fails! requiring data number is 1, only obtain "<<rcount<<".\n";
+                abort();
+            }
+        }
     };
 
     //! Hermite energy 
@@ -219,6 +278,7 @@ namespace H4{
         int interrupt_group_dt_sorted_group_index_; /// interrupt group position in index_dt_sorted_group_
         AR::InterruptBinary<Tparticle> interrupt_binary_; /// interrupt binary tree address
         COMM::List<int> index_group_merger_; /// merger group index
+        COMM::List<AR::InterruptBinary<Tparticle>> interrupt_binary_group_; /// interrupt results of groups in the order of index_dt_sorted_group_, used in parallel AR integration
 
         // flags
         bool initial_system_flag_; /// flag to indicate whether the system is initialized with all array size defined (reest in initialSystem)
@@ -238,11 +298,59 @@ namespace H4{
         COMM::List<ForceH4> force_;  // force
         COMM::List<Float> time_next_; // next integrated time of particles
 
+        // Ahmad-Cohen scheme for singles (manager->ac_step_ratio>1)
+        COMM::List<ForceH4> force_reg_;   // regular force (from non-neighbors) at the last regular step
+        COMM::List<Float> time_reg_;      // time of the last regular step
+        COMM::List<Float> time_reg_next_; // time of the next regular step, the first step reaching it is regular
+
         // table of mask to show which particles are removed from the integration
         COMM::List<int> index_group_mask_;   // index list to record the masked groups
         COMM::List<bool> table_group_mask_; // bool mask to indicate whether the particle of index (group) (same index of table) is masked (true) or used (false)
         COMM::List<bool> table_single_mask_; // bool mask to indicate whether the particle of index (single) (same index of table) is masked (true) or used (false)
 
+#ifdef HERMITE_SIMD
+        // SoA buffer of predicted singles for SIMD force calculation, filled in calcAccJerkNBList
+        JParticleSoA pred_single_soa_;
+#endif
+
+        // octree for far-field force (manager->tree_theta>0), updated in prepareForceWorkList
+        Octree tree_;
+        int tree_n_refit_; /// number of refits after the last build
+        static const int n_tree_refit_max_ = 16; /// maximum number of refits before the tree is rebuilt
+
+        // tile sizes for force calculation of singles
+        static const int n_tile_i_ = 8;   /// maximum number of active i particles sharing one j sweep
+        static const int n_tile_j_ = 256; /// number of j particles in one tile (multiple of JParticleSoA::simd_width)
+
+        // task graphs owned by the integrator, built once and reused
+        int n_task_; /// number of tasks in each parallel stage (number of workers of the executor)
+        tf::Taskflow step_taskflow_;  /// task graph of one block step, see buildStepTaskflow
+        Float step_time_next_;        /// next time of the block step in step_taskflow_
+        tf::Taskflow predict_taskflow_; /// task graph of prediction, see buildPredictTaskflow
+        Float predict_time_;            /// time for prediction in predict_taskflow_
+        static const int n_predict_parallel_min_ = 1024; /// minimum number of particles to predict in parallel in predictAll
+        tf::Taskflow force_taskflow_; /// task graph of force calculation, see buildForceTaskflow
+        COMM::List<int> force_task_offset_; /// work item range of each task
+        const int* force_index_single_; /// active single index list of current force calculation
+        int force_n_single_;  /// number of active singles
+        int force_n_tile_i_;  /// number of i particles in one tile
+        int force_n_tile_;    /// number of single tiles
+        const int* force_index_group_;  /// active group index list of current force calculation
+        tf::Taskflow correct_taskflow_; /// task graph of correction and time step update, see buildCorrectTaskflow
+        static const int n_correct_parallel_min_ = 64; /// minimum number of particles to correct in parallel in correctAndUpdateTimeNextList
+        static const int n_sum_parallel_min_ = 1024; /// minimum number of items to sum in parallel in sumItemsParallel
+        const int* correct_index_single_; /// single index list of current correction
+        int correct_n_single_;            /// number of singles to correct
+        const int* correct_index_group_;  /// group index list of current correction
+        int correct_n_group_;             /// number of groups to correct
+        Float correct_dt_limit_;          /// step limit of current correction
+        bool correct_init_flag_;          /// true: only calculate 2nd order steps (calcDt2ndList) without correction
+        tf::Taskflow ar_taskflow_;   /// task graph of parallel AR group integration, see buildARTaskflow
+        Float ar_time_next_;         /// time to integrate for ar_taskflow_
+        COMM::List<int> ar_task_offset_;     /// group range of each task in ar_task_group_list_
+        COMM::List<int> ar_task_group_list_; /// group index (in index_dt_sorted_group_) list ordered by tasks
+        COMM::List<double> ar_task_time_;    /// wallclock time of each task
+
     public:
         BlockTimeStep4th step; ///> time step calculator
         HermiteManager<Tacc>* manager; ///< integration manager
@@ -274,12 +382,16 @@ namespace H4{
                              n_act_single_(0), n_act_group_(0), 
                              n_init_single_(0), n_init_group_(0), 
                              index_offset_group_(0), 
-                             interrupt_group_dt_sorted_group_index_(-1), interrupt_binary_(), index_group_merger_(),
+                             interrupt_group_dt_sorted_group_index_(-1), interrupt_binary_(), index_group_merger_(), interrupt_binary_group_(),
                              initial_system_flag_(false), modify_system_flag_(false),
                              index_dt_sorted_single_(), index_dt_sorted_group_(), 
                              index_group_resolve_(), index_group_cm_(), 
-                             pred_(), force_(), time_next_(), 
-                             index_group_mask_(), table_group_mask_(), table_single_mask_(), step(),
+                             pred_(), force_(), time_next_(), force_reg_(), time_reg_(), time_reg_next_(), 
+                             index_group_mask_(), table_group_mask_(), table_single_mask_(), tree_(), tree_n_refit_(0), 
+                             n_task_(1), step_taskflow_(), step_time_next_(0.0), predict_taskflow_(), predict_time_(0.0), force_taskflow_(), force_task_offset_(), 
+                             force_index_single_(NULL), force_n_single_(0), force_n_tile_i_(1), force_n_tile_(0), force_index_group_(NULL), 
+                             correct_taskflow_(), correct_index_single_(NULL), correct_n_single_(0), correct_index_group_(NULL), correct_n_group_(0), correct_dt_limit_(0.0), correct_init_flag_(false),
+                             ar_taskflow_(), ar_time_next_(0.0), ar_task_offset_(), ar_task_group_list_(), ar_task_time_(), step(),
                              manager(NULL), ar_manager(NULL), particles(), groups(), neighbors(), perturber(), info(), profile() {}
 
         //! clear function
@@ -296,6 +408,7 @@ namespace H4{
             interrupt_group_dt_sorted_group_index_ = -1;
             interrupt_binary_.clear();
             index_group_merger_.clear();
+            interrupt_binary_group_.clear();
             initial_system_flag_ = false;
             modify_system_flag_ = false;
 
@@ -308,10 +421,27 @@ namespace H4{
             index_group_mask_.clear();
             table_group_mask_.clear();
             table_single_mask_.clear();
+            step_taskflow_.clear();
+            predict_taskflow_.clear();
+            force_taskflow_.clear();
+            correct_taskflow_.clear();
+            ar_taskflow_.clear();
+            force_task_offset_.clear();
+            ar_task_offset_.clear();
+            ar_task_group_list_.clear();
+            ar_task_time_.clear();
             pred_.clear();
             force_.clear();
             time_next_.clear();
+            force_reg_.clear();
+            time_reg_.clear();
+            time_reg_next_.clear();
             neighbors.clear();
+            tree_.clear();
+            tree_n_refit_ = 0;
+#ifdef HERMITE_SIMD
+            pred_single_soa_.clear();
+#endif
             perturber.clear();
             info.clear();
             profile.clear();
@@ -330,6 +460,7 @@ namespace H4{
             index_dt_sorted_single_.setMode(COMM::ListMode::local);
             index_dt_sorted_group_.setMode(COMM::ListMode::local);
             index_group_merger_.setMode(COMM::ListMode::local);
+            interrupt_binary_group_.setMode(COMM::ListMode::local);
             index_group_resolve_.setMode(COMM::ListMode::local);
             index_group_cm_.setMode(COMM::ListMode::local);
             index_group_mask_.setMode(COMM::ListMode::local);
@@ -337,10 +468,28 @@ namespace H4{
             table_single_mask_.setMode(COMM::ListMode::local);
             pred_.setMode(COMM::ListMode::local);
             force_.setMode(COMM::ListMode::local);
+            force_task_offset_.setMode(COMM::ListMode::local);
+            ar_task_offset_.setMode(COMM::ListMode::local);
+            ar_task_group_list_.setMode(COMM::ListMode::local);
+            ar_task_time_.setMode(COMM::ListMode::local);
             time_next_.setMode(COMM::ListMode::local);
+            force_reg_.setMode(COMM::ListMode::local);
+            time_reg_.setMode(COMM::ListMode::local);
+            time_reg_next_.setMode(COMM::ListMode::local);
             neighbors.setMode(COMM::ListMode::local);
 
             index_group_merger_.reserveMem(nmax_group);
+            interrupt_binary_group_.reserveMem(nmax_group);
+
+            // task ranges of parallel stages
+            n_task_ = std::max(1, int(TF::Manager::get_executor().num_workers()));
+            force_task_offset_.reserveMem(n_task_+1);
+            force_task_offset_.resizeNoInitialize(n_task_+1);
+            ar_task_offset_.reserveMem(n_task_+1);
+            ar_task_offset_.resizeNoInitialize(n_task_+1);
+            ar_task_time_.reserveMem(n_task_);
+            ar_task_time_.resizeNoInitialize(n_task_);
+            ar_task_group_list_.reserveMem(nmax_group);
             
             index_dt_sorted_single_.reserveMem(nmax);
             index_dt_sorted_group_.reserveMem(nmax_group);
@@ -357,14 +506,17 @@ namespace H4{
             pred_.reserveMem(nmax_tot);
             force_.reserveMem(nmax_tot);
             time_next_.reserveMem(nmax_tot);
+            force_reg_.reserveMem(nmax);
+            time_reg_.reserveMem(nmax);
+            time_reg_next_.reserveMem(nmax);
+#ifdef HERMITE_SIMD
+            pred_single_soa_.reserveMem(nmax);
+#endif
 
-            // reserve for neighbor list
+            // reserve for neighbor list, the lists are expanded when more neighbors are found
             neighbors.reserveMem(nmax);
             auto* nb_ptr = neighbors.getDataAddress();
-            for (int i=0; i<nmax; i++) {
-                nb_ptr[i].neighbor_address.setMode(COMM::ListMode::local);
-                nb_ptr[i].neighbor_address.reserveMem(nmax_tot);
-            }
+            for (int i=0; i<nmax; i++) nb_ptr[i].reserveMem(NBAdrList<Tparticle>::n_reserve_default);
         }
 
     private:
@@ -405,36 +557,53 @@ namespace H4{
 
 
 
-        //! predict particles to the time
-        /*! @param[in] _time_pred: time for prediction
+        //! predict singles in a range of index_dt_sorted_single_ to the time
+        /*! The particles are gathered to SoA tiles (PredictorTileSoA) and predicted in vectorizable loops. 
+          If manager->predict_stale_only is true, the particles already at the time are copied without prediction.
+          @param[in] _time_pred: time for prediction
+          @param[in] _k_start: starting index in index_dt_sorted_single_
+          @param[in] _k_end: ending index (not included) in index_dt_sorted_single_
          */
-        void predictAll(const Float _time_pred) {
-            static thread_local const Float inv3 = 1.0 / 3.0;
-            // single
-            const int n_single = index_dt_sorted_single_.getSize();
-            ASSERT(n_single <= particles.getSize());
+        void predictSingleRange(const Float _time_pred, const int _k_start, const int _k_end) {
+            ASSERT(_k_end <= index_dt_sorted_single_.getSize());
+            ASSERT(_k_end <= particles.getSize());
+            const bool stale_only = manager->predict_stale_only;
             const auto* ptcl = particles.getDataAddress();
             auto* pred = pred_.getDataAddress();
-            for (int k=0; k<n_single; k++){
+            PredictorTileSoA tile;
+            for (int k=_k_start; k<_k_end; k++){
                 const int i = index_dt_sorted_single_[k];
-                const Float dt = _time_pred - ptcl[i].time;
                 ASSERT(i<particles.getSize());
                 ASSERT(i>=0);
-                pred[i].pos[0] = ptcl[i].pos[0] + dt*(ptcl[i].vel[0]  + 0.5*dt*(ptcl[i].acc0[0] + inv3*dt*ptcl[i].acc1[0]));
-                pred[i].pos[1] = ptcl[i].pos[1] + dt*(ptcl[i].vel[1]  + 0.5*dt*(ptcl[i].acc0[1] + inv3*dt*ptcl[i].acc1[1]));
-                pred[i].pos[2] = ptcl[i].pos[2] + dt*(ptcl[i].vel[2]  + 0.5*dt*(ptcl[i].acc0[2] + inv3*dt*ptcl[i].acc1[2]));
-
-                pred[i].vel[0] = ptcl[i].vel[0] + dt*(ptcl[i].acc0[0] + 0.5*dt*ptcl[i].acc1[0]);
-                pred[i].vel[1] = ptcl[i].vel[1] + dt*(ptcl[i].acc0[1] + 0.5*dt*ptcl[i].acc1[1]);
-                pred[i].vel[2] = ptcl[i].vel[2] + dt*(ptcl[i].acc0[2] + 0.5*dt*ptcl[i].acc1[2]);
-
-                pred[i].mass = ptcl[i].mass;
+                const Float dt = _time_pred - ptcl[i].time;
+                if (stale_only && dt==0.0) {
+                    for (int j=0; j<3; j++) {
+                        pred[i].pos[j] = ptcl[i].pos[j];
+                        pred[i].vel[j] = ptcl[i].vel[j];
+                    }
+                    pred[i].mass = ptcl[i].mass;
+                    continue;
+                }
+                tile.add(i, ptcl[i], dt);
+                if (tile.isFull()) tile.predictAndScatter(pred);
             }
-            // group
-            const int n_group = index_dt_sorted_group_.getSize();
-            ASSERT(n_group <= groups.getSize());
+            tile.predictAndScatter(pred);
+        }
+
+        //! predict group c.m. in a range of index_dt_sorted_group_ to the time
+        /*! Same as predictSingleRange, the c.m. are stored in pred_ after singles with offset index_offset_group_
+          @param[in] _time_pred: time for prediction
+          @param[in] _k_start: starting index in index_dt_sorted_group_
+          @param[in] _k_end: ending index (not included) in index_dt_sorted_group_
+         */
+        void predictGroupRange(const Float _time_pred, const int _k_start, const int _k_end) {
+            ASSERT(_k_end <= index_dt_sorted_group_.getSize());
+            ASSERT(_k_end <= groups.getSize());
+            const bool stale_only = manager->predict_stale_only;
+            auto* pred = pred_.getDataAddress();
             auto* group_ptr = groups.getDataAddress();
-            for (int k=0; k<n_group; k++) {
+            PredictorTileSoA tile;
+            for (int k=_k_start; k<_k_end; k++) {
                 const int i = index_dt_sorted_group_[k];
                 ASSERT(i<groups.getSize());
                 ASSERT(i>=0);
@@ -442,16 +611,59 @@ namespace H4{
                 const Float dt = _time_pred - pcm.time;
                 ASSERT(dt>=0.0);
                 // group predictor is after single predictor with offset n_single
-                auto& predcm = pred[i+index_offset_group_];
-                predcm.pos[0] = pcm.pos[0] + dt*(pcm.vel[0]  + 0.5*dt*(pcm.acc0[0] + inv3*dt*pcm.acc1[0]));
-                predcm.pos[1] = pcm.pos[1] + dt*(pcm.vel[1]  + 0.5*dt*(pcm.acc0[1] + inv3*dt*pcm.acc1[1]));
-                predcm.pos[2] = pcm.pos[2] + dt*(pcm.vel[2]  + 0.5*dt*(pcm.acc0[2] + inv3*dt*pcm.acc1[2]));
+                const int kp = i+index_offset_group_;
+                if (stale_only && dt==0.0) {
+                    for (int j=0; j<3; j++) {
+                        pred[kp].pos[j] = pcm.pos[j];
+                        pred[kp].vel[j] = pcm.vel[j];
+                    }
+                    pred[kp].mass = pcm.mass;
+                    continue;
+                }
+                tile.add(kp, pcm, dt);
+                if (tile.isFull()) tile.predictAndScatter(pred);
+            }
+            tile.predictAndScatter(pred);
+        }
+
+        //! predict the part of singles and group c.m. of one task
+        /*! The lists index_dt_sorted_single_ and index_dt_sorted_group_ are divided into n_task_ continuous parts
+          @param[in] _time_pred: time for prediction
+          @param[in] _t: task index
+         */
+        void predictTask(const Float _time_pred, const int _t) {
+            const int n_single = index_dt_sorted_single_.getSize();
+            const int n_group = index_dt_sorted_group_.getSize();
+            predictSingleRange(_time_pred, n_single*_t/n_task_, n_single*(_t+1)/n_task_);
+            predictGroupRange(_time_pred, n_group*_t/n_task_, n_group*(_t+1)/n_task_);
+        }
 
-                predcm.vel[0] = pcm.vel[0] + dt*(pcm.acc0[0] + 0.5*dt*pcm.acc1[0]);
-                predcm.vel[1] = pcm.vel[1] + dt*(pcm.acc0[1] + 0.5*dt*pcm.acc1[1]);
-                predcm.vel[2] = pcm.vel[2] + dt*(pcm.acc0[2] + 0.5*dt*pcm.acc1[2]);
+        //! build the task graph of prediction
+        /*! One task per worker, the time is given by predict_time_ at run time
+         */
+        void buildPredictTaskflow() {
+            predict_taskflow_.clear();
+            for (int t=0; t<n_task_; t++) {
+                predict_taskflow_.emplace([this, t](){
+                    predictTask(predict_time_, t);
+                });
+            }
+        }
 
-                predcm.mass = pcm.mass;
+        //! predict particles to the time
+        /*! With more than one worker and enough particles, the prediction is done in parallel by predict_taskflow_
+          @param[in] _time_pred: time for prediction
+         */
+        void predictAll(const Float _time_pred) {
+            const int n_pred = index_dt_sorted_single_.getSize() + index_dt_sorted_group_.getSize();
+            if (n_task_>1 && n_pred>=n_predict_parallel_min_) {
+                predict_time_ = _time_pred;
+                if (predict_taskflow_.empty()) buildPredictTaskflow();
+                TF::Manager::get_executor().run(predict_taskflow_).wait();
+            }
+            else {
+                predictSingleRange(_time_pred, 0, index_dt_sorted_single_.getSize());
+                predictGroupRange(_time_pred, 0, index_dt_sorted_group_.getSize());
             }
         }
 
@@ -526,7 +738,8 @@ namespace H4{
         }
 
         //! correct particle and calculate step 
-        /*! Correct particle and calculate next time step
+        /*! Correct particle and calculate next time step.
+          With HERMITE_SIMD, the particles are gathered to SoA tiles (CorrectorTileSoA), corrected and their steps are calculated with SIMD instructions, the results are the same as correctAndCalcDt4thOne.
           @param[in] _index_single: active particle index for singles
           @param[in] _n_single: number of active singles
           @param[in] _index_group: active particle index for groups
@@ -541,12 +754,20 @@ namespace H4{
             ASSERT(_n_single<=index_dt_sorted_single_.getSize());
             ASSERT(_n_group<=index_dt_sorted_group_.getSize());
 
+#ifdef HERMITE_SIMD
+            CorrectorTileSoA<H4Ptcl, ForceH4> tile;
+#endif
             // single
             auto* ptcl = particles.getDataAddress();
             ForceH4* force = force_.getDataAddress();
             for(int i=0; i<_n_single; i++){
                 const int k = _index_single[i];
+#ifdef HERMITE_SIMD
+                tile.add(ptcl[k], force[k], _dt_limit, neighbors[k].initial_step_flag);
+                if (tile.isFull()) tile.correctAndScatter(step);
+#else
                 correctAndCalcDt4thOne(ptcl[k], force[k], _dt_limit, neighbors[k].initial_step_flag);
+#endif
                 neighbors[k].initial_step_flag = false;
             }
             // group
@@ -554,10 +775,18 @@ namespace H4{
             for(int i=0; i<_n_group; i++) {
                 const int k = _index_group[i];
                 auto& groupi = group_ptr[k];
+#ifdef HERMITE_SIMD
+                tile.add(groupi.particles.cm, force[k+index_offset_group_], std::min(_dt_limit, groupi.info.dt_limit), groupi.perturber.initial_step_flag);
+                if (tile.isFull()) tile.correctAndScatter(step);
+#else
                 correctAndCalcDt4thOne(groupi.particles.cm, force[k+index_offset_group_], std::min(_dt_limit, groupi.info.dt_limit), groupi.perturber.initial_step_flag);
+#endif
                 groupi.perturber.initial_step_flag = false;
                 //groupi.correctCenterOfMassDrift();
             }
+#ifdef HERMITE_SIMD
+            tile.correctAndScatter(step);
+#endif
         }
 
         //! check whether group need to resolve
@@ -699,27 +928,45 @@ namespace H4{
             }
         }
 
-        //! calculate one particle interaction from all singles and groups
-        /*! Neighbor information is also updated
-          @param[out] _fi: acc and jerk of particle i
-          @param[out] _nbi: neighbor information of i
+        //! calculate one particle interaction from singles in the range [_j_start, _j_end) of index_dt_sorted_single_
+        /*! Neighbor information is also updated. Force and neighbor are not cleared.
+          With HERMITE_SIMD, the force is calculated by the interaction class function calcAccJerkPotSoA with the SoA j particle buffer, instead of calcAccJerkPairSingleSingle.
+          @param[in,out] _fi: acc and jerk of particle i
+          @param[in,out] _nbi: neighbor information of i
           @param[in] _pi: i particle
           @param[in] _pid: i particle id
+          @param[in] _j_start: start index in index_dt_sorted_single_ (should be a multiple of JParticleSoA::simd_width if HERMITE_SIMD is used)
+          @param[in] _j_end: end index in index_dt_sorted_single_ (not included)
         */
         template <class Tpi>
-        inline void calcOneSingleAccJerkNB(ForceH4 &_fi, 
-                                           Neighbor<Tparticle> &_nbi,
-                                           const Tpi &_pi,
-                                           const int _pid) {
-            // clear force
-            _fi.clear();
-            _nbi.resetNeighbor();
-
-            // single list
+        inline void calcOneSingleAccJerkNBFromSingles(ForceH4 &_fi, 
+                                                      Neighbor<Tparticle> &_nbi,
+                                                      const Tpi &_pi,
+                                                      const int _pid,
+                                                      const int _j_start,
+                                                      const int _j_end) {
             const int* single_list = index_dt_sorted_single_.getDataAddress();
-            const int n_single = index_dt_sorted_single_.getSize();
+            ASSERT(_j_end<=index_dt_sorted_single_.getSize());
+#ifdef HERMITE_SIMD
+            ASSERT(pred_single_soa_.n==index_dt_sorted_single_.getSize());
+            // extend the last range to the padded size
+            const int j_end_pad = (_j_end==pred_single_soa_.n) ? pred_single_soa_.getSizePadded() : _j_end;
+            COMM::ScratchScope scratch;
+            Float* r2_single = scratch.allocate<Float>(j_end_pad-_j_start);
+            const Float pos_i[3] = {_pi.pos[0], _pi.pos[1], _pi.pos[2]};
+            const Float vel_i[3] = {_pi.vel[0], _pi.vel[1], _pi.vel[2]};
+            manager->interaction.calcAccJerkPotSoA(_fi, r2_single, pred_single_soa_, pos_i, vel_i, Float(_pid), _j_start, j_end_pad);
+            // neighbor search in the same order as the scalar loop
+            for (int i=_j_start; i<_j_end; i++) {
+                const Float r2 = r2_single[i-_j_start];
+                if (r2<0.0) continue;
+                const int j = single_list[i];
+                ASSERT(r2>0.0);
+                _nbi.checkAndAddNeighborSingle(r2, particles[j], neighbors[j], j);
+            }
+#else
             auto* ptcl = pred_.getDataAddress();
-            for (int i=0; i<n_single; i++) {
+            for (int i=_j_start; i<_j_end; i++) {
                 const int j = single_list[i];
                 ASSERT(j<pred_.getSize());
                 const auto& pj = ptcl[j];
@@ -729,7 +976,22 @@ namespace H4{
                 ASSERT(r2>0.0);
                 _nbi.checkAndAddNeighborSingle(r2, particles[j], neighbors[j], j);
             }
+#endif
+        }
 
+        //! calculate one particle interaction from all groups and perturber
+        /*! Neighbor information is also updated. Force and neighbor are not cleared
+          @param[in,out] _fi: acc and jerk of particle i
+          @param[in,out] _nbi: neighbor information of i
+          @param[in] _pi: i particle
+          @param[in] _pid: i particle id
+        */
+        template <class Tpi>
+        inline void calcOneSingleAccJerkNBFromGroups(ForceH4 &_fi, 
+                                                     Neighbor<Tparticle> &_nbi,
+                                                     const Tpi &_pi,
+                                                     const int _pid) {
+            auto* ptcl = pred_.getDataAddress();
             auto* group_ptr = groups.getDataAddress();
 
             // resolved group list
@@ -761,6 +1023,266 @@ namespace H4{
             }
             ASSERT(_nbi.n_neighbor_group + _nbi.n_neighbor_single == _nbi.neighbor_address.getSize());
 
+#ifdef HERMITE_PERT_FORCE
+            // perturber
+            manager->interaction.calcAccJerkPerturber(_fi, _pi, particles.cm, perturber);
+#endif
+        }
+
+        //! calculate one particle interaction from all singles, groups and perturber using the octree
+        /*! The far nodes are calculated as monopoles, the objects in opened leaves are calculated with the exact pair interactions, see Octree::calcAccJerkFarAndNear. 
+          Neighbor information is also updated, but the nearest and minimum mass neighbors are only searched in the opened leaves. Force and neighbor are not cleared
+          @param[in,out] _fi: acc and jerk of particle i
+          @param[in,out] _nbi: neighbor information of i
+          @param[in] _pi: i particle
+          @param[in] _pid: i particle id
+        */
+        template <class Tpi>
+        inline void calcOneSingleAccJerkNBFromTree(ForceH4 &_fi, 
+                                                   Neighbor<Tparticle> &_nbi,
+                                                   const Tpi &_pi,
+                                                   const int _pid) {
+            auto* ptcl = pred_.getDataAddress();
+            auto* group_ptr = groups.getDataAddress();
+            auto near_func = [&](const int _j) {
+                if (_j<index_offset_group_) {
+                    const auto& pj = ptcl[_j];
+                    if (_pid==pj.id) return;
+                    if (pj.mass==0) return;
+                    Float r2 = manager->interaction.calcAccJerkPairSingleSingle(_fi, _pi, pj);
+                    ASSERT(r2>0.0);
+                    _nbi.checkAndAddNeighborSingle(r2, particles[_j], neighbors[_j], _j);
+                }
+                else {
+                    auto& groupj = group_ptr[_j-index_offset_group_];
+                    if (_pid==groupj.particles.cm.id) return;
+                    if (groupj.particles.cm.mass==0) return;
+                    Float r2;
+                    if (groupj.perturber.need_resolve_flag) r2 = manager->interaction.calcAccJerkPairSingleGroupMember(_fi, _pi, groupj);
+                    else r2 = manager->interaction.calcAccJerkPairSingleGroupCM(_fi, _pi, groupj, ptcl[_j]);
+                    ASSERT(r2>0.0);
+                    _nbi.checkAndAddNeighborGroup(r2, groupj, _j);
+                }
+            };
+            // far nodes as monopole singles
+            auto far_func = [&](const OctreeNode& _node) {
+                manager->interaction.calcAccJerkPairSingleSingle(_fi, _pi, _node);
+            };
+            const Float theta = manager->tree_theta;
+            tree_.calcAccJerkFarAndNear(_pi, _nbi.r_neighbor_crit_sq, theta*theta, far_func, near_func);
+            ASSERT(_nbi.n_neighbor_group + _nbi.n_neighbor_single == _nbi.neighbor_address.getSize());
+
+#ifdef HERMITE_PERT_FORCE
+            // perturber
+            manager->interaction.calcAccJerkPerturber(_fi, _pi, particles.cm, perturber);
+#endif
+        }
+
+        //! calculate one particle interaction from all singles and groups
+        /*! Neighbor information is also updated
+          @param[out] _fi: acc and jerk of particle i
+          @param[out] _nbi: neighbor information of i
+          @param[in] _pi: i particle
+          @param[in] _pid: i particle id
+        */
+        template <class Tpi>
+        inline void calcOneSingleAccJerkNB(ForceH4 &_fi, 
+                                           Neighbor<Tparticle> &_nbi,
+                                           const Tpi &_pi,
+                                           const int _pid) {
+            // clear force
+            _fi.clear();
+            _nbi.resetNeighbor();
+
+            if (manager->tree_theta>0.0) {
+                calcOneSingleAccJerkNBFromTree(_fi, _nbi, _pi, _pid);
+                return;
+            }
+
+            calcOneSingleAccJerkNBFromSingles(_fi, _nbi, _pi, _pid, 0, index_dt_sorted_single_.getSize());
+            calcOneSingleAccJerkNBFromGroups(_fi, _nbi, _pi, _pid);
+        }
+
+        //! calculate one particle interaction from the existing neighbor list (irregular force in Ahmad-Cohen scheme)
+        /*! The neighbor list is not rebuilt, only the nearest and minimum mass neighbor information is updated if _update_nearest_flag is true
+          @param[out] _fi: irregular acc and jerk of particle i
+          @param[in,out] _nbi: neighbor information of i
+          @param[in] _pi: i particle
+          @param[in] _update_nearest_flag: update the nearest and minimum mass neighbor information, should be false after the full force calculation of a regular step to keep the information from all particles
+        */
+        template <class Tpi>
+        inline void calcOneSingleAccJerkIrregular(ForceH4 &_fi, 
+                                                  Neighbor<Tparticle> &_nbi,
+                                                  const Tpi &_pi,
+                                                  const bool _update_nearest_flag=true) {
+            _fi.clear();
+            if (_update_nearest_flag) _nbi.resetNearest();
+            auto* ptcl = pred_.getDataAddress();
+            auto* group_ptr = groups.getDataAddress();
+            const int n_nb = _nbi.neighbor_address.getSize();
+            for (int i=0; i<n_nb; i++) {
+                const int j = _nbi.neighbor_address[i].index;
+                if (j<index_offset_group_) {
+                    const auto& pj = ptcl[j];
+                    if (pj.mass==0) continue;
+                    Float r2 = manager->interaction.calcAccJerkPairSingleSingle(_fi, _pi, pj);
+                    ASSERT(r2>0.0);
+                    if (_update_nearest_flag) _nbi.updateNearest(r2, particles[j].mass, j, neighbors[j].initial_step_flag);
+                }
+                else {
+                    auto& groupj = group_ptr[j-index_offset_group_];
+                    if (groupj.particles.cm.mass==0) continue;
+                    Float r2;
+                    if (groupj.perturber.need_resolve_flag) r2 = manager->interaction.calcAccJerkPairSingleGroupMember(_fi, _pi, groupj);
+                    else r2 = manager->interaction.calcAccJerkPairSingleGroupCM(_fi, _pi, groupj, ptcl[j]);
+                    ASSERT(r2>0.0);
+                    if (_update_nearest_flag) _nbi.updateNearest(r2, groupj.particles.cm.mass, j, groupj.perturber.initial_step_flag);
+                }
+            }
+        }
+
+        //! check whether the step of a single is a regular step in Ahmad-Cohen scheme
+        /*! The step reaching time_reg_next_ is regular. Without Ahmad-Cohen scheme, all steps are regular.
+          @param[in] _i: single index
+         */
+        inline bool isRegularStep(const int _i) const {
+            if (manager->ac_step_ratio<=1) return true;
+            return particles[_i].time + particles[_i].dt >= time_reg_next_[_i];
+        }
+
+        //! calculate acc and jerk of one single in an irregular step
+        /*! The irregular force from neighbors is added to the regular force extrapolated from the last regular step, the potential of the regular part is not extrapolated
+          @param[in] _i: single index
+         */
+        inline void calcOneSingleAccJerkACIrregular(const int _i) {
+            auto& pi = pred_[_i];
+            auto& fi = force_[_i];
+            calcOneSingleAccJerkIrregular(fi, neighbors[_i], pi);
+            const auto& freg = force_reg_[_i];
+            const Float dt = particles[_i].time + particles[_i].dt - time_reg_[_i];
+            fi.acc0[0] += freg.acc0[0] + dt*freg.acc1[0];
+            fi.acc0[1] += freg.acc0[1] + dt*freg.acc1[1];
+            fi.acc0[2] += freg.acc0[2] + dt*freg.acc1[2];
+            fi.acc1[0] += freg.acc1[0];
+            fi.acc1[1] += freg.acc1[1];
+            fi.acc1[2] += freg.acc1[2];
+            fi.pot += freg.pot;
+        }
+
+        //! save regular force of one single after the full force calculation in Ahmad-Cohen scheme
+        /*! The irregular force from the new neighbor list is subtracted from the full force, the nearest neighbor information from the full force calculation is kept. The next regular step is after ac_step_ratio times of the current step.
+          @param[in] _i: single index
+         */
+        inline void saveRegularForce(const int _i) {
+            ForceH4 firr;
+            calcOneSingleAccJerkIrregular(firr, neighbors[_i], pred_[_i], false);
+            const auto& fi = force_[_i];
+            auto& freg = force_reg_[_i];
+            for (int k=0; k<3; k++) {
+                freg.acc0[k] = fi.acc0[k] - firr.acc0[k];
+                freg.acc1[k] = fi.acc1[k] - firr.acc1[k];
+            }
+            freg.pot = fi.pot - firr.pot;
+            time_reg_[_i] = particles[_i].time + particles[_i].dt;
+            time_reg_next_[_i] = time_reg_[_i] + manager->ac_step_ratio*particles[_i].dt;
+        }
+
+        //! calculate a tile of active singles interaction from all singles and groups
+        /*! The singles are divided into j tiles with the size of #n_tile_j_. For each j tile, all i particles in the tile are calculated before moving to the next j tile, so that the j particles stay in cache. 
+          The summation order of each i particle is the same as calcOneSingleAccJerkNB.
+          In Ahmad-Cohen scheme, the singles in irregular steps only calculate the force from neighbors, see calcOneSingleAccJerkACIrregular.
+          With the octree (manager->tree_theta>0), each i particle walks the tree instead, see calcOneSingleAccJerkNBFromTree.
+          @param[in] _index_single: active single index list of the tile
+          @param[in] _n_i: number of i particles in the tile
+        */
+        inline void calcSingleTileAccJerkNB(const int* _index_single, const int _n_i) {
+            auto* pred_ptr = pred_.getDataAddress();
+            auto* force_ptr = force_.getDataAddress();
+            auto* neighbor_ptr = neighbors.getDataAddress();
+            const bool ac_flag = manager->ac_step_ratio>1;
+            COMM::ScratchScope scratch;
+            int* index_reg = scratch.allocate<int>(_n_i);
+            int n_reg = 0;
+            for (int k=0; k<_n_i; k++) {
+                const int i = _index_single[k];
+                if (ac_flag && !isRegularStep(i)) {
+                    calcOneSingleAccJerkACIrregular(i);
+                    continue;
+                }
+                index_reg[n_reg++] = i;
+                force_ptr[i].clear();
+                neighbor_ptr[i].resetNeighbor();
+            }
+
+            if (manager->tree_theta>0.0) {
+                for (int k=0; k<n_reg; k++) {
+                    const int i = index_reg[k];
+                    auto& pi = pred_ptr[i];
+                    calcOneSingleAccJerkNBFromTree(force_ptr[i], neighbor_ptr[i], pi, pi.id);
+                    if (ac_flag) saveRegularForce(i);
+                }
+                return;
+            }
+
+            const int n_single = index_dt_sorted_single_.getSize();
+            for (int j_start=0; j_start<n_single; j_start+=n_tile_j_) {
+                const int j_end = std::min(j_start+n_tile_j_, n_single);
+                for (int k=0; k<n_reg; k++) {
+                    const int i = index_reg[k];
+                    auto& pi = pred_ptr[i];
+                    calcOneSingleAccJerkNBFromSingles(force_ptr[i], neighbor_ptr[i], pi, pi.id, j_start, j_end);
+                }
+            }
+
+            for (int k=0; k<n_reg; k++) {
+                const int i = index_reg[k];
+                auto& pi = pred_ptr[i];
+                calcOneSingleAccJerkNBFromGroups(force_ptr[i], neighbor_ptr[i], pi, pi.id);
+                if (ac_flag) saveRegularForce(i);
+            }
+        }
+
+        //! calculate one cm group interaction from all singles, groups and perturber using the octree
+        /*! Same as calcOneSingleAccJerkNBFromTree but with the pair interactions of group c.m.. Force and neighbor are not cleared
+          @param[in,out] _fi: acc and jerk of particle i
+          @param[in,out] _groupi: group i 
+          @param[in] _pi: predicted group i cm 
+        */
+        template <class Tpi, class Tgroupi>
+        inline void calcOneGroupCMAccJerkNBFromTree(ForceH4 &_fi, 
+                                                    Tgroupi &_groupi, 
+                                                    const Tpi &_pi) {
+            auto& nbi = _groupi.perturber;
+            auto* ptcl = pred_.getDataAddress();
+            auto* group_ptr = groups.getDataAddress();
+            auto near_func = [&](const int _j) {
+                if (_j<index_offset_group_) {
+                    const auto& pj = ptcl[_j];
+                    if (_pi.id==pj.id) return;
+                    if (pj.mass==0.0) return;
+                    Float r2 = manager->interaction.calcAccJerkPairGroupCMSingle(_fi, _groupi, _pi, pj);
+                    ASSERT(r2>0.0);
+                    nbi.checkAndAddNeighborSingle(r2, particles[_j], neighbors[_j], _j);
+                }
+                else {
+                    auto& groupj = group_ptr[_j-index_offset_group_];
+                    if (_pi.id==groupj.particles.cm.id) return;
+                    if (groupj.particles.cm.mass==0.0) return;
+                    Float r2;
+                    if (groupj.perturber.need_resolve_flag) r2 = manager->interaction.calcAccJerkPairGroupCMGroupMember(_fi, _groupi, _pi, groupj);
+                    else r2 = manager->interaction.calcAccJerkPairGroupCMGroupCM(_fi, _groupi, _pi, groupj, ptcl[_j]);
+                    ASSERT(r2>0.0);
+                    nbi.checkAndAddNeighborGroup(r2, groupj, _j);
+                }
+            };
+            // far nodes as monopole singles
+            auto far_func = [&](const OctreeNode& _node) {
+                manager->interaction.calcAccJerkPairGroupCMSingle(_fi, _groupi, _pi, _node);
+            };
+            const Float theta = manager->tree_theta;
+            tree_.calcAccJerkFarAndNear(_pi, nbi.r_neighbor_crit_sq, theta*theta, far_func, near_func);
+            ASSERT(nbi.n_neighbor_group + nbi.n_neighbor_single == nbi.neighbor_address.getSize());
+
 #ifdef HERMITE_PERT_FORCE
             // perturber
             manager->interaction.calcAccJerkPerturber(_fi, _pi, particles.cm, perturber);
@@ -782,6 +1304,11 @@ namespace H4{
             auto& nbi = _groupi.perturber;
             nbi.resetNeighbor();
 
+            if (manager->tree_theta>0.0) {
+                calcOneGroupCMAccJerkNBFromTree(_fi, _groupi, _pi);
+                return;
+            }
+
             // single list
             const int* single_list = index_dt_sorted_single_.getDataAddress();
             const int n_single = index_dt_sorted_single_.getSize();
@@ -944,8 +1471,181 @@ namespace H4{
 
         }
         
+        //! calculate acc and jerk of one work item in the force stage
+        /*! Work items [0, force_n_tile_) are tiles of active singles, the rest are active groups in force_index_group_
+          @param[in] _k: work item index
+        */
+        inline void calcForceWorkItem(const int _k) {
+            if (_k<force_n_tile_) {
+                const int k_start = _k*force_n_tile_i_;
+                calcSingleTileAccJerkNB(force_index_single_+k_start, std::min(force_n_tile_i_, force_n_single_-k_start));
+            }
+            else {
+                const int i = force_index_group_[_k-force_n_tile_];
+                auto& groupi = groups[i];
+                // use predictor of cm
+                auto& pi = pred_[i+index_offset_group_];
+                auto& fi = force_[i+index_offset_group_];
+                if (groupi.particles.cm.mass>0) {
+                    if (groupi.perturber.need_resolve_flag) calcOneGroupMemberAccJerkNB(fi, groupi, pi);
+                    else calcOneGroupCMAccJerkNB(fi, groupi, pi);
+                }
+                else calcOneSingleAccJerkNB(fi, groupi.perturber, pi, pi.id);
+            }
+        }
+
+        //! build the task graph of the force stage
+        /*! One task per worker, each task calculates a continuous range of work items given by force_task_offset_. 
+          The graph is built once and reused, only the ranges are updated in each call of calcAccJerkNBList.
+        */
+        void buildForceTaskflow() {
+            force_taskflow_.clear();
+            for (int t=0; t<n_task_; t++) {
+                force_taskflow_.emplace([this, t](){
+                    calcForceWorkItemTask(t);
+                });
+            }
+        }
+
+        //! calculate the work items of one task in the force stage
+        /*! @param[in] _t: task index
+         */
+        inline void calcForceWorkItemTask(const int _t) {
+            const int k_end = force_task_offset_[_t+1];
+            for (int k=force_task_offset_[_t]; k<k_end; k++) calcForceWorkItem(k);
+        }
+
+        //! set one octree object from the predictor
+        /*! @param[out] _obj: octree object
+          @param[in] _j: index in pred_ (single if <index_offset_group_, otherwise group)
+         */
+        inline void setTreeObject(OctreeObject& _obj, const int _j) {
+            const auto& pj = pred_[_j];
+            for (int k=0; k<3; k++) {
+                _obj.pos[k] = pj.pos[k];
+                _obj.vel[k] = pj.vel[k];
+            }
+            _obj.index = _j;
+            _obj.radius = 0.0;
+            if (_j<index_offset_group_) {
+                _obj.mass = pj.mass;
+                _obj.r_crit_sq = neighbors[_j].r_neighbor_crit_sq;
+            }
+            else {
+                auto& groupj = groups[_j-index_offset_group_];
+                _obj.mass = groupj.particles.cm.mass;
+                _obj.r_crit_sq = groupj.perturber.r_neighbor_crit_sq;
+                // resolved members are used in the exact pair interactions 
+                if (groupj.perturber.need_resolve_flag) {
+                    Float r2_max = 0.0;
+                    const int n_member = groupj.particles.getSize();
+                    auto* member_adr = groupj.particles.getOriginAddressArray();
+                    for (int k=0; k<n_member; k++) {
+                        const auto& pk = *member_adr[k];
+                        const Float dr[3] = {pk.pos[0]-pj.pos[0], pk.pos[1]-pj.pos[1], pk.pos[2]-pj.pos[2]};
+                        r2_max = std::max(r2_max, dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2]);
+                    }
+                    _obj.radius = sqrt(r2_max);
+                }
+            }
+        }
+
+        //! build or refit the octree from pred_ 
+        /*! The tree is rebuilt if the singles or groups in the system are changed or after #n_tree_refit_max_ refits, otherwise the tree structure is kept and only the moments are updated. 
+         */
+        void updateTree() {
+            const int n_single = index_dt_sorted_single_.getSize();
+            const int n_group = index_dt_sorted_group_.getSize();
+            const int n_obj = n_single + n_group;
+
+            bool rebuild_flag = tree_.getSize()!=n_obj || tree_n_refit_>=n_tree_refit_max_;
+            if (!rebuild_flag) {
+                // check whether the object list is the same
+                const int n_pred = pred_.getSize();
+                COMM::ScratchScope scratch;
+                bool* obj_mask = scratch.allocate<bool>(n_pred);
+                for (int k=0; k<n_pred; k++) obj_mask[k] = false;
+                for (int k=0; k<n_single; k++) obj_mask[index_dt_sorted_single_[k]] = true;
+                for (int k=0; k<n_group; k++) obj_mask[index_dt_sorted_group_[k]+index_offset_group_] = true;
+                for (int k=0; k<n_obj; k++) {
+                    const int j = tree_.objects[k].index;
+                    if (j>=n_pred || !obj_mask[j]) {
+                        rebuild_flag = true;
+                        break;
+                    }
+                }
+            }
+
+            if (rebuild_flag) {
+                tree_.objects.resize(n_obj);
+                for (int k=0; k<n_single; k++) setTreeObject(tree_.objects[k], index_dt_sorted_single_[k]);
+                for (int k=0; k<n_group; k++) setTreeObject(tree_.objects[n_single+k], index_dt_sorted_group_[k]+index_offset_group_);
+                tree_.build();
+                tree_n_refit_ = 0;
+            }
+            else {
+                for (int k=0; k<n_obj; k++) setTreeObject(tree_.objects[k], tree_.objects[k].index);
+                tree_.refit();
+                tree_n_refit_++;
+            }
+        }
+
+        //! prepare work items of the force stage
+        /*! The active singles (in tiles, see calcSingleTileAccJerkNB) and groups are the work items. 
+          Each tile is weighted by its number of i particles, each resolved group by its number of members and each c.m. group by one. 
+          The octree (manager->tree_theta>0) or the SIMD j particle buffer is also updated here.
+          The work items are split into n_task_ continuous ranges with similar weights, saved in force_task_offset_.
+          @param[in] _index_single: active particle index for singles
+          @param[in] _n_single: number of active singles
+          @param[in] _index_group: active particle index for groups
+          @param[in] _n_group: number of active groups
+          \return total weight of work items
+        */
+        int prepareForceWorkList(const int* _index_single,
+                                 const int  _n_single,
+                                 const int* _index_group,
+                                 const int  _n_group) {
+            if (manager->tree_theta>0.0) updateTree();
+#ifdef HERMITE_SIMD
+            // pack predicted singles once for all i particles
+            else pred_single_soa_.fill(pred_.getDataAddress(), index_dt_sorted_single_.getDataAddress(), index_dt_sorted_single_.getSize());
+#endif
+            // singles are calculated in tiles of i particles sharing the j sweep
+            force_index_single_ = _index_single;
+            force_n_single_ = _n_single;
+            force_n_tile_i_ = std::max(1, std::min(int(n_tile_i_), _n_single/n_task_));
+            force_n_tile_ = (_n_single + force_n_tile_i_ - 1)/force_n_tile_i_;
+            force_index_group_ = _index_group;
+            const int n_item = force_n_tile_ + _n_group;
+
+            // weight of work items
+            COMM::ScratchScope scratch;
+            int* weight = scratch.allocate<int>(n_item+1);
+            weight[0] = 0;
+            for (int k=0; k<force_n_tile_; k++) 
+                weight[k+1] = weight[k] + std::min(force_n_tile_i_, _n_single-k*force_n_tile_i_);
+            for (int k=0; k<_n_group; k++) {
+                auto& groupk = groups[_index_group[k]];
+                const int w = (groupk.particles.cm.mass>0 && groupk.perturber.need_resolve_flag) ? groupk.particles.getSize() : 1;
+                weight[force_n_tile_+k+1] = weight[force_n_tile_+k] + w;
+            }
+            const int weight_tot = weight[n_item];
+
+            // split work items to continuous ranges with similar weights
+            int k = 0;
+            force_task_offset_[0] = 0;
+            for (int t=1; t<n_task_; t++) {
+                const long long int weight_cut = (long long int)weight_tot*t/n_task_;
+                while (k<n_item && weight[k+1]<=weight_cut) k++;
+                force_task_offset_[t] = k;
+            }
+            force_task_offset_[n_task_] = n_item;
+
+            return weight_tot;
+        }
+
         //! Calculate acc and jerk for lists of particles from all particles and update neighbor lists
-        /*! 
+        /*! The active singles and groups are calculated in one parallel stage (force_taskflow_), see prepareForceWorkList
           @param[in] _index_single: active particle index for singles
           @param[in] _n_single: number of active singles
           @param[in] _index_group: active particle index for groups
@@ -955,64 +1655,13 @@ namespace H4{
                                       const int  _n_single,
                                       const int* _index_group,
                                       const int  _n_group) {
+            const int weight_tot = prepareForceWorkList(_index_single, _n_single, _index_group, _n_group);
 
-            // predictor 
-            //auto* ptcl = particles.getDataAddress();
-            auto* pred_ptr = pred_.getDataAddress();
-            auto* force_ptr = force_.getDataAddress();
-            auto* neighbor_ptr = neighbors.getDataAddress();
-            auto& tf = TF::Manager::get_taskflow();
-            auto& exec = TF::Manager::get_executor();
-            if (_n_single > 10) {
-                // std::cerr << "use tf in calculate force for singles, _n_single = " << _n_single << std::endl;
-                tf.clear();
-                tf.for_each_index(0, _n_single, 1, [&_index_single, &pred_ptr, &force_ptr, &neighbor_ptr, this](int k){
-                    const int i = _index_single[k];
-                    auto& pi = pred_ptr[i];
-                    auto& fi = force_ptr[i];
-                    auto& nbi = neighbor_ptr[i];
-                    calcOneSingleAccJerkNB(fi, nbi, pi, pi.id);
-                });
-                exec.run(tf).wait();
+            if (weight_tot > 10 && n_task_>1) {
+                if (force_taskflow_.empty()) buildForceTaskflow();
+                TF::Manager::get_executor().run(force_taskflow_).wait();
             } else {
-                for (int k=0; k<_n_single; k++) {
-                    const int i = _index_single[k];
-                    auto& pi = pred_ptr[i];
-                    auto& fi = force_ptr[i];
-                    auto& nbi = neighbor_ptr[i];
-                    calcOneSingleAccJerkNB(fi, nbi, pi, pi.id);
-                }
-            }
-
-            // for group active particles
-            auto* group_ptr = groups.getDataAddress();
-            if (_n_group > 10) {
-                tf.clear();
-                tf.for_each_index(0, _n_group, 1, [&_index_group, &group_ptr, &pred_ptr, &force_ptr, this](int k){
-                    const int i = _index_group[k];
-                    auto& groupi = group_ptr[i];
-                    // use predictor of cm
-                    auto& pi = pred_ptr[i+index_offset_group_];
-                    auto& fi = force_ptr[i+index_offset_group_];
-                    if (groupi.particles.cm.mass>0) {
-                        if (groupi.perturber.need_resolve_flag) calcOneGroupMemberAccJerkNB(fi, groupi, pi);
-                        else calcOneGroupCMAccJerkNB(fi, groupi, pi);
-                    }
-                    else calcOneSingleAccJerkNB(fi, groupi.perturber, pi, pi.id);
-                });
-            } else {
-                for (int k=0; k<_n_group; k++) {
-                    const int i = _index_group[k];
-                    auto& groupi = group_ptr[i];
-                    // use predictor of cm
-                    auto& pi = pred_ptr[i+index_offset_group_];
-                    auto& fi = force_ptr[i+index_offset_group_];
-                    if (groupi.particles.cm.mass>0) {
-                        if (groupi.perturber.need_resolve_flag) calcOneGroupMemberAccJerkNB(fi, groupi, pi);
-                        else calcOneGroupCMAccJerkNB(fi, groupi, pi);
-                    }
-                    else calcOneSingleAccJerkNB(fi, groupi.perturber, pi, pi.id);
-                }
+                for (int t=0; t<n_task_; t++) calcForceWorkItemTask(t);
             }
         }
 
@@ -1074,6 +1723,85 @@ namespace H4{
             }
         }
             
+        //! correct and update time_next_ for the part of the current correction lists of one task
+        /*! The lists correct_index_single_ and correct_index_group_ are divided into n_task_ continuous parts. 
+          Each particle is only updated by one task, thus the results do not depend on the number of tasks.
+          @param[in] _t: task index
+         */
+        void correctStageTask(const int _t) {
+            const int i_single = correct_n_single_*_t/n_task_;
+            const int n_single = correct_n_single_*(_t+1)/n_task_ - i_single;
+            const int i_group = correct_n_group_*_t/n_task_;
+            const int n_group = correct_n_group_*(_t+1)/n_task_ - i_group;
+            if (correct_init_flag_) 
+                calcDt2ndList(correct_index_single_+i_single, n_single, correct_index_group_+i_group, n_group, correct_dt_limit_);
+            else
+                correctAndCalcDt4thList(correct_index_single_+i_single, n_single, correct_index_group_+i_group, n_group, correct_dt_limit_);
+            updateTimeNextList(correct_index_single_+i_single, n_single, correct_index_group_+i_group, n_group);
+        }
+
+        //! build the task graph of correction
+        /*! One task per worker, see correctStageTask
+         */
+        void buildCorrectTaskflow() {
+            correct_taskflow_.clear();
+            for (int t=0; t<n_task_; t++) {
+                correct_taskflow_.emplace([this, t](){
+                    correctStageTask(t);
+                });
+            }
+        }
+
+        //! set the lists of the correction stage
+        /*! @param[in] _index_single: single index list
+          @param[in] _n_single: number of singles
+          @param[in] _index_group: group index list
+          @param[in] _n_group: number of groups
+          @param[in] _dt_limit: time step limit
+          @param[in] _init_flag: true: only calculate 2nd order steps without correction
+         */
+        void setCorrectList(const int* _index_single,
+                            const int  _n_single,
+                            const int* _index_group,
+                            const int  _n_group,
+                            const Float _dt_limit,
+                            const bool _init_flag) {
+            correct_index_single_ = _index_single;
+            correct_n_single_ = _n_single;
+            correct_index_group_ = _index_group;
+            correct_n_group_ = _n_group;
+            correct_dt_limit_ = _dt_limit;
+            correct_init_flag_ = _init_flag;
+        }
+
+        //! correct particles (or calculate 2nd order steps) and update time_next_ for lists of particles
+        /*! With more than one worker and enough particles, the lists are processed in parallel by correct_taskflow_. 
+          The minimum next time (time_next_min_) is not reduced here, it is obtained from the sorted lists in sortDtAndSelectActParticle, thus it is deterministic.
+          @param[in] _index_single: single index list
+          @param[in] _n_single: number of singles
+          @param[in] _index_group: group index list
+          @param[in] _n_group: number of groups
+          @param[in] _dt_limit: time step limit
+          @param[in] _init_flag: true: only calculate 2nd order steps without correction (initial step)
+         */
+        void correctAndUpdateTimeNextList(const int* _index_single,
+                                          const int  _n_single,
+                                          const int* _index_group,
+                                          const int  _n_group,
+                                          const Float _dt_limit,
+                                          const bool _init_flag) {
+            if (n_task_>1 && _n_single+_n_group>=n_correct_parallel_min_) {
+                setCorrectList(_index_single, _n_single, _index_group, _n_group, _dt_limit, _init_flag);
+                if (correct_taskflow_.empty()) buildCorrectTaskflow();
+                TF::Manager::get_executor().run(correct_taskflow_).wait();
+            }
+            else {
+                if (_init_flag) calcDt2ndList(_index_single, _n_single, _index_group, _n_group, _dt_limit);
+                else correctAndCalcDt4thList(_index_single, _n_single, _index_group, _n_group, _dt_limit);
+                updateTimeNextList(_index_single, _n_single, _index_group, _n_group);
+            }
+        }
+
         //! calculate dr dv of a pair
         /*!
           @param[in] _p1: particle 1
@@ -1093,29 +1821,6 @@ namespace H4{
 
             return drdv;
         }
-
-        // for get sorted index of single
-        class SortIndexDtSingle{
-        private:
-            Float * time_;
-        public:
-            SortIndexDtSingle(Float* _time): time_(_time) {}
-            bool operator() (const int & left, const int & right) const {
-                return time_[left] < time_[right];
-            }
-        };
-
-        // for get sorted index of group
-        class SortIndexDtGroup{
-        private:
-            Float * time_;
-            int offset_;
-        public:
-            SortIndexDtGroup(Float * _time, int _offset): time_(_time), offset_(_offset) {}
-            bool operator() (const int & left, const int & right) const {
-                return time_[left+offset_] < time_[right+offset_];
-            }
-        };
         
         // ! remove index from bool table
         void removeDtIndexFromTable(COMM::List<int>& _index, int& _n_act, int& _n_init, COMM::List<bool>& _table) {
@@ -1210,6 +1915,9 @@ namespace H4{
             time_next_.increaseSizeNoInitialize(n_particle);
 
             // set number of lists
+            force_reg_.resizeNoInitialize(n_particle);
+            time_reg_.resizeNoInitialize(n_particle);
+            time_reg_next_.resizeNoInitialize(n_particle);
             neighbors.resizeNoInitialize(n_particle);
             index_dt_sorted_single_.resizeNoInitialize(n_particle);
             table_single_mask_.resizeNoInitialize(n_particle);
@@ -1218,6 +1926,7 @@ namespace H4{
                 // initial index_dt_sorted_single_ first to allow initialIntegration work
                 index_dt_sorted_single_[i] = i;
                 table_single_mask_[i] = false;
+                time_reg_next_[i] = -NUMERIC_FLOAT_MAX;
             }
             // set initial time
             time_ = _time_sys;
@@ -1247,7 +1956,8 @@ namespace H4{
             modify_system_flag_ = true;
 
             // gether the new index in groups first
-            int group_index[_n_group];
+            COMM::ScratchScope scratch;
+            int* group_index = scratch.allocate<int>(_n_group);
             for (int i=0; i<_n_group; i++) {
                 // check suppressed group
                 int igroup;
@@ -1284,9 +1994,7 @@ namespace H4{
                 group_new.particles.setMode(COMM::ListMode::copy);
                 group_new.particles.reserveMem(n_particle);
                 group_new.reserveIntegratorMem();
-                const int nmax_tot = particles.getSizeMax() + groups.getSizeMax();
-                group_new.perturber.neighbor_address.setMode(COMM::ListMode::local);
-                group_new.perturber.neighbor_address.reserveMem(nmax_tot);
+                group_new.perturber.reserveMem(NBAdrList<Tparticle>::n_reserve_default);
                 group_new.info.reserveMem(n_particle);
             
                 // Add members to AR 
@@ -1371,7 +2079,8 @@ namespace H4{
             int n_group;
             _fin>>n_group;
             ASSERT(!_fin.eof());
-            int n_group_offset[n_group+1];
+            COMM::ScratchScope scratch;
+            int* n_group_offset = scratch.allocate<int>(n_group+1);
 
             if (n_group>0) {
                 for (int i=0; i<=n_group; i++) {
@@ -1380,7 +2089,7 @@ namespace H4{
                 }
                 int n_members = n_group_offset[n_group];
                 ASSERT(n_members>1);
-                int particle_index[n_members];
+                int* particle_index = scratch.allocate<int>(n_members);
                 for (int i=0; i<n_members; i++) {
                     _fin>>particle_index[i];
                     ASSERT(!_fin.eof());
@@ -1415,7 +2124,8 @@ namespace H4{
             if (_n_break==0 && _n_break_no_add==0) return;
 
             modify_system_flag_=true;
-            int new_index_single[particles.getSize()];
+            COMM::ScratchScope scratch;
+            int* new_index_single = scratch.allocate<int>(particles.getSize());
             int n_single_new=0;
 
             for (int k=0; k<_n_break; k++) {
@@ -1427,7 +2137,8 @@ namespace H4{
 
                 auto& groupi = groups[i];
                 const int n_member =groupi.particles.getSize();
-                int particle_index_origin[n_member];
+                COMM::ScratchScope scratch_group;
+                int* particle_index_origin = scratch_group.allocate<int>(n_member);
                 int ibreak = groupi.info.getTwoBranchParticleIndexOriginFromBinaryTree(particle_index_origin, groupi.particles.getDataAddress());
 
 #ifdef ADJUST_GROUP_DEBUG
@@ -1438,6 +2149,7 @@ namespace H4{
                          <<" N_member: "<<std::setw(4)<<groupi.particles.getSize()
                          <<" step: "<<std::setw(12)<<groupi.profile.step_count_sum
                          <<" step(tsyn): "<<std::setw(10)<<groupi.profile.step_count_tsyn_sum
+                         <<" kepler: "<<std::setw(10)<<groupi.profile.kepler_count_sum
 //                         <<" step(sum): "<<std::setw(12)<<profile.ar_step_count
 //                         <<" step_tsyn(sum): "<<std::setw(12)<<profile.ar_step_count_tsyn
                          <<" Pert_In: "<<std::setw(20)<<sd_root.getPertIn()
@@ -1607,7 +2319,8 @@ namespace H4{
             const int n_group_tot = index_dt_sorted_group_.getSize();
             if (n_group_tot==0) return;
 
-            bool merge_mask[n_group_tot];
+            COMM::ScratchScope scratch;
+            bool* merge_mask = scratch.allocate<bool>(n_group_tot);
             for (int k=0; k<n_group_tot; k++) merge_mask[k] = false;
 
             // check merger case
@@ -1646,8 +2359,9 @@ namespace H4{
 
                 const int n_member = groupk.particles.getSize();
 
-                // generate binary tree
-                groupk.info.generateBinaryTree(groupk.particles,ar_manager->interaction.gravitational_constant);
+                // update binary tree, regenerate it only when the minimum distance chain changes
+                if (groupk.info.updateBinaryTree(groupk.particles,ar_manager->interaction.gravitational_constant)) profile.tree_rebuild_count++;
+                else profile.tree_update_count++;
                 
                 auto& bin_root = groupk.info.getBinaryTreeRoot();
                 bool outgoing_flag = false; // Indicate whether it is a outgoing case or income case
@@ -1879,7 +2593,8 @@ namespace H4{
 
             int new_n_particle = 0;
             // used_mask store the current group index of particle i if it is already in new group
-            int used_mask[n_particle+n_group];
+            COMM::ScratchScope scratch;
+            int* used_mask = scratch.allocate<int>(n_particle+n_group);
             // -1 means not yet used 
             for (int k=0; k<n_particle; k++) used_mask[k] = table_single_mask_[k]?-2:-1;
             for (int k=0; k<n_group; k++) used_mask[k+index_offset_group_] = table_group_mask_[k]?-2:-1;
@@ -2142,13 +2857,14 @@ namespace H4{
             modify_system_flag_=true;
 
             // check
+            COMM::ScratchScope scratch;
             // break index (with index_offset_group)
-            int break_group_index_with_offset[groups.getSize()+1];
+            int* break_group_index_with_offset = scratch.allocate<int>(groups.getSize()+1);
             int n_break = 0;
             int n_break_no_add = 0;
             // new index
-            int new_group_particle_index[particles.getSize()];
-            int new_n_group_offset[groups.getSizeMax()+1];
+            int* new_group_particle_index = scratch.allocate<int>(particles.getSize());
+            int* new_n_group_offset = scratch.allocate<int>(groups.getSizeMax()+1);
             int new_n_group = 0;
 
             checkBreak(break_group_index_with_offset, n_break, _start_flag);
@@ -2166,6 +2882,12 @@ namespace H4{
             breakGroups(new_group_particle_index, new_n_group_offset, new_n_group, break_group_index_with_offset, n_break_no_add, n_break);
             addGroups(new_group_particle_index, new_n_group_offset, new_n_group);
 
+            // neighbor lists may point to removed or moved groups, force regular steps for all singles
+            if (manager->ac_step_ratio>1 && (n_break>0 || new_n_group>0)) {
+                const int n_time_reg = time_reg_next_.getSize();
+                for (int i=0; i<n_time_reg; i++) time_reg_next_[i] = -NUMERIC_FLOAT_MAX;
+            }
+
             // initial integration (cannot do it here, in the case AR perturber need initialization first)
             // initialIntegration();
         }
@@ -2186,8 +2908,9 @@ namespace H4{
 
             // check table size and index_dt_sorted size
 #ifdef HERMITE_DEBUG
-            int particle_index_count[particles.getSize()];
-            int group_index_count[groups.getSize()];
+            COMM::ScratchScope scratch;
+            int* particle_index_count = scratch.allocate<int>(particles.getSize());
+            int* group_index_count = scratch.allocate<int>(groups.getSize());
             for (int i=0; i<particles.getSize(); i++) particle_index_count[i]=0;
             for (int i=0; i<groups.getSize(); i++) group_index_count[i]=0;
             // single list
@@ -2233,6 +2956,7 @@ namespace H4{
                 pred_[k] = ptcl[k];
                 // set neighbor radius
                 neighbors[k].clearNoFreeMem();
+                time_reg_next_[k] = -NUMERIC_FLOAT_MAX;
                 Float r_neighbor_crit = ptcl[k].getRNeighbor();
                 neighbors[k].r_neighbor_crit_sq = r_neighbor_crit*r_neighbor_crit;
 
@@ -2331,16 +3055,135 @@ namespace H4{
 
             }
 
-            calcDt2ndList(index_single, n_init_single_, index_group, n_init_group_, dt_limit_);
-            
-            updateTimeNextList(index_single, n_init_single_, index_group, n_init_group_);
+            correctAndUpdateTimeNextList(index_single, n_init_single_, index_group, n_init_group_, dt_limit_, true);
 
             // reset n_init
             n_init_single_ = n_init_group_ = 0;
         }
 
+        //! estimate the cost of integrating one group to the next time
+        /*! The cost is the estimated number of AR steps times N_member^2. 
+          If the group was integrated before, the step number is scaled from the last integration (profile.step_count over info.dt_integrate_last). 
+          Otherwise it is estimated from the time transformation of the logH method, \f$ dt \approx ds/|U| \f$.
+          @param[in] _group: AR group, ds should be updated already
+          @param[in] _dt: time interval to integrate
+          \return estimated cost
+         */
+        Float estimateGroupIntegrationCost(ARSym& _group, const Float _dt) {
+            const Float n_member = _group.particles.getSize();
+            Float n_step = 1.0;
+            if (_group.profile.step_count>0 && _group.info.dt_integrate_last>0.0) 
+                n_step = std::max(Float(1.0), Float(_group.profile.step_count)*_dt/_group.info.dt_integrate_last);
+            else if (_group.info.ds>0.0) 
+                n_step = std::max(Float(1.0), _dt*abs(_group.getEpot())/_group.info.ds);
+            return n_step*n_member*n_member;
+        }
+
+        //! build the task graph of parallel AR group integration
+        /*! One task per worker, each task integrates the groups in ar_task_group_list_ in the range given by ar_task_offset_ to ar_time_next_. 
+          The graph is built once and reused in integrateGroupsListParallel.
+         */
+        void buildARTaskflow() {
+            ar_taskflow_.clear();
+            for (int j=0; j<n_task_; j++) {
+                ar_taskflow_.emplace([this, j](){
+                    const double t0 = AR::TimeMeasure::get_wtime();
+                    const int i_end = ar_task_offset_[j+1];
+                    for (int i=ar_task_offset_[j]; i<i_end; i++) {
+                        const int ik = ar_task_group_list_[i];
+                        interrupt_binary_group_[ik] = groups[index_dt_sorted_group_[ik]].integrateToTime(ar_time_next_);
+                    }
+                    ar_task_time_[j] = AR::TimeMeasure::get_wtime() - t0;
+                });
+            }
+        }
+
+        //! Integrate a range of groups in index_dt_sorted_group_ to time in parallel
+        /*! Groups are independent during AR integration: each group only modifies its own members and information, while perturbers (predictors of singles and group c.m.) are read only. 
+          The groups are sorted by the estimated cost (estimateGroupIntegrationCost) and assigned to threads longest-first (each group to the thread with the lowest load), each thread integrates its groups in one task.
+          The interrupt results are stored in interrupt_binary_group_ with the same index as in index_dt_sorted_group_, the interrupt corrections are done later in the sorted order to keep the results deterministic.
+          The predicted and measured load imbalance (maximum over mean thread load) are saved in profile.
+          @param[in] _i_start: starting index in index_dt_sorted_group_
+          @param[in] _i_end: ending index (not included) in index_dt_sorted_group_
+          @param[in] _time_next: time to integrate
+         */
+        void integrateGroupsListParallel(const int _i_start, const int _i_end, const Float _time_next) {
+            interrupt_binary_group_.resizeNoInitialize(_i_end);
+            const int n_group = _i_end - _i_start;
+            if (n_group<=0) return;
+
+            const int n_thread = std::max(1, std::min(n_task_, n_group));
+
+            // get ds and estimate cost
+            const Float dt = _time_next - time_;
+            COMM::ScratchScope scratch;
+            Float* cost = scratch.allocate<Float>(n_group);
+            int* index_cost_sorted = scratch.allocate<int>(n_group);
+            for (int i=0; i<n_group; i++) {
+                auto& groupk = groups[index_dt_sorted_group_[i+_i_start]];
+                groupk.info.calcDsAndStepOption(ar_manager->step.getOrder(), ar_manager->interaction.gravitational_constant, ar_manager->ds_scale);
+                cost[i] = estimateGroupIntegrationCost(groupk, dt);
+                index_cost_sorted[i] = i;
+            }
+            std::sort(index_cost_sorted, index_cost_sorted+n_group, [&cost](const int &a, const int &b) { return cost[a]>cost[b] || (cost[a]==cost[b] && a<b); });
+
+            // longest-first assignment to threads
+            Float* thread_load = scratch.allocate<Float>(n_thread);
+            int* thread_index = scratch.allocate<int>(n_group);
+            int* thread_count = scratch.allocate<int>(n_thread);
+            for (int j=0; j<n_thread; j++) {
+                thread_load[j] = 0.0;
+                thread_count[j] = 0;
+            }
+            for (int i=0; i<n_group; i++) {
+                int jmin = 0;
+                for (int j=1; j<n_thread; j++) 
+                    if (thread_load[j]<thread_load[jmin]) jmin = j;
+                thread_load[jmin] += cost[index_cost_sorted[i]];
+                thread_index[i] = jmin;
+                thread_count[jmin]++;
+            }
+            // ar_task_offset_: group list boundary of each task in ar_task_group_list_, tasks after n_thread are empty
+            ar_task_offset_[0] = 0;
+            for (int j=0; j<n_task_; j++) ar_task_offset_[j+1] = ar_task_offset_[j] + (j<n_thread ? thread_count[j] : 0);
+            ar_task_group_list_.resizeNoInitialize(n_group);
+            for (int j=0; j<n_thread; j++) thread_count[j] = 0;
+            for (int i=0; i<n_group; i++) {
+                const int j = thread_index[i];
+                ar_task_group_list_[ar_task_offset_[j] + thread_count[j]++] = index_cost_sorted[i] + _i_start;
+            }
+
+            ar_time_next_ = _time_next;
+            if (ar_taskflow_.empty()) buildARTaskflow();
+            TF::Manager::get_executor().run(ar_taskflow_).wait();
+            const double* thread_time = ar_task_time_.getDataAddress();
+
+            // imbalance: maximum load over averaged load
+            Float load_max = 0.0, load_sum = 0.0;
+            double time_max = 0.0, time_sum = 0.0;
+            for (int j=0; j<n_thread; j++) {
+                load_max = std::max(load_max, thread_load[j]);
+                load_sum += thread_load[j];
+                time_max = std::max(time_max, thread_time[j]);
+                time_sum += thread_time[j];
+            }
+            profile.ar_imbalance_predict = load_sum>0.0 ? to_double(load_max*n_thread/load_sum) : 1.0;
+            profile.ar_imbalance_real = time_sum>0.0 ? time_max*n_thread/time_sum : 1.0;
+
+#ifdef HERMITE_DEBUG_PRINT
+            std::cerr<<"AR parallel: time: "<<time_
+                     <<" N_group: "<<n_group
+                     <<" N_thread: "<<n_thread
+                     <<" imbalance(predict): "<<profile.ar_imbalance_predict
+                     <<" imbalance(real): "<<profile.ar_imbalance_real
+                     <<std::endl;
+#endif
+        }
+
         //! Integrate groups
-        /*! Integrate all groups to time
+        /*! Integrate all groups to time. 
+          If the number of groups is no less than manager->n_group_ar_parallel_min (>0), the groups are integrated in parallel first and the interruptions are processed afterwards in the order of index_dt_sorted_group_, thus the results do not depend on the number of threads. 
+          The parallel mode is switched off when ar_manager->interrupt_detection_option==2, since the integration should stop at the first interrupted group.
           \return interrupted binarytree if exist
          */
         AR::InterruptBinary<Tparticle>& integrateGroupsOneStep() {
@@ -2365,22 +3208,46 @@ namespace H4{
             // integrate groups loop 
             const int n_group_tot = index_dt_sorted_group_.getSize();
             const int i_start = interrupt_group_dt_sorted_group_index_>=0 ? interrupt_group_dt_sorted_group_index_ : 0;
-            int interrupt_index_dt_group_list[n_group_tot];
+            COMM::ScratchScope scratch;
+            int* interrupt_index_dt_group_list = scratch.allocate<int>(n_group_tot);
             int n_interrupt_change_dt=0;
 
+            const bool parallel_flag = manager->n_group_ar_parallel_min>0 
+                && n_group_tot - i_start >= manager->n_group_ar_parallel_min
+                && ar_manager->interrupt_detection_option!=2;
+
+            if (parallel_flag) {
+#ifdef HERMITE_DEBUG            
+                for (int i=i_start; i<n_group_tot; i++) {
+                    const int k = index_dt_sorted_group_[i];
+                    ASSERT(table_group_mask_[k]==false);
+                    ASSERT(abs(groups[k].getTime()-time_)<=ar_manager->time_error_max);
+                }
+#endif
+                integrateGroupsListParallel(i_start, n_group_tot, time_next);
+            }
+
             for (int i=i_start; i<n_group_tot; i++) {
                 const int k = index_dt_sorted_group_[i];
 
+                if (parallel_flag) {
+                    interrupt_binary_ = interrupt_binary_group_[i];
+                }
+                else {
 #ifdef HERMITE_DEBUG            
-                ASSERT(table_group_mask_[k]==false);
-                if (i!=interrupt_group_dt_sorted_group_index_) 
-                    ASSERT(abs(groups[k].getTime()-time_)<=ar_manager->time_error_max);
+                    ASSERT(table_group_mask_[k]==false);
+                    if (i!=interrupt_group_dt_sorted_group_index_) 
+                        ASSERT(abs(groups[k].getTime()-time_)<=ar_manager->time_error_max);
 #endif
-                // get ds estimation
-                groups[k].info.calcDsAndStepOption(ar_manager->step.getOrder(), ar_manager->interaction.gravitational_constant, ar_manager->ds_scale);
+                    // get ds estimation
+                    groups[k].info.calcDsAndStepOption(ar_manager->step.getOrder(), ar_manager->interaction.gravitational_constant, ar_manager->ds_scale);
+
+                    // group integration 
+                    interrupt_binary_ = groups[k].integrateToTime(time_next);
+                }
 
-                // group integration 
-                interrupt_binary_ = groups[k].integrateToTime(time_next);
+                // record integration time interval for cost estimation
+                groups[k].info.dt_integrate_last = time_next - time_;
 
                 // profile
                 profile.ar_step_count += groups[k].profile.step_count;
@@ -2461,7 +3328,7 @@ namespace H4{
                 // shift position starts from the last interrupt index in sorted list (right to left)
                 int ishift_start = interrupt_index_dt_group_list[n_interrupt_change_dt-1]; 
                 // back up group index
-                int interrupt_index_group_list[n_interrupt_change_dt];
+                int* interrupt_index_group_list = scratch.allocate<int>(n_interrupt_change_dt);
                 interrupt_index_group_list[0] = index_dt_sorted_group_[ishift_start];
                 // this is to record the offset need to shift index in sorted list
                 int shift_offset=1;
@@ -2495,7 +3362,7 @@ namespace H4{
 
 #ifdef HERMITE_DEBUG
                 // check whether the new list is consistent with table_group_mask_ 
-                int table_check_mask[n_group_tot];
+                int* table_check_mask = scratch.allocate<int>(n_group_tot);
                 for (int i=0; i<n_group_tot; i++) table_check_mask[i]=0;
                 for (int i=0; i<index_dt_sorted_group_.getSize(); i++) table_check_mask[index_dt_sorted_group_[i]]++;
                 for (int i=0; i<n_group_tot; i++) {
@@ -2519,7 +3386,8 @@ namespace H4{
 
         //! modify single particles due to external functions, update energy
         void modifySingleParticles() {
-            int mod_index[n_act_single_];
+            COMM::ScratchScope scratch;
+            int* mod_index = scratch.allocate<int>(n_act_single_);
             int n_mod=0;
             for (int i=0; i<n_act_single_; i++) {
                 int k = index_dt_sorted_single_[i];
@@ -2593,8 +3461,39 @@ namespace H4{
         }
         
 
+        //! build the task graph of one block step
+        /*! Each stage has n_task_ tasks working on continuous parts of the particle lists:
+          predict all particles -> check group resolve, create j particle list and split force work (one task) -> force of active particles -> correct, calculate time steps and update time_next (correctStageTask). 
+          The graph is built once and reused by integrateSingleOneStepAct, the ranges are given by step_time_next_ and the correction lists (setCorrectList) at run time.
+         */
+        void buildStepTaskflow() {
+            step_taskflow_.clear();
+            auto prepare = step_taskflow_.emplace([this](){
+                checkGroupResolve(n_act_group_);
+                writeBackResolvedGroupAndCreateJParticleList(true);
+                prepareForceWorkList(index_dt_sorted_single_.getDataAddress(), n_act_single_, index_dt_sorted_group_.getDataAddress(), n_act_group_);
+            });
+            auto force_join = step_taskflow_.placeholder();
+            for (int t=0; t<n_task_; t++) {
+                auto predict = step_taskflow_.emplace([this, t](){
+                    predictTask(step_time_next_, t);
+                });
+                auto force = step_taskflow_.emplace([this, t](){
+                    calcForceWorkItemTask(t);
+                });
+                auto correct = step_taskflow_.emplace([this, t](){
+                    correctStageTask(t);
+                });
+                predict.precede(prepare);
+                prepare.precede(force);
+                force.precede(force_join);
+                force_join.precede(correct);
+            }
+        }
+
         //! Integration single active particles and update steps 
-        /*! Integrated to next time given by minimum step particle
+        /*! Integrated to next time given by minimum step particle.
+          With more than one worker, the step is done by the reused task graph step_taskflow_
         */
         void integrateSingleOneStepAct() {
             ASSERT(checkParams());
@@ -2609,21 +3508,29 @@ namespace H4{
 
             dt_limit_ = step.calcNextDtLimit(time_next);
 
-            // prediction positions
-            predictAll(time_next);
+            if (n_task_>1) {
+                step_time_next_ = time_next;
+                setCorrectList(index_dt_sorted_single_.getDataAddress(), n_act_single_, index_dt_sorted_group_.getDataAddress(), n_act_group_, dt_limit_, false);
+                if (step_taskflow_.empty()) buildStepTaskflow();
+                TF::Manager::get_executor().run(step_taskflow_).wait();
+            }
+            else {
+                // prediction positions
+                predictAll(time_next);
 
-            // check resolve status
-            checkGroupResolve(n_act_group_);
-            writeBackResolvedGroupAndCreateJParticleList(true);
+                // check resolve status
+                checkGroupResolve(n_act_group_);
+                writeBackResolvedGroupAndCreateJParticleList(true);
 
-            int* index_single = index_dt_sorted_single_.getDataAddress();
-            int* index_group = index_dt_sorted_group_.getDataAddress();
+                int* index_single = index_dt_sorted_single_.getDataAddress();
+                int* index_group = index_dt_sorted_group_.getDataAddress();
 
-            calcAccJerkNBList(index_single, n_act_single_, index_group, n_act_group_);
+                calcAccJerkNBList(index_single, n_act_single_, index_group, n_act_group_);
 
-            correctAndCalcDt4thList(index_single, n_act_single_, index_group, n_act_group_, dt_limit_);
+                correctAndCalcDt4thList(index_single, n_act_single_, index_group, n_act_group_, dt_limit_);
 
-            updateTimeNextList(index_single, n_act_single_, index_group, n_act_group_);
+                updateTimeNextList(index_single, n_act_single_, index_group, n_act_group_);
+            }
 
             // update time
             time_ = time_next;
@@ -2631,6 +3538,11 @@ namespace H4{
             // profile
             profile.hermite_single_step_count += n_act_single_;
             profile.hermite_group_step_count += n_act_group_;
+            if (manager->ac_step_ratio>1) {
+                for (int i=0; i<n_act_single_; i++) 
+                    if (time_reg_[index_dt_sorted_single_[i]]==time_) profile.hermite_single_regular_count++;
+            }
+            else profile.hermite_single_regular_count += n_act_single_;
         }
 
         //! Integration a list of particle to current time (ingore dt)
@@ -2647,9 +3559,10 @@ namespace H4{
             ASSERT(initial_system_flag_);
 
             // adjust dt
-            int index_single_select[_n_particle];
+            COMM::ScratchScope scratch;
+            int* index_single_select = scratch.allocate<int>(_n_particle);
             int n_single_select =0;
-            int index_group_select[groups.getSize()];
+            int* index_group_select = scratch.allocate<int>(groups.getSize());
             int n_group_select =0;
 
             auto* ptcl = particles.getDataAddress();
@@ -2677,20 +3590,72 @@ namespace H4{
 
                 calcAccJerkNBList(index_single_select, n_single_select, index_group_select, n_group_select);
 
-                correctAndCalcDt4thList(index_single_select, n_single_select, index_group_select, n_group_select, dt_limit_);
+                correctAndUpdateTimeNextList(index_single_select, n_single_select, index_group_select, n_group_select, dt_limit_, false);
+            }
+        }
 
-                updateTimeNextList(index_single_select, n_single_select, index_group_select, n_group_select);
+        //! sort the active part of a dt sorted index list by block step levels
+        /*! The active particles are distributed to buckets by the level of time_next_ - time_ in the unit of the minimum step size (the exponent of the ratio), then each bucket is sorted by time_next_ with insertion. 
+          In block time steps, all particles in one level have the same time_next_, thus the sorting cost is O(_n_act). The order of particles with the same time_next_ is kept.
+          @param[in,out] _index: index list, the active part is [0, _n_act)
+          @param[in] _n_act: number of active particles
+          @param[in] _offset: offset of index in time_next_
+         */
+        void sortDtIndexActiveByLevel(COMM::List<int>& _index, const int _n_act, const int _offset) {
+            if (_n_act<=1) return;
+            static const int n_level = 64;
+            const Float* time_next = time_next_.getDataAddress();
+            int* index = _index.getDataAddress();
+            const Float dt_min_inv = 1.0/step.getDtMin();
+
+            // level of each particle and bucket offset
+            COMM::ScratchScope scratch;
+            int* level = scratch.allocate<int>(_n_act);
+            int* level_offset = scratch.allocate<int>(n_level+1);
+            for (int k=0; k<=n_level; k++) level_offset[k] = 0;
+            for (int k=0; k<_n_act; k++) {
+                const Float dt = time_next[index[k]+_offset] - time_;
+                int lev = 0;
+                if (dt>0.0) {
+                    std::frexp(to_double(dt*dt_min_inv), &lev);
+                    lev = std::max(0, std::min(n_level-1, lev));
+                }
+                level[k] = lev;
+                level_offset[lev+1]++;
+            }
+            for (int k=0; k<n_level; k++) level_offset[k+1] += level_offset[k];
+
+            // distribute to buckets
+            int* index_bucket = scratch.allocate<int>(_n_act);
+            for (int k=0; k<_n_act; k++) index_bucket[level_offset[level[k]]++] = index[k];
+
+            // sort each bucket by time_next_, linear if time_next_ are the same in the bucket
+            int i_start = 0;
+            for (int lev=0; lev<n_level; lev++) {
+                const int i_end = level_offset[lev];
+                for (int i=i_start; i<i_end; i++) {
+                    const int ki = index_bucket[i];
+                    const Float ti = time_next[ki+_offset];
+                    int j = i;
+                    while (j>i_start && ti<time_next[index[j-1]+_offset]) {
+                        index[j] = index[j-1];
+                        j--;
+                    }
+                    index[j] = ki;
+                }
+                i_start = i_end;
             }
         }
 
         //! sort time step array and select active particles
-        /*! Make sure time_next_ is updated already
+        /*! Make sure time_next_ is updated already.
+          Only the active particles are sorted (see sortDtIndexActiveByLevel), the inactive ones stay sorted since an active particle cannot get a step beyond the next time of a larger block step level.
          */
         void sortDtAndSelectActParticle() {
             // sort single
-            std::sort(index_dt_sorted_single_.getDataAddress(), index_dt_sorted_single_.getDataAddress()+n_act_single_, SortIndexDtSingle(time_next_.getDataAddress()));
+            sortDtIndexActiveByLevel(index_dt_sorted_single_, n_act_single_, 0);
             // sort group
-            std::sort(index_dt_sorted_group_.getDataAddress(), index_dt_sorted_group_.getDataAddress()+n_act_group_, SortIndexDtGroup(time_next_.getDataAddress(), index_offset_group_));
+            sortDtIndexActiveByLevel(index_dt_sorted_group_, n_act_group_, index_offset_group_);
 
             // get minimum next time from single and group
             time_next_min_ = NUMERIC_FLOAT_MAX;
@@ -2818,13 +3783,117 @@ namespace H4{
         }
          */
 
+        //! sum the values of items calculated in parallel
+        /*! In reproducible mode (manager->reproducible_flag), the value of each item is stored and summed by the fixed-order tree (COMM::reduceSumTree), thus the result does not depend on the number of threads. 
+          Otherwise each task sums a continuous part of items and the partial sums are added in the task order.
+          With one worker or less than #n_sum_parallel_min_ items, the items are calculated serially, but the same summation order is kept in reproducible mode.
+          @param[in] _n: number of items
+          @param[in] _func: function (const int _i) returning the value of item _i
+          \return sum
+         */
+        template <class Tfunc>
+        Float sumItemsParallel(const int _n, Tfunc&& _func) {
+            const bool parallel_flag = n_task_>1 && _n>=n_sum_parallel_min_;
+            if (manager->reproducible_flag) {
+                COMM::ScratchScope scratch;
+                Float* value = scratch.allocate<Float>(_n);
+                if (parallel_flag) {
+                    tf::Taskflow flow;
+                    for (int t=0; t<n_task_; t++) {
+                        flow.emplace([&, t](){
+                            const int i_end = _n*(t+1)/n_task_;
+                            for (int i=_n*t/n_task_; i<i_end; i++) value[i] = _func(i);
+                        });
+                    }
+                    TF::Manager::get_executor().run(flow).wait();
+                }
+                else {
+                    for (int i=0; i<_n; i++) value[i] = _func(i);
+                }
+                return COMM::reduceSumTree(value, _n);
+            }
+            else if (parallel_flag) {
+                COMM::ScratchScope scratch;
+                Float* sum_task = scratch.allocate<Float>(n_task_);
+                tf::Taskflow flow;
+                for (int t=0; t<n_task_; t++) {
+                    flow.emplace([&, t](){
+                        Float sum = 0.0;
+                        const int i_end = _n*(t+1)/n_task_;
+                        for (int i=_n*t/n_task_; i<i_end; i++) sum += _func(i);
+                        sum_task[t] = sum;
+                    });
+                }
+                TF::Manager::get_executor().run(flow).wait();
+                Float sum = 0.0;
+                for (int t=0; t<n_task_; t++) sum += sum_task[t];
+                return sum;
+            }
+            else {
+                Float sum = 0.0;
+                for (int i=0; i<_n; i++) sum += _func(i);
+                return sum;
+            }
+        }
+
+        //! check whether all singles and group c.m. are at the current time
+        bool isSynchronized() const {
+            const int n_single = index_dt_sorted_single_.getSize();
+            for (int k=0; k<n_single; k++) 
+                if (particles[index_dt_sorted_single_[k]].time != time_) return false;
+            const int n_group = index_dt_sorted_group_.getSize();
+            for (int k=0; k<n_group; k++) 
+                if (groups[index_dt_sorted_group_[k]].particles.cm.time != time_) return false;
+            return true;
+        }
+
+        //! calculate kinetic and potential energy from the potentials of the last force calculation
+        /*! All singles and group c.m. should be at the current time, thus force_ is calculated at the current time from the predicted j particles.
+          The potential energy between singles and group c.m. is 1/2 sum m_i pot_i, where the pot of a resolved group c.m. is the mass-weighted average of members, and the internal potential energy of groups is added.
+          The result is exact to the accuracy of the predictor for the direct summation. With the Ahmad-Cohen scheme the regular part of pot is from the last regular step, and with the octree the far-field pot is from the monopole approximation, thus the energy is also approximate.
+          The perturbation energy is not included.
+         */
+        void calcEnergyFromPot() {
+            ASSERT(isSynchronized());
+            const int* index_single = index_dt_sorted_single_.getDataAddress();
+            const int* index_group = index_dt_sorted_group_.getDataAddress();
+            const auto* ptcl = particles.getDataAddress();
+            const auto* group_ptr = groups.getDataAddress();
+            const auto* force = force_.getDataAddress();
+            const int index_offset_group = index_offset_group_;
+
+            energy_.ekin = 0.5*sumItemsParallel(index_dt_sorted_single_.getSize(), [=](const int k) { 
+                    const auto& pi = ptcl[index_single[k]];
+                    return pi.mass*(pi.vel[0]*pi.vel[0] + pi.vel[1]*pi.vel[1] + pi.vel[2]*pi.vel[2]); }) 
+                + sumItemsParallel(index_dt_sorted_group_.getSize(), [=](const int k) {
+                    const auto& gi = group_ptr[index_group[k]];
+                    const auto& pcm = gi.particles.cm;
+                    return 0.5*pcm.mass*(pcm.vel[0]*pcm.vel[0] + pcm.vel[1]*pcm.vel[1] + pcm.vel[2]*pcm.vel[2]) + gi.getEkin(); });
+            energy_.epot = 0.5*sumItemsParallel(index_dt_sorted_single_.getSize(), [=](const int k) {
+                    const int i = index_single[k];
+                    return ptcl[i].mass*force[i].pot; })
+                + sumItemsParallel(index_dt_sorted_group_.getSize(), [=](const int k) {
+                    const int i = index_group[k];
+                    const auto& gi = group_ptr[i];
+                    return 0.5*gi.particles.cm.mass*force[i+index_offset_group].pot + gi.getEpot(); });
+            energy_.epert = 0.0;
+        }
+
         //! calculate slowdown energy
-        /*! @param[in] _initial_flag: if true, set energy reference
+        /*! If manager->energy_from_pot is true and all particles are synchronized, the energy is calculated by calcEnergyFromPot, otherwise (or if _recalc_flag is true) by the full recalculation in interaction.calcEnergy.
+          @param[in] _initial_flag: if true, set energy reference
+          @param[in] _recalc_flag: if true, always use the full recalculation
          */
-        void calcEnergySlowDown(const bool _initial_flag = false) {
+        void calcEnergySlowDown(const bool _initial_flag = false, const bool _recalc_flag = false) {
             writeBackGroupMembers();
+            if (manager->energy_from_pot && !_recalc_flag && isSynchronized()) {
+                calcEnergyFromPot();
+                calcEnergySlowDownFromEnergy(_initial_flag);
+                return;
+            }
             // use a tempare array instead of modify pred_. As a good design, the function of calc energy should not influence integration.
-            Tparticle ptmp[particles.getSize()];
+            COMM::ScratchScope scratch;
+            Tparticle* ptmp = scratch.allocate<Tparticle>(particles.getSize());
             const auto* ptcl = particles.getDataAddress();
             const auto* pred = pred_.getDataAddress();
 
@@ -2866,18 +3935,32 @@ namespace H4{
             // since a part of particles are not up to date, used predict particles to calculate energy, 
             // notice pred_.size is larger than particles.size because group c.m. is in pred_.
             manager->interaction.calcEnergy(energy_, ptmp, particles.getSize(), groups.getDataAddress(), index_dt_sorted_group_.getDataAddress(), index_dt_sorted_group_.getSize(), perturber);
+            calcEnergySlowDownFromEnergy(_initial_flag);
+        }
+
+        //! update slowdown energy and energy references after energy_ is calculated
+        /*! @param[in] _initial_flag: if true, set energy reference
+         */
+        void calcEnergySlowDownFromEnergy(const bool _initial_flag) {
             accumDESlowDownChange();
             // slowdown energy
             energy_sd_.ekin = energy_.ekin;
             energy_sd_.epot = energy_.epot;
             energy_sd_.epert= energy_.epert;
-            for (int i=0; i<groups.getSize(); i++) {
-                auto& gi = groups[i];
-                energy_sd_.ekin -= gi.getEkin();
-                energy_sd_.epot -= gi.getEpot(); 
-
-                energy_sd_.ekin += gi.getEkinSlowDown();
-                energy_sd_.epot += gi.getEpotSlowDown();
+            if (manager->reproducible_flag) {
+                auto* group_ptr = groups.getDataAddress();
+                energy_sd_.ekin += sumItemsParallel(groups.getSize(), [group_ptr](const int i) { return group_ptr[i].getEkinSlowDown() - group_ptr[i].getEkin(); });
+                energy_sd_.epot += sumItemsParallel(groups.getSize(), [group_ptr](const int i) { return group_ptr[i].getEpotSlowDown() - group_ptr[i].getEpot(); });
+            }
+            else {
+                for (int i=0; i<groups.getSize(); i++) {
+                    auto& gi = groups[i];
+                    energy_sd_.ekin -= gi.getEkin();
+                    energy_sd_.epot -= gi.getEpot(); 
+
+                    energy_sd_.ekin += gi.getEkinSlowDown();
+                    energy_sd_.epot += gi.getEpotSlowDown();
+                }
             }
             if (_initial_flag) {
                 energy_init_ref_ = energy_.getEtot();
@@ -34,6 +34,38 @@ namespace H4 {
         
     };
 
+    //! neighbor address list with automatic memory expansion
+    /*! The list starts from a small memory size and doubles the size when it is full, thus the memory is proportional to the number of neighbors instead of the total number of particles and groups.
+      The addresses are kept in one continuous array, the reading is the same as COMM::List (e.g. the perturbation in AR integration).
+      Only the local mode is supported.
+     */
+    template <class Tparticle>
+    class NBAdrList: public COMM::List<NBAdr<Tparticle>> {
+    public:
+        static const int n_reserve_default = 8; ///> initial memory size used in Neighbor::reserveMem
+
+        //! add one neighbor address, the memory is doubled if the list is full
+        /*! @param[in] _adr: neighbor address
+         */
+        void addMember(const NBAdr<Tparticle>& _adr) {
+            if (this->num_==this->nmax_) expandMem(std::max(2*this->nmax_, int(n_reserve_default)));
+            COMM::List<NBAdr<Tparticle>>::addMember(_adr);
+        }
+
+        //! expand memory and keep the current addresses
+        /*! @param[in] _nmax: new memory size
+         */
+        void expandMem(const int _nmax) {
+            if (this->mode_==COMM::ListMode::none) this->mode_ = COMM::ListMode::local;
+            ASSERT(this->mode_==COMM::ListMode::local);
+            ASSERT(_nmax>this->nmax_);
+            NBAdr<Tparticle>* data_new = new NBAdr<Tparticle>[_nmax];
+            for (int i=0; i<this->num_; i++) data_new[i] = this->data_[i];
+            if (this->data_!=NULL) delete[] this->data_;
+            this->data_ = data_new;
+            this->nmax_ = _nmax;
+        }
+    };
     
 //! Neighbor information collector
     template <class Tparticle>
@@ -50,10 +82,10 @@ namespace H4 {
         bool initial_step_flag; // indicate whether the time step need to be initialized due to the change of neighbors
         int n_neighbor_group; // number of group neighbor
         int n_neighbor_single; // number of single neighbor
-        COMM::List<NBAdr<Tparticle>> neighbor_address; // neighbor perturber address
+        NBAdrList<Tparticle> neighbor_address; // neighbor perturber address
 
         //! constructor
-        Neighbor(): r_min_index(-1), mass_min_index(-1), r_min_sq(NUMERIC_FLOAT_MAX), mass_min(NUMERIC_FLOAT_MAX), r_neighbor_crit_sq(-1.0), need_resolve_flag(false), initial_step_flag(false), n_neighbor_group(0), n_neighbor_single(0), neighbor_address() {}
+        Neighbor(): r_min_index(-1), mass_min_index(-1), r_min_sq(NUMERIC_FLOAT_MAX), r_min_mass(0.0), mass_min(NUMERIC_FLOAT_MAX), r_neighbor_crit_sq(-1.0), need_resolve_flag(false), initial_step_flag(false), n_neighbor_group(0), n_neighbor_single(0), neighbor_address() {}
 
         //! check whether parameters values are correct
         /*! \return true: all correct
@@ -101,8 +133,8 @@ namespace H4 {
         }
 
         //! reserve memory for neighbor lists
-        /*! 
-          @param[in] _nmax: maximum number of neighbors
+        /*! The list is expanded automatically if more neighbors are found
+          @param[in] _nmax: initial number of neighbors
         */
         void reserveMem(const int _nmax) {
             neighbor_address.setMode(COMM::ListMode::local);
@@ -114,6 +146,7 @@ namespace H4 {
             r_min_index = -1;
             mass_min_index = -1;
             r_min_sq = NUMERIC_FLOAT_MAX;
+            r_min_mass = 0.0;
             mass_min = NUMERIC_FLOAT_MAX;
             need_resolve_flag = false;
             initial_step_flag = false;
@@ -124,6 +157,7 @@ namespace H4 {
             r_min_index = -1;
             mass_min_index = -1;
             r_min_sq = NUMERIC_FLOAT_MAX;
+            r_min_mass = 0.0;
             mass_min = NUMERIC_FLOAT_MAX;
             n_neighbor_group = 0;
             n_neighbor_single = 0;
@@ -147,6 +181,38 @@ namespace H4 {
             neighbor_address.resizeNoInitialize(0);            
         }
 
+        //! reset nearest and minimum mass neighbor information, the neighbor list is kept
+        void resetNearest() {
+            r_min_index = -1;
+            mass_min_index = -1;
+            r_min_sq = NUMERIC_FLOAT_MAX;
+            r_min_mass = 0.0;
+            mass_min = NUMERIC_FLOAT_MAX;
+        }
+
+        //! update nearest and minimum mass neighbor information from one neighbor in the list
+        /*! Used when the neighbor list is not rebuilt (irregular steps of the Ahmad-Cohen scheme)
+          @param[in] _r2: distance square
+          @param[in] _mass: mass of the neighbor
+          @param[in] _index: index of the neighbor
+          @param[in] _initial_step_flag: initial step flag of the neighbor
+         */
+        void updateNearest(const Float _r2, const Float _mass, const int _index, const bool _initial_step_flag) {
+            // mass weighted nearest neigbor
+            if (_r2*r_min_mass < r_min_sq*_mass) {
+                r_min_sq = _r2;
+                r_min_index = _index;
+                r_min_mass = _mass;
+            }
+            // minimum mass
+            if(mass_min>_mass) {
+                mass_min = _mass;
+                mass_min_index = _index;
+            }
+            // if neighbor step need update, also set update flag for i particle
+            if(_initial_step_flag) initial_step_flag = true;
+        }
+
         //! check and add neighbor of single
         template <class Tp>
         void checkAndAddNeighborSingle(const Float _r2, Tp& _particle, const Neighbor<Tparticle>& _nbp, const int _index) {
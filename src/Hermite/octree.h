@@ -0,0 +1,247 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "Common/Float.h"
+#include "Common/scratch_arena.h"
+#include "Hermite/hermite_particle.h"
+
+namespace H4{
+
+    //! object in the octree: a single or a group c.m.
+    struct OctreeObject{
+        Float pos[3];    ///> predicted position
+        Float vel[3];    ///> predicted velocity
+        Float mass;      ///> mass
+        Float radius;    ///> maximum distance of members to the position (0 for singles and unresolved groups)
+        Float r_crit_sq; ///> neighbor radius square
+        int index;       ///> index in the predictor array of the Hermite integrator
+    };
+
+    //! node of the octree
+    /*! The children of one node are stored continuously, the objects of one node are continuous in Octree::objects
+     */
+    struct OctreeNode{
+        Float pos[3];        ///> c.m. position
+        Float vel[3];        ///> c.m. velocity
+        Float mass;          ///> total mass
+        Float box_min[3];    ///> lower corner of the bounding box of objects (including radius)
+        Float box_max[3];    ///> upper corner of the bounding box of objects (including radius)
+        Float size_sq;       ///> square of the longest edge of the bounding box
+        Float r_crit_sq_max; ///> maximum neighbor radius square of objects
+        int child_start;     ///> index of the first child, -1 for leaf
+        int n_child;         ///> number of children
+        int obj_start;       ///> index of the first object
+        int n_obj;           ///> number of objects
+    };
+
+    //! Octree for the far-field force in Hermite integration
+    /*! The objects are sorted in the tree order by build. The moments and bounding boxes are recalculated by refit after the objects are updated, without changing the tree structure.
+      In the force calculation, a node is used as one monopole (c.m.) particle if it is far enough from the i particle (opening angle) and no object inside can be a neighbor, otherwise it is opened and the objects in leaves are returned to the caller for exact pair interactions.
+     */
+    class Octree{
+    public:
+        static const int depth_max = 32; ///> maximum depth of the tree
+        int n_leaf_max; ///> maximum number of objects in one leaf
+        std::vector<OctreeObject> objects; ///> objects in the tree order
+        std::vector<OctreeNode> nodes;     ///> nodes, the first one is the root
+
+        Octree(): n_leaf_max(8), objects(), nodes() {}
+
+        //! clear function
+        void clear() {
+            objects.clear();
+            nodes.clear();
+        }
+
+        //! get number of objects
+        int getSize() const {
+            return objects.size();
+        }
+
+        //! build the tree from objects
+        /*! The objects are reordered. The moments and bounding boxes are calculated by refit.
+         */
+        void build() {
+            nodes.clear();
+            const int n = objects.size();
+            if (n==0) return;
+
+            // root cube
+            Float cmin[3] = {objects[0].pos[0], objects[0].pos[1], objects[0].pos[2]};
+            Float cmax[3] = {cmin[0], cmin[1], cmin[2]};
+            for (int i=1; i<n; i++) {
+                for (int k=0; k<3; k++) {
+                    cmin[k] = std::min(cmin[k], objects[i].pos[k]);
+                    cmax[k] = std::max(cmax[k], objects[i].pos[k]);
+                }
+            }
+            const Float center[3] = {0.5*(cmin[0]+cmax[0]), 0.5*(cmin[1]+cmax[1]), 0.5*(cmin[2]+cmax[2])};
+            const Float half = 0.5*std::max(cmax[0]-cmin[0], std::max(cmax[1]-cmin[1], cmax[2]-cmin[2]));
+
+            OctreeNode root;
+            root.child_start = -1;
+            root.n_child = 0;
+            root.obj_start = 0;
+            root.n_obj = n;
+            nodes.push_back(root);
+            std::vector<OctreeObject> buffer(n);
+            splitNode(0, center, half, 0, buffer);
+
+            refit();
+        }
+
+        //! recalculate the moments and bounding boxes from objects
+        /*! Children are always after the parent in nodes, thus the nodes are updated backward.
+         */
+        void refit() {
+            for (int k=int(nodes.size())-1; k>=0; k--) {
+                auto& nd = nodes[k];
+                Float mass = 0.0;
+                Float pos[3] = {0.0, 0.0, 0.0};
+                Float vel[3] = {0.0, 0.0, 0.0};
+                Float r_crit_sq_max = 0.0;
+                for (int j=0; j<3; j++) {
+                    nd.box_min[j] = NUMERIC_FLOAT_MAX;
+                    nd.box_max[j] = -NUMERIC_FLOAT_MAX;
+                }
+                if (nd.child_start<0) {
+                    for (int i=nd.obj_start; i<nd.obj_start+nd.n_obj; i++) {
+                        const auto& pi = objects[i];
+                        mass += pi.mass;
+                        for (int j=0; j<3; j++) {
+                            pos[j] += pi.mass*pi.pos[j];
+                            vel[j] += pi.mass*pi.vel[j];
+                            nd.box_min[j] = std::min(nd.box_min[j], pi.pos[j]-pi.radius);
+                            nd.box_max[j] = std::max(nd.box_max[j], pi.pos[j]+pi.radius);
+                        }
+                        r_crit_sq_max = std::max(r_crit_sq_max, pi.r_crit_sq);
+                    }
+                }
+                else {
+                    for (int i=nd.child_start; i<nd.child_start+nd.n_child; i++) {
+                        const auto& ci = nodes[i];
+                        mass += ci.mass;
+                        for (int j=0; j<3; j++) {
+                            pos[j] += ci.mass*ci.pos[j];
+                            vel[j] += ci.mass*ci.vel[j];
+                            nd.box_min[j] = std::min(nd.box_min[j], ci.box_min[j]);
+                            nd.box_max[j] = std::max(nd.box_max[j], ci.box_max[j]);
+                        }
+                        r_crit_sq_max = std::max(r_crit_sq_max, ci.r_crit_sq_max);
+                    }
+                }
+                nd.mass = mass;
+                for (int j=0; j<3; j++) {
+                    // zero mass node is never used as monopole
+                    nd.pos[j] = mass>0.0 ? pos[j]/mass : 0.5*(nd.box_min[j]+nd.box_max[j]);
+                    nd.vel[j] = mass>0.0 ? vel[j]/mass : 0.0;
+                }
+                const Float size = std::max(nd.box_max[0]-nd.box_min[0], std::max(nd.box_max[1]-nd.box_min[1], nd.box_max[2]-nd.box_min[2]));
+                nd.size_sq = size*size;
+                nd.r_crit_sq_max = r_crit_sq_max;
+            }
+        }
+
+        //! calculate acc, jerk and potential of one particle from far nodes, and find objects to calculate exactly
+        /*! A node is used as a monopole if size^2 < theta^2 * r^2, where r is the distance to the node c.m., and the distance square to the bounding box is larger than the neighbor radius squares of both the i particle and all objects in the node. Otherwise the node is opened.
+          The monopole nodes are passed to _far_func, thus the force law is defined by the caller (the interaction class), the node has the members pos, vel and mass as a particle.
+          The objects in opened leaves are passed to _near_func with their indices in the predictor array.
+          @param[in] _pi: i particle (predicted)
+          @param[in] _r_crit_sq: neighbor radius square of i particle
+          @param[in] _theta_sq: opening angle square
+          @param[in] _far_func: function (const OctreeNode& _node) to calculate interaction from one monopole node
+          @param[in] _near_func: function (const int _index) to calculate exact interaction from one object
+        */
+        template <class Tpi, class Tfarfunc, class Tfunc>
+        void calcAccJerkFarAndNear(const Tpi& _pi,
+                                   const Float _r_crit_sq,
+                                   const Float _theta_sq,
+                                   Tfarfunc& _far_func,
+                                   Tfunc& _near_func) const {
+            if (nodes.size()==0) return;
+            int stack[7*depth_max+8];
+            int n_stack = 0;
+            stack[n_stack++] = 0;
+            while (n_stack>0) {
+                const auto& nd = nodes[stack[--n_stack]];
+                if (nd.mass==0.0) continue;
+                const Float dr[3] = {nd.pos[0]-_pi.pos[0],
+                                     nd.pos[1]-_pi.pos[1],
+                                     nd.pos[2]-_pi.pos[2]};
+                const Float dr2 = dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2];
+                Float dbox2 = 0.0;
+                for (int j=0; j<3; j++) {
+                    const Float d = std::max(Float(0.0), std::max(nd.box_min[j]-_pi.pos[j], _pi.pos[j]-nd.box_max[j]));
+                    dbox2 += d*d;
+                }
+                if (nd.size_sq < _theta_sq*dr2 && dbox2 > std::max(_r_crit_sq, nd.r_crit_sq_max)) {
+                    _far_func(nd);
+                }
+                else if (nd.child_start<0) {
+                    for (int i=nd.obj_start; i<nd.obj_start+nd.n_obj; i++) _near_func(objects[i].index);
+                }
+                else {
+                    // push backward to visit children in order
+                    for (int i=nd.child_start+nd.n_child-1; i>=nd.child_start; i--) stack[n_stack++] = i;
+                }
+            }
+        }
+
+    private:
+        //! split one node to octants recursively
+        /*! @param[in] _k: node index
+          @param[in] _center: center of the node cube
+          @param[in] _half: half edge of the node cube
+          @param[in] _depth: depth of the node
+          @param[in] _buffer: buffer for sorting objects
+        */
+        void splitNode(const int _k, const Float* _center, const Float _half, const int _depth, std::vector<OctreeObject>& _buffer) {
+            const int n = nodes[_k].n_obj;
+            if (n<=n_leaf_max || _depth>=depth_max || _half==0.0) return;
+            const int start = nodes[_k].obj_start;
+
+            // counting sort by octant
+            int n_oct[8] = {0,0,0,0,0,0,0,0};
+            COMM::ScratchScope scratch;
+            int* oct = scratch.allocate<int>(n);
+            for (int i=0; i<n; i++) {
+                const auto& pi = objects[start+i];
+                oct[i] = (pi.pos[0]>_center[0]) | ((pi.pos[1]>_center[1])<<1) | ((pi.pos[2]>_center[2])<<2);
+                n_oct[oct[i]]++;
+            }
+            int offset[9];
+            offset[0] = 0;
+            for (int j=0; j<8; j++) offset[j+1] = offset[j] + n_oct[j];
+            int count[8] = {0,0,0,0,0,0,0,0};
+            for (int i=0; i<n; i++) _buffer[offset[oct[i]] + count[oct[i]]++] = objects[start+i];
+            std::copy(_buffer.begin(), _buffer.begin()+n, objects.begin()+start);
+
+            // add non-empty children continuously
+            const int child_start = nodes.size();
+            int child_oct[8];
+            int n_child = 0;
+            for (int j=0; j<8; j++) {
+                if (n_oct[j]==0) continue;
+                OctreeNode child;
+                child.child_start = -1;
+                child.n_child = 0;
+                child.obj_start = start + offset[j];
+                child.n_obj = n_oct[j];
+                nodes.push_back(child);
+                child_oct[n_child++] = j;
+            }
+            nodes[_k].child_start = child_start;
+            nodes[_k].n_child = n_child;
+
+            const Float half_child = 0.5*_half;
+            for (int i=0; i<n_child; i++) {
+                const int j = child_oct[i];
+                const Float center_child[3] = {_center[0] + ((j&1) ? half_child : -half_child),
+                                               _center[1] + ((j&2) ? half_child : -half_child),
+                                               _center[2] + ((j&4) ? half_child : -half_child)};
+                splitNode(child_start+i, center_child, half_child, _depth+1, _buffer);
+            }
+        }
+    };
+}
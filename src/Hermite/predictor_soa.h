@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Common/Float.h"
+
+namespace H4{
+
+    //! Structure-of-arrays tile for the Hermite predictor
+    /*! Up to #n_tile particles are gathered from the AoS particle array (pos, vel, acc0, acc1 and the time difference), predicted together in branch-free loops over each component, which the compiler can vectorize, and scattered back to the AoS predictor array.
+      The expressions are the same as the scalar predictor, thus the results are identical.
+     */
+    class PredictorTileSoA{
+    public:
+        static const int n_tile = 64; ///> maximum number of particles in one tile
+
+        int n; ///> number of particles in the tile
+        int index[n_tile]; ///> index of particles in the predictor array
+        alignas(64) Float dt[n_tile];      ///> time difference for prediction
+        alignas(64) Float mass[n_tile];    ///> mass
+        alignas(64) Float pos[3][n_tile];  ///> position, predicted in place
+        alignas(64) Float vel[3][n_tile];  ///> velocity, predicted in place
+        alignas(64) Float acc0[3][n_tile]; ///> acceleration
+        alignas(64) Float acc1[3][n_tile]; ///> jerk
+
+        PredictorTileSoA(): n(0) {}
+
+        //! check whether the tile is full
+        bool isFull() const {
+            return n==n_tile;
+        }
+
+        //! gather one particle
+        /*! @param[in] _index: index in the predictor array
+          @param[in] _p: particle (with time, pos, vel, acc0, acc1 and mass)
+          @param[in] _dt: time difference for prediction
+         */
+        template <class Tparticle>
+        void add(const int _index, const Tparticle& _p, const Float _dt) {
+            ASSERT(n<n_tile);
+            index[n] = _index;
+            dt[n] = _dt;
+            mass[n] = _p.mass;
+            for (int j=0; j<3; j++) {
+                pos[j][n]  = _p.pos[j];
+                vel[j][n]  = _p.vel[j];
+                acc0[j][n] = _p.acc0[j];
+                acc1[j][n] = _p.acc1[j];
+            }
+            n++;
+        }
+
+        //! predict all particles in the tile and write to the predictor array, then reset the tile
+        /*! @param[out] _pred: predictor array
+         */
+        template <class Tpred>
+        void predictAndScatter(Tpred* _pred) {
+            const Float inv3 = 1.0 / 3.0;
+            for (int j=0; j<3; j++) {
+                Float* __restrict__ x = pos[j];
+                Float* __restrict__ v = vel[j];
+                const Float* __restrict__ a0 = acc0[j];
+                const Float* __restrict__ a1 = acc1[j];
+                for (int k=0; k<n; k++) {
+                    const Float dtk = dt[k];
+                    x[k] = x[k] + dtk*(v[k] + 0.5*dtk*(a0[k] + inv3*dtk*a1[k]));
+                    v[k] = v[k] + dtk*(a0[k] + 0.5*dtk*a1[k]);
+                }
+            }
+            for (int k=0; k<n; k++) {
+                auto& pk = _pred[index[k]];
+                pk.pos[0] = pos[0][k];
+                pk.pos[1] = pos[1][k];
+                pk.pos[2] = pos[2][k];
+                pk.vel[0] = vel[0][k];
+                pk.vel[1] = vel[1][k];
+                pk.vel[2] = vel[2][k];
+                pk.mass = mass[k];
+            }
+            n = 0;
+        }
+    };
+}
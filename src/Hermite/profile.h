@@ -6,18 +6,26 @@ namespace H4{
         typedef long long unsigned int UInt64;
         UInt64 hermite_single_step_count; // number of integration steps of hermite single
         UInt64 hermite_group_step_count; // number of integration steps of hermite groups
+        UInt64 hermite_single_regular_count; // number of full force (regular) steps of hermite single, less than hermite_single_step_count in Ahmad-Cohen scheme
         UInt64 ar_step_count; // number of integration steps of ar
         UInt64 ar_step_count_tsyn; // number of integration steps of ar
         UInt64 break_group_count; // times of break groups
         UInt64 new_group_count; // times of new groups
+        UInt64 tree_rebuild_count; // times of binary tree regeneration in checkBreak
+        UInt64 tree_update_count; // times of incremental binary tree update (orbits only) in checkBreak
+        double ar_imbalance_predict; // predicted load imbalance (maximum/average) of the last parallel AR integration
+        double ar_imbalance_real; // measured load imbalance (maximum/average) of the last parallel AR integration
 
         Profile() {clear();} 
     
         void clear() {
             hermite_single_step_count = hermite_group_step_count = 0;
+            hermite_single_regular_count = 0;
             ar_step_count = ar_step_count_tsyn = 0;
             break_group_count = 0;
             new_group_count = 0;
+            tree_rebuild_count = tree_update_count = 0;
+            ar_imbalance_predict = ar_imbalance_real = 1.0;
         }
 
         //! print titles of class members using column style
@@ -31,7 +39,12 @@ namespace H4{
                  <<std::setw(_width)<<"AR_step"
                  <<std::setw(_width)<<"AR_step_tsyn"
                  <<std::setw(_width)<<"break_group"
-                 <<std::setw(_width)<<"new_group";
+                 <<std::setw(_width)<<"new_group"
+                 <<std::setw(_width)<<"AR_imb_pred"
+                 <<std::setw(_width)<<"AR_imb_real"
+                 <<std::setw(_width)<<"H4_reg_single"
+                 <<std::setw(_width)<<"tree_rebuild"
+                 <<std::setw(_width)<<"tree_update";
         }
 
         //! print data of class members using column style
@@ -45,7 +58,12 @@ namespace H4{
                  <<std::setw(_width)<<ar_step_count
                  <<std::setw(_width)<<ar_step_count_tsyn
                  <<std::setw(_width)<<break_group_count
-                 <<std::setw(_width)<<new_group_count;
+                 <<std::setw(_width)<<new_group_count
+                 <<std::setw(_width)<<ar_imbalance_predict
+                 <<std::setw(_width)<<ar_imbalance_real
+                 <<std::setw(_width)<<hermite_single_regular_count
+                 <<std::setw(_width)<<tree_rebuild_count
+                 <<std::setw(_width)<<tree_update_count;
         }
 
     };